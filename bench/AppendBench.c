@@ -0,0 +1,101 @@
+/**
+ * Building long lists from an array, and appending one list to another.
+ *
+ * The previous way, glist_add once per value with the capacity doubled as needed, is kept here as a
+ * baseline. Every row builds 10M values in total, as lists of 100K or as one list of 10M values.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "GenericList.h"
+
+#define BENCH_TOTAL_COUNT	(10 * 1000 * 1000)
+#define BENCH_RUNS			5
+
+struct gvalue_value *bench_values = NULL;
+
+struct glist_list *bench_addEach(struct glist_list *source) {
+	struct glist_list *list = glist_create(gvalue.longType);
+	for (uint32_t i = 0; i < source->size; i++) {
+		glist_add(list, bench_values[i]);
+	}
+	return list;
+}
+
+struct glist_list *bench_reserveAndAdd(struct glist_list *source) {
+	struct glist_list *list = glist_create(gvalue.longType);
+	glist_reserve(list, source->size);
+	for (uint32_t i = 0; i < source->size; i++) {
+		glist_add(list, bench_values[i]);
+	}
+	return list;
+}
+
+struct glist_list *bench_addAll(struct glist_list *source) {
+	struct glist_list *list = glist_create(gvalue.longType);
+	glist_addAll(list, bench_values, source->size);
+	return list;
+}
+
+struct glist_list *bench_addEachFromList(struct glist_list *source) {
+	struct glist_list *list = glist_create(gvalue.longType);
+	for (uint32_t i = 0; i < source->size; i++) {
+		glist_add(list, source->nodes[i].value);
+	}
+	return list;
+}
+
+struct glist_list *bench_addList(struct glist_list *source) {
+	struct glist_list *list = glist_create(gvalue.longType);
+	glist_addList(list, source);
+	return list;
+}
+
+// Returns the best time of a few runs in milliseconds, as the first touch of fresh memory varies a lot.
+double bench_run(struct glist_list *(*func)(struct glist_list *), struct glist_list *source, uint64_t *sink) {
+	double best = 0;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		clock_t start = clock();
+		for (uint32_t done = 0; done < BENCH_TOTAL_COUNT; done += source->size) {
+			struct glist_list *list = func(source);
+			*sink += (uint64_t) list->nodes[list->size - 1].value.primitive.longValue + list->size;
+			glist_free(list);
+		}
+		double milliseconds = (double) (clock() - start) * 1000 / CLOCKS_PER_SEC;
+		best = (run == 0 || milliseconds < best) ? milliseconds : best;
+	}
+	return best;
+}
+
+int main(void) {
+	const char *names[] = { "glist_add each", "glist_reserve and glist_add", "glist_addAll",
+			"glist_add each from a list", "glist_addList" };
+	struct glist_list *(*funcs[])(struct glist_list *) = { bench_addEach, bench_reserveAndAdd, bench_addAll,
+			bench_addEachFromList, bench_addList };
+	uint32_t sizes[] = { 100 * 1000, BENCH_TOTAL_COUNT };
+	uint64_t sink = 0;
+
+	bench_values = malloc(sizeof(struct gvalue_value) * BENCH_TOTAL_COUNT);
+	for (uint32_t i = 0; i < BENCH_TOTAL_COUNT; i++) {
+		bench_values[i] = gvalue_getLong(i);
+	}
+
+	puts("Method, lists of 100K ms, one list of 10M ms");
+	for (size_t f = 0; f < sizeof(funcs) / sizeof(funcs[0]); f++) {
+		double milliseconds[2];
+		for (int s = 0; s < 2; s++) {
+			struct glist_list *source = glist_create(gvalue.longType);
+			glist_addAll(source, bench_values, sizes[s]);
+			milliseconds[s] = bench_run(funcs[f], source, &sink);
+			glist_free(source);
+		}
+		printf("%-27s, %7.1f, %7.1f\n", names[f], milliseconds[0], milliseconds[1]);
+	}
+
+	free(bench_values);
+	printf("(checksum %" PRIu64 ")\n", sink);
+	return EXIT_SUCCESS;
+}
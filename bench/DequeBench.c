@@ -0,0 +1,81 @@
+/**
+ * A work queue that pushes values at the back and pops them from the front.
+ *
+ * The previous way, a glist with glist_add and glist_removeIndex(list, 0), is kept here as a baseline
+ * for the sizes where it finishes in reasonable time, as every pop shifts the whole list.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "GenericDeque.h"
+
+#define BENCH_BASELINE_MAX_SIZE	(10 * 1000)
+#define BENCH_MAX_SIZE			(10 * 1000 * 1000)
+
+// Fills the queue, then pops one and pushes one size times, then drains it.
+uint64_t bench_list(uint32_t size) {
+	struct glist_list *list = glist_create(gvalue.longType);
+	uint64_t sum = 0;
+
+	for (uint32_t i = 0; i < size; i++) {
+		glist_add(list, gvalue_getLong(i));
+	}
+	for (uint32_t i = 0; i < size; i++) {
+		sum += (uint64_t) glist_get(list, 0)->primitive.longValue;
+		glist_removeIndex(list, 0);
+		glist_add(list, gvalue_getLong(i));
+	}
+	while (list->size > 0) {
+		sum += (uint64_t) glist_get(list, 0)->primitive.longValue;
+		glist_removeIndex(list, 0);
+	}
+
+	glist_free(list);
+	return sum;
+}
+
+uint64_t bench_deque(uint32_t size) {
+	struct gdeque_deque *deque = gdeque_create(gvalue.longType);
+	struct gvalue_value value;
+	uint64_t sum = 0;
+
+	for (uint32_t i = 0; i < size; i++) {
+		gdeque_pushBack(deque, gvalue_getLong(i));
+	}
+	for (uint32_t i = 0; i < size; i++) {
+		gdeque_popFront(deque, &value);
+		sum += (uint64_t) value.primitive.longValue;
+		gdeque_pushBack(deque, gvalue_getLong(i));
+	}
+	while (gdeque_popFront(deque, &value)) {
+		sum += (uint64_t) value.primitive.longValue;
+	}
+
+	gdeque_free(deque);
+	return sum;
+}
+
+// Returns the time in milliseconds.
+double bench_run(uint64_t (*func)(uint32_t), uint32_t size, uint64_t *sink) {
+	clock_t start = clock();
+	*sink += func(size);
+	return (double) (clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+int main(void) {
+	uint64_t sink = 0;
+
+	puts("Size, glist_removeIndex(list, 0) ms, gdeque ms");
+
+	for (uint32_t size = 1000; size <= BENCH_MAX_SIZE; size *= 10) {
+		double before = (size <= BENCH_BASELINE_MAX_SIZE) ? bench_run(bench_list, size, &sink) : 0;
+		double after = bench_run(bench_deque, size, &sink);
+		printf("%8" PRIu32 ", %9.2f, %7.2f\n", size, before, after);
+	}
+
+	printf("(checksum %" PRIu64 ")\n", sink);
+	return EXIT_SUCCESS;
+}
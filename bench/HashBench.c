@@ -0,0 +1,82 @@
+/**
+ * Throughput of the string hash functions over key lengths from 8 to 4096 bytes.
+ *
+ * The previous DJB2 hash is kept here as a baseline.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GenericValue.h"
+
+#define BENCH_KEY_COUNT		64
+#define BENCH_TOTAL_BYTES	(64 * 1024 * 1024)
+
+uint32_t bench_hashDjb2(char *string) {
+	uint32_t hash = 5381;
+	uint32_t c;
+
+	for (int i = 0; string[i] != '\0'; i++) {
+		c = string[i];
+		hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+	}
+
+	return hash;
+}
+
+uint32_t bench_hashBytes(char *string) {
+	return gvalue_hashBytes(string, strlen(string));
+}
+
+// Returns the throughput in MB/s.
+double bench_run(uint32_t (*func)(char *), char **keys, size_t length, uint32_t *sink) {
+	size_t rounds = BENCH_TOTAL_BYTES / (length * BENCH_KEY_COUNT) + 1;
+	uint32_t hash = 0;
+
+	clock_t start = clock();
+	for (size_t r = 0; r < rounds; r++) {
+		for (int k = 0; k < BENCH_KEY_COUNT; k++) {
+			hash += func(keys[k]);
+		}
+	}
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	*sink += hash;
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return (double) rounds * BENCH_KEY_COUNT * length / seconds / (1024 * 1024);
+}
+
+int main(void) {
+	char *keys[BENCH_KEY_COUNT];
+	uint32_t sink = 0;
+
+	srand(1);
+	puts("Key length, DJB2 MB/s, gvalue_hashString MB/s, gvalue_hashBytes MB/s");
+
+	for (size_t length = 8; length <= 4096; length *= 2) {
+		for (int k = 0; k < BENCH_KEY_COUNT; k++) {
+			keys[k] = malloc(length + 1);
+			for (size_t i = 0; i < length; i++) {
+				keys[k][i] = (char) ('!' + rand() % 94);
+			}
+			keys[k][length] = '\0';
+		}
+
+		double djb2 = bench_run(bench_hashDjb2, keys, length, &sink);
+		double string = bench_run(gvalue_hashString, keys, length, &sink);
+		double bytes = bench_run(bench_hashBytes, keys, length, &sink);
+		printf("%4zu, %9.0f, %9.0f, %9.0f\n", length, djb2, string, bytes);
+
+		for (int k = 0; k < BENCH_KEY_COUNT; k++) {
+			free(keys[k]);
+		}
+	}
+
+	printf("(checksum %" PRIu32 ")\n", sink);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/**
+ * Throughput of converting a list of numeric strings into a list of numbers.
+ *
+ * The previous per-value conversions of gvalue_tryGetLong (atol, then printing the number back to
+ * check the form) and gvalue_tryGetDouble (strtod) are kept here as a baseline.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GenericList.h"
+
+#define BENCH_VALUE_COUNT	(2 * 1000 * 1000)
+
+struct glist_list *bench_tryGetLongEach(struct glist_list *strings) {
+	struct glist_list *numbers = glist_create(gvalue.longType);
+	char buffer[21];
+
+	for (uint32_t i = 0; i < strings->size; i++) {
+		char *chars = strings->nodes[i].value.primitive.stringValue;
+		int64_t value = (int64_t) atol(chars);
+		sprintf(buffer, "%" PRIi64, value);
+		glist_add(numbers, gvalue_getLong(strcmp(buffer, chars) == 0 ? value : 0));
+	}
+	return numbers;
+}
+
+struct glist_list *bench_tryGetDoubleEach(struct glist_list *strings) {
+	struct glist_list *numbers = glist_create(gvalue.doubleType);
+
+	for (uint32_t i = 0; i < strings->size; i++) {
+		char *chars = strings->nodes[i].value.primitive.stringValue;
+		char *endPtr;
+		double value = strtod(chars, &endPtr);
+		glist_add(numbers, gvalue_getDouble((endPtr != chars && *endPtr == '\0') ? value : 0));
+	}
+	return numbers;
+}
+
+struct glist_list *bench_parseLongs(struct glist_list *strings) {
+	return glist_parseNumbers(strings, gvalue.longType, NULL);
+}
+
+struct glist_list *bench_parseDoubles(struct glist_list *strings) {
+	return glist_parseNumbers(strings, gvalue.doubleType, NULL);
+}
+
+// Returns the throughput in million values per second.
+double bench_run(struct glist_list *(*func)(struct glist_list *), struct glist_list *strings, double *sink) {
+	clock_t start = clock();
+	struct glist_list *numbers = func(strings);
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	for (uint32_t i = 0; i < numbers->size; i += 997) {
+		*sink += gvalue_doubleValue(numbers->nodes[i].value);
+	}
+	glist_free(numbers);
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return strings->size / seconds / 1e6;
+}
+
+struct glist_list *bench_createStrings(int kind) {
+	struct glist_list *strings = glist_create(gvalue.stringType);
+	char buffer[64];
+
+	for (int i = 0; i < BENCH_VALUE_COUNT; i++) {
+		switch (kind) {
+		case 0:
+			sprintf(buffer, "%d", rand() % 100000);
+			break;
+		case 1:
+			sprintf(buffer, "%" PRIi64, ((int64_t) rand() << 31 | rand()) * ((rand() % 2) ? 1 : -1));
+			break;
+		case 2:
+			sprintf(buffer, "%.2f", (rand() % 10000000) / 100.0);
+			break;
+		default:
+			sprintf(buffer, "%.17g", (double) rand() / RAND_MAX * 1e-3 * (rand() % 1000000));
+			break;
+		}
+		char *copy = malloc(strlen(buffer) + 1);
+		strcpy(copy, buffer);
+		glist_add1(strings, gvalue_getString(copy), true);
+	}
+	return strings;
+}
+
+int main(void) {
+	const char *names[] = { "short integers", "long integers", "prices", "17-digit doubles" };
+	double sink = 0;
+
+	srand(1);
+	puts("Strings, per-value Mvalues/s, glist_parseNumbers Mvalues/s");
+
+	for (int kind = 0; kind < 4; kind++) {
+		struct glist_list *strings = bench_createStrings(kind);
+		double before;
+		double after;
+		if (kind < 2) {
+			before = bench_run(bench_tryGetLongEach, strings, &sink);
+			after = bench_run(bench_parseLongs, strings, &sink);
+		}
+		else {
+			before = bench_run(bench_tryGetDoubleEach, strings, &sink);
+			after = bench_run(bench_parseDoubles, strings, &sink);
+		}
+		printf("%-16s, %6.1f, %6.1f\n", names[kind], before, after);
+		glist_free(strings);
+	}
+
+	printf("(checksum %g)\n", sink);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+/**
+ * Removing every tenth value of a long list, like a queue cleanup that drops expired entries.
+ *
+ * The previous way, glist_remove called once per value with the tail shifted one node at a time, is
+ * kept here as a baseline for the sizes where it finishes in reasonable time.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "GenericList.h"
+
+#define BENCH_BASELINE_MAX_SIZE	(100 * 1000)
+#define BENCH_MAX_SIZE			(10 * 1000 * 1000)
+
+bool bench_isExpired(struct gvalue_value value, void *context) {
+	return value.primitive.longValue % 10 == *(int64_t *) context;
+}
+
+void bench_removeEach(struct glist_list *list) {
+	for (uint32_t i = 0; i < list->size; i++) {
+		if (list->nodes[i].value.primitive.longValue % 10 == 0) {
+			for (uint32_t j = i; j < list->size - 1; j++) {
+				list->nodes[j] = list->nodes[j + 1];
+			}
+			list->size--;
+			i--;
+		}
+	}
+}
+
+void bench_removeIf(struct glist_list *list) {
+	int64_t expired = 0;
+	glist_removeIf(list, bench_isExpired, &expired);
+}
+
+// Returns the time in milliseconds.
+double bench_run(void (*func)(struct glist_list *), uint32_t size, uint64_t *sink) {
+	struct glist_config config = { .dataType = gvalue.longType, .capacity = size };
+	struct glist_list *list = glist_create1(config);
+	for (uint32_t i = 0; i < size; i++) {
+		glist_add(list, gvalue_getLong(i));
+	}
+
+	clock_t start = clock();
+	func(list);
+	double milliseconds = (double) (clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+	*sink += list->size;
+	glist_free(list);
+	return milliseconds;
+}
+
+int main(void) {
+	uint64_t sink = 0;
+
+	puts("Size, one by one ms, glist_removeIf ms");
+
+	for (uint32_t size = 10000; size <= BENCH_MAX_SIZE; size *= 10) {
+		double before = (size <= BENCH_BASELINE_MAX_SIZE) ? bench_run(bench_removeEach, size, &sink) : 0;
+		double after = bench_run(bench_removeIf, size, &sink);
+		printf("%8" PRIu32 ", %9.2f, %7.2f\n", size, before, after);
+	}
+
+	printf("(checksum %" PRIu64 ")\n", sink);
+	return EXIT_SUCCESS;
+}
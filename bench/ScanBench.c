@@ -0,0 +1,82 @@
+/**
+ * Linear search for values that are not in int, long and byte lists of 64K values.
+ *
+ * The previous loop of glist_tryGetIndex, which calls cmpFunc for every node, is kept here as a
+ * baseline. The last column searches the same values in a list with packedStorage.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "GenericList.h"
+
+#define BENCH_LIST_SIZE		(64 * 1024)
+#define BENCH_SEARCH_COUNT	2000
+
+bool bench_tryGetIndexEach(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex) {
+	for (uint32_t i = 0; i < list->size; i++) {
+		if (list->config.cmpFunc(value, list->nodes[i].value) == 0) {
+			*outIndex = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns the throughput in million values compared per second.
+double bench_run(bool (*func)(struct glist_list *, struct gvalue_value, uint32_t *), struct glist_list *list,
+		struct gvalue_value missing, uint32_t *sink) {
+	uint32_t index = 0;
+
+	clock_t start = clock();
+	for (int i = 0; i < BENCH_SEARCH_COUNT; i++) {
+		*sink += func(list, missing, &index) ? index : 1;
+	}
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return (double) list->size * BENCH_SEARCH_COUNT / seconds / 1e6;
+}
+
+int main(void) {
+	const struct gvalue_type *types[] = { gvalue.intType, gvalue.longType, gvalue.byteType };
+	uint32_t sink = 0;
+
+	puts("Type, cmpFunc per node Mvalues/s, glist_tryGetIndex Mvalues/s, packed glist_tryGetIndex Mvalues/s");
+
+	for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+		struct glist_list *list = glist_create(types[t]);
+		struct glist_config config = { .dataType = types[t], .packedStorage = true };
+		struct glist_list *packed = glist_create1(config);
+		struct gvalue_value missing;
+		for (uint32_t i = 0; i < BENCH_LIST_SIZE; i++) {
+			if (types[t] == gvalue.intType) {
+				glist_add(list, gvalue_getInt((int32_t) i));
+				missing = gvalue_getInt(-1);
+			}
+			else if (types[t] == gvalue.longType) {
+				glist_add(list, gvalue_getLong(i));
+				missing = gvalue_getLong(-1);
+			}
+			else {
+				glist_add(list, gvalue_getByte((int8_t) (i % 100)));
+				missing = gvalue_getByte(-1);
+			}
+			glist_add(packed, *glist_get(list, i));
+		}
+
+		double before = bench_run(bench_tryGetIndexEach, list, missing, &sink);
+		double after = bench_run(glist_tryGetIndex, list, missing, &sink);
+		double afterPacked = bench_run(glist_tryGetIndex, packed, missing, &sink);
+		printf("%-4s, %7.1f, %7.1f, %7.1f\n", types[t]->name, before, after, afterPacked);
+		glist_free(packed);
+		glist_free(list);
+	}
+
+	printf("(checksum %" PRIu32 ")\n", sink);
+	return EXIT_SUCCESS;
+}
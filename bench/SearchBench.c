@@ -0,0 +1,97 @@
+/**
+ * Lookups in long and string lists of 1K to 16M values.
+ *
+ * The previous way to look a value up, the linear scan of glist_tryGetIndex on a list that is not kept
+ * sorted, is kept here as a baseline for the sizes where it finishes in reasonable time.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GenericList.h"
+
+#define BENCH_LOOKUP_COUNT		(1000 * 1000)
+#define BENCH_LINEAR_MAX_SIZE	(64 * 1024)
+#define BENCH_LINEAR_LOOKUPS	(20 * 1000)
+
+// Every second probe is in the list.
+struct gvalue_value bench_probe(const struct gvalue_type *type, uint32_t size, uint32_t i, char *buffer) {
+	uint64_t n = ((uint64_t) i * 2654435761u) % (2 * (uint64_t) size);
+	if (type == gvalue.longType) {
+		return gvalue_getLong((int64_t) n * 3);
+	}
+	sprintf(buffer, "key-%" PRIu64, n * 3);
+	return gvalue_getSString(buffer);
+}
+
+// Returns the throughput in million lookups per second.
+double bench_run(int method, struct glist_list *list, struct glist_eytzinger *tree, uint32_t lookups, uint32_t *sink) {
+	char buffer[32];
+	uint32_t index = 0;
+
+	clock_t start = clock();
+	for (uint32_t i = 0; i < lookups; i++) {
+		struct gvalue_value value = bench_probe(list->config.dataType, list->size / 2, i, buffer);
+		bool found = (method == 0) ? glist_tryGetIndex(list, value, &index)
+				: (method == 1) ? glist_binarySearch(list, value, &index)
+				: glist_eytzingerSearch(tree, value, &index);
+		*sink += found ? index : 1;
+	}
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return lookups / seconds / 1e6;
+}
+
+int main(void) {
+	const struct gvalue_type *types[] = { gvalue.longType, gvalue.sstringType };
+	uint32_t sink = 0;
+	char buffer[32];
+
+	puts("Type, size, linear Mlookups/s, binary search Mlookups/s, Eytzinger Mlookups/s");
+
+	for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+		for (uint32_t size = 1024; size <= 16 * 1024 * 1024; size *= 4) {
+			// Values 0, 3, 6 and so on, in random order for the linear scan.
+			struct glist_config config = { .dataType = types[t], .capacity = size };
+			struct glist_list *list = glist_create1(config);
+			for (uint32_t i = 0; i < size; i++) {
+				if (types[t] == gvalue.longType) {
+					glist_add(list, gvalue_getLong((int64_t) i * 3));
+				}
+				else {
+					sprintf(buffer, "key-%" PRIu32, i * 3);
+					glist_add(list, gvalue_getSString(buffer));
+				}
+			}
+			for (uint32_t i = size - 1; i > 0; i--) {
+				uint32_t j = (uint32_t) (((uint64_t) rand() * RAND_MAX + rand()) % (i + 1));
+				struct glist_node swapped = list->nodes[i];
+				list->nodes[i] = list->nodes[j];
+				list->nodes[j] = swapped;
+			}
+
+			double linear = 0;
+			if (size <= BENCH_LINEAR_MAX_SIZE) {
+				linear = bench_run(0, list, NULL, BENCH_LINEAR_LOOKUPS, &sink);
+			}
+
+			glist_sort(list);
+			struct glist_eytzinger *tree = glist_createEytzinger(list);
+			double binary = bench_run(1, list, NULL, BENCH_LOOKUP_COUNT, &sink);
+			double eytzinger = bench_run(2, list, tree, BENCH_LOOKUP_COUNT, &sink);
+
+			printf("%-7s, %8" PRIu32 ", %7.3f, %6.2f, %6.2f\n", types[t]->name, size, linear, binary, eytzinger);
+			glist_freeEytzinger(tree);
+			glist_free(list);
+		}
+	}
+
+	printf("(checksum %" PRIu32 ")\n", sink);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/**
+ * Throughput of glist_sort for long, double and string lists from 1K to 100M values.
+ *
+ * The previous way of sorting, qsort over the nodes with a comparator that calls gvalue_cmp, is kept
+ * here as a baseline. The largest size needs about 10 GB of memory, so by default the benchmark stops
+ * at 10M values. Give the largest size as the first argument to go further, like 100000000.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GenericList.h"
+
+#define BENCH_DEFAULT_MAX_SIZE	(10 * 1000 * 1000)
+#define BENCH_LARGEST_SIZE		(100 * 1000 * 1000)
+
+int bench_cmpNodes(const void *node1, const void *node2) {
+	return gvalue_cmp(((const struct glist_node *) node1)->value, ((const struct glist_node *) node2)->value);
+}
+
+uint64_t bench_random(void) {
+	return ((uint64_t) rand() << 42) ^ ((uint64_t) rand() << 21) ^ (uint64_t) rand();
+}
+
+// A list that shares the nodes of source, so that both sorts start from the same order.
+struct glist_list *bench_copy(struct glist_list *source) {
+	struct glist_config config = { .dataType = source->config.dataType, .capacity = source->size };
+	struct glist_list *list = glist_create1(config);
+	memcpy(list->nodes, source->nodes, sizeof(struct glist_node) * source->size);
+	list->size = source->size;
+	return list;
+}
+
+// Returns the throughput in million values per second.
+double bench_run(struct glist_list *source, bool useQsort, uint64_t *sink) {
+	struct glist_list *list = bench_copy(source);
+
+	clock_t start = clock();
+	if (useQsort) {
+		qsort(list->nodes, list->size, sizeof(struct glist_node), bench_cmpNodes);
+	}
+	else {
+		glist_sort(list);
+	}
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	*sink += gvalue_hash(list->nodes[list->size / 2].value);
+	list->size = 0;
+	glist_free(list);
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return source->size / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+	const struct gvalue_type *types[] = { gvalue.longType, gvalue.doubleType, gvalue.stringType };
+	uint32_t maxSize = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_MAX_SIZE;
+	uint64_t sink = 0;
+
+	if (maxSize > BENCH_LARGEST_SIZE) {
+		maxSize = BENCH_LARGEST_SIZE;
+	}
+
+	srand(1);
+	puts("Type, size, qsort with gvalue_cmp Mvalues/s, glist_sort Mvalues/s");
+
+	for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+		for (uint32_t size = 1000; size <= maxSize; size *= 10) {
+			struct glist_config config = { .dataType = types[t], .capacity = size };
+			struct glist_list *source = glist_create1(config);
+			for (uint32_t i = 0; i < size; i++) {
+				uint64_t r = bench_random();
+				if (types[t] == gvalue.longType) {
+					glist_add(source, gvalue_getLong((int64_t) r));
+				}
+				else if (types[t] == gvalue.doubleType) {
+					glist_add(source, gvalue_getDouble((double) (int64_t) r / 1e6));
+				}
+				else {
+					char *chars = malloc(24);
+					sprintf(chars, "user-%" PRIu64, r % 100000000);
+					glist_add1(source, gvalue_getString(chars), true);
+				}
+			}
+
+			double before = bench_run(source, true, &sink);
+			double after = bench_run(source, false, &sink);
+			printf("%-6s, %9" PRIu32 ", %7.1f, %7.1f\n", types[t]->name, size, before, after);
+			glist_free(source);
+		}
+	}
+
+	printf("(checksum %" PRIu64 ")\n", sink);
+	return EXIT_SUCCESS;
+}
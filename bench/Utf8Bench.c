@@ -0,0 +1,158 @@
+/**
+ * Throughput of the UTF-8 transcoding in both directions, over mostly-ASCII and mixed text.
+ *
+ * A straightforward transcoder that handles one code point at a time is kept here as a baseline.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#include "GenericValue.h"
+
+#define BENCH_TEXT_LENGTH	(64 * 1024)
+#define BENCH_TOTAL_CHARS	(256 * 1024 * 1024)
+
+size_t bench_encodeScalar(const wchar_t *source, size_t count, char *out) {
+	unsigned char *bytes = (unsigned char *) out;
+	size_t j = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t c = (uint32_t) source[i];
+		if (c < 0x80) {
+			bytes[j++] = (unsigned char) c;
+		}
+		else if (c < 0x800) {
+			bytes[j++] = (unsigned char) (0xC0 | (c >> 6));
+			bytes[j++] = (unsigned char) (0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000) {
+			bytes[j++] = (unsigned char) (0xE0 | (c >> 12));
+			bytes[j++] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+			bytes[j++] = (unsigned char) (0x80 | (c & 0x3F));
+		}
+		else {
+			bytes[j++] = (unsigned char) (0xF0 | (c >> 18));
+			bytes[j++] = (unsigned char) (0x80 | ((c >> 12) & 0x3F));
+			bytes[j++] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+			bytes[j++] = (unsigned char) (0x80 | (c & 0x3F));
+		}
+	}
+
+	return j;
+}
+
+size_t bench_decodeScalar(const char *source, size_t length, wchar_t *out) {
+	const unsigned char *bytes = (const unsigned char *) source;
+	size_t j = 0;
+
+	for (size_t i = 0; i < length;) {
+		uint32_t c = bytes[i];
+		if (c < 0x80) {
+			i += 1;
+		}
+		else if (c < 0xE0) {
+			c = ((c & 0x1F) << 6) | (bytes[i + 1] & 0x3F);
+			i += 2;
+		}
+		else if (c < 0xF0) {
+			c = ((c & 0x0F) << 12) | ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F);
+			i += 3;
+		}
+		else {
+			c = ((c & 0x07) << 18) | ((bytes[i + 1] & 0x3F) << 12) | ((bytes[i + 2] & 0x3F) << 6)
+					| (bytes[i + 3] & 0x3F);
+			i += 4;
+		}
+		out[j++] = (wchar_t) c;
+	}
+
+	return j;
+}
+
+// Fills text with BENCH_TEXT_LENGTH characters, of which about one in every nonAsciiEvery is outside ASCII.
+void bench_fillText(wchar_t *text, int nonAsciiEvery) {
+	// Latin, Cyrillic, CJK and Euro sign, all in the Basic Multilingual Plane.
+	static const wchar_t others[] = { 0x00E9, 0x00FC, 0x0436, 0x044F, 0x4E2D, 0x6587, 0x20AC };
+
+	for (size_t i = 0; i < BENCH_TEXT_LENGTH; i++) {
+		if (rand() % nonAsciiEvery == 0) {
+			text[i] = others[rand() % (sizeof(others) / sizeof(others[0]))];
+		}
+		else {
+			text[i] = (wchar_t) ((rand() % 8 == 0) ? ' ' : 'a' + rand() % 26);
+		}
+	}
+}
+
+// Returns the throughput in million characters per second.
+double bench_encode(size_t (*func)(const wchar_t *, size_t, char *), const wchar_t *text, char *out, size_t *sink) {
+	size_t rounds = BENCH_TOTAL_CHARS / BENCH_TEXT_LENGTH;
+
+	clock_t start = clock();
+	for (size_t r = 0; r < rounds; r++) {
+		*sink += func(text, BENCH_TEXT_LENGTH, out);
+		*sink += (unsigned char) out[r % BENCH_TEXT_LENGTH];
+	}
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return (double) rounds * BENCH_TEXT_LENGTH / seconds / 1e6;
+}
+
+double bench_decode(size_t (*func)(const char *, size_t, wchar_t *), const char *text, size_t length, wchar_t *out,
+		size_t *sink) {
+	size_t rounds = BENCH_TOTAL_CHARS / BENCH_TEXT_LENGTH;
+
+	clock_t start = clock();
+	for (size_t r = 0; r < rounds; r++) {
+		*sink += func(text, length, out);
+		*sink += (size_t) out[r % BENCH_TEXT_LENGTH];
+	}
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return (double) rounds * BENCH_TEXT_LENGTH / seconds / 1e6;
+}
+
+int main(void) {
+	struct { const char *name; int nonAsciiEvery; } corpora[] = {
+			{ "ascii", 1 << 30 }, { "mostly-ascii", 100 }, { "mixed", 3 }
+	};
+	wchar_t *text = malloc(sizeof(wchar_t) * BENCH_TEXT_LENGTH);
+	wchar_t *decoded = malloc(sizeof(wchar_t) * BENCH_TEXT_LENGTH * GVALUE_UTF8_MAX_BYTES_PER_WCHAR);
+	char *utf8 = malloc(BENCH_TEXT_LENGTH * GVALUE_UTF8_MAX_BYTES_PER_WCHAR);
+	size_t sink = 0;
+
+	srand(1);
+	puts("Corpus, scalar encode Mchar/s, gvalue_encodeUtf8 Mchar/s, scalar decode Mchar/s, gvalue_decodeUtf8 Mchar/s");
+
+	for (size_t c = 0; c < sizeof(corpora) / sizeof(corpora[0]); c++) {
+		bench_fillText(text, corpora[c].nonAsciiEvery);
+		size_t length = gvalue_encodeUtf8(text, BENCH_TEXT_LENGTH, utf8);
+
+		double scalarEncode = bench_encode(bench_encodeScalar, text, utf8, &sink);
+		double encode = bench_encode(gvalue_encodeUtf8, text, utf8, &sink);
+		double scalarDecode = bench_decode(bench_decodeScalar, utf8, length, decoded, &sink);
+		double decode = bench_decode(gvalue_decodeUtf8, utf8, length, decoded, &sink);
+		printf("%-12s, %7.0f, %7.0f, %7.0f, %7.0f\n", corpora[c].name, scalarEncode, encode, scalarDecode, decode);
+
+		if (memcmp(decoded, text, sizeof(wchar_t) * BENCH_TEXT_LENGTH) != 0) {
+			puts("Error: Utf8Bench: round trip changed the text");
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("(checksum %zu)\n", sink);
+	free(utf8);
+	free(decoded);
+	free(text);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/**
+ * Puts into a map with a write-ahead log, at different group commit sizes.
+ *
+ * A map without a log is the baseline. A group commit size of 1 syncs the log on every put, which is
+ * what the log would cost without group commit. That row only does a hundredth of the puts, so that it
+ * finishes in reasonable time, and is scaled like the others to puts per second. The time is wall-clock
+ * time, as syncing mostly waits for the disk.
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "GenericMapWal.h"
+
+#define BENCH_PUT_COUNT		(1000 * 1000)
+#define BENCH_LOG_PATH		"WalBench.log"
+#define BENCH_SNAPSHOT_PATH	"WalBench.snap"
+
+double bench_seconds(void) {
+#if defined(_WIN32)
+	return (double) clock() / CLOCKS_PER_SEC;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+#endif
+}
+
+// Puts count int keys with string values. With groupCommitSize 0 the map has no log.
+// Returns the throughput in thousand puts per second.
+double bench_run(uint32_t groupCommitSize, uint32_t count, uint64_t *sink) {
+	struct gmap_config mapConfig = { .keyType = gvalue.intType };
+	struct gwal_config config = { .logPath = BENCH_LOG_PATH, .snapshotPath = BENCH_SNAPSHOT_PATH,
+			.groupCommitSize = groupCommitSize };
+	struct gwal_log *wal = NULL;
+	struct gmap_map *map;
+
+	remove(BENCH_LOG_PATH);
+	remove(BENCH_SNAPSHOT_PATH);
+
+	if (groupCommitSize > 0) {
+		wal = gwal_open(mapConfig, config);
+		map = wal->map;
+	}
+	else {
+		map = gmap_create1(mapConfig);
+	}
+
+	double start = bench_seconds();
+	for (uint32_t i = 0; i < count; i++) {
+		gmap_put(map, gvalue_getInt((int32_t) i), gvalue_getString("value"));
+	}
+	if (wal != NULL) {
+		gwal_close(wal);
+	}
+	double seconds = bench_seconds() - start;
+
+	*sink += map->size;
+	gmap_free(map);
+
+	remove(BENCH_LOG_PATH);
+	remove(BENCH_SNAPSHOT_PATH);
+
+	if (seconds <= 0) {
+		seconds = 1e-9;
+	}
+	return count / seconds / 1e3;
+}
+
+int main(void) {
+	uint32_t groupCommitSizes[] = { 1, 16, 256, GWAL_DEFAULT_GROUP_COMMIT_SIZE, 16 * 1024 };
+	uint64_t sink = 0;
+
+	double baseline = bench_run(0, BENCH_PUT_COUNT, &sink);
+	puts("Group commit size, Kputs/s, Slowdown over no log");
+	printf("%17s, %9.1f, %5.1fx\n", "no log", baseline, 1.0);
+
+	for (size_t g = 0; g < sizeof(groupCommitSizes) / sizeof(groupCommitSizes[0]); g++) {
+		uint32_t count = (groupCommitSizes[g] == 1) ? BENCH_PUT_COUNT / 100 : BENCH_PUT_COUNT;
+		double throughput = bench_run(groupCommitSizes[g], count, &sink);
+		printf("%17" PRIu32 ", %9.1f, %5.1fx\n", groupCommitSizes[g], throughput, baseline / throughput);
+	}
+
+	printf("(checksum %" PRIu64 ")\n", sink);
+	return EXIT_SUCCESS;
+}
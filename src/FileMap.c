@@ -0,0 +1,576 @@
+/**
+ * Hash map that lives in a memory-mapped file, for data sets that do not fit in memory.
+ *
+ * The slot array, the fixed-size entries and an overflow region for string payloads are all part of the
+ * file and are read and written directly through the mapping. Keys are hashed with gvalue_hash and
+ * compared with gvalue_cmp, and slots are derived exactly like in GenericMap, so a key behaves the same
+ * in both maps. Growing any region extends the file and remaps it.
+ *
+ * Durability points are explicit: fmap_sync flushes the mapping with msync. A crash in between sync
+ * points can leave the file inconsistent.
+ *
+ * Only available on platforms with mmap.
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FileMap.h"
+
+#define FMAP_MAGIC				"GFILEMAP"
+#define FMAP_BYTE_ORDER_MARK	0x01020304
+#define FMAP_ANY_TYPE			0xFF
+
+// Defined in GenericMap.c and GenericMapIO.c.
+extern uint32_t private_gmap_slot(uint32_t hashCode, uint32_t capacity);
+extern bool private_gmap_isStringType(const struct gvalue_type *type);
+extern size_t private_gmap_stringPayloadSize(struct gvalue_value value);
+extern bool private_gmap_encodeScalar(struct gvalue_value value, uint64_t *outBits);
+extern bool private_gmap_decodeValue(int typeCode, uint64_t bits, char *strings, uint64_t stringSectionSize,
+		struct gvalue_value *outValue);
+
+// OOP class object.
+struct fmap_class fmap = {
+
+		// Constructors.
+		.open = fmap_open,
+
+		// Basic operations.
+		.put = fmap_put,
+		.get = fmap_get,
+		.containsKey = fmap_containsKey,
+		.remove = fmap_remove,
+
+		// More operations.
+		.each = fmap_each,
+		.sync = fmap_sync,
+
+		// Destructor.
+		.close = fmap_close
+
+};
+
+/*******************************************************************************************/
+
+// Platform-specific file mapping.
+
+#if defined(_WIN32)
+
+bool private_fmap_openFile(struct fmap_map *map, const char *path, size_t *outSize) {
+	printf("Error: fmap: Memory-mapped files are not supported on this platform\n");
+	return false;
+}
+
+bool private_fmap_mapFile(struct fmap_map *map, size_t size) {
+	return false;
+}
+
+void private_fmap_unmapFile(struct fmap_map *map) {
+}
+
+bool private_fmap_syncFile(struct fmap_map *map) {
+	return false;
+}
+
+void private_fmap_closeFile(struct fmap_map *map) {
+}
+
+#else
+
+bool private_fmap_openFile(struct fmap_map *map, const char *path, size_t *outSize) {
+	map->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (map->fd < 0) {
+		printf("Error: fmap: Cannot open %s\n", path);
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(map->fd, &st) != 0) {
+		close(map->fd);
+		return false;
+	}
+
+	*outSize = (size_t) st.st_size;
+	return true;
+}
+
+// Extends the file if needed and maps it as a whole.
+bool private_fmap_mapFile(struct fmap_map *map, size_t size) {
+	struct stat st;
+	if (fstat(map->fd, &st) != 0 || ((size_t) st.st_size < size && ftruncate(map->fd, (off_t) size) != 0)) {
+		printf("Error: fmap: Cannot extend file to %lu bytes\n", (unsigned long) size);
+		return false;
+	}
+
+	void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+	if (base == MAP_FAILED) {
+		printf("Error: fmap: Cannot map %lu bytes\n", (unsigned long) size);
+		return false;
+	}
+
+	map->base = (unsigned char *) base;
+	map->mappedSize = size;
+	map->header = (struct fmap_header *) base;
+	return true;
+}
+
+void private_fmap_unmapFile(struct fmap_map *map) {
+	munmap(map->base, map->mappedSize);
+	map->base = NULL;
+	map->header = NULL;
+}
+
+bool private_fmap_syncFile(struct fmap_map *map) {
+	return msync(map->base, map->mappedSize, MS_SYNC) == 0;
+}
+
+void private_fmap_closeFile(struct fmap_map *map) {
+	close(map->fd);
+}
+
+#endif
+
+/*******************************************************************************************/
+
+// Layout.
+
+size_t private_fmap_slotsOffset(void) {
+	return sizeof(struct fmap_header);
+}
+
+size_t private_fmap_entriesOffset(uint32_t capacity) {
+	return private_fmap_slotsOffset() + ((((size_t) capacity * sizeof(uint32_t)) + 7) & ~((size_t) 7));
+}
+
+size_t private_fmap_overflowOffset(uint32_t capacity, uint32_t entryCapacity) {
+	return private_fmap_entriesOffset(capacity) + (size_t) entryCapacity * sizeof(struct fmap_entry);
+}
+
+size_t private_fmap_fileSize(uint32_t capacity, uint32_t entryCapacity, uint64_t overflowCapacity) {
+	return private_fmap_overflowOffset(capacity, entryCapacity) + (size_t) overflowCapacity;
+}
+
+void private_fmap_attach(struct fmap_map *map) {
+	struct fmap_header *header = map->header;
+	map->slots = (uint32_t *) (map->base + private_fmap_slotsOffset());
+	map->entries = (struct fmap_entry *) (map->base + private_fmap_entriesOffset(header->capacity));
+	map->overflow = (char *) (map->base + private_fmap_overflowOffset(header->capacity, header->entryCapacity));
+}
+
+void private_fmap_rebuildSlots(struct fmap_map *map) {
+	uint32_t capacity = map->header->capacity;
+	memset(map->slots, 0, sizeof(uint32_t) * capacity);
+
+	for (uint32_t i = 0; i < map->header->entryCount; i++) {
+		struct fmap_entry *entry = &(map->entries[i]);
+		if (entry->inUse) {
+			uint32_t slot = private_gmap_slot(entry->hashCode, capacity);
+			entry->next = map->slots[slot];
+			map->slots[slot] = i + 1;
+		}
+	}
+}
+
+// Regions only ever grow, so each of them moves towards the end of the file. They are moved back to
+// front so that nothing is overwritten before it has been moved.
+bool private_fmap_resize(struct fmap_map *map, uint32_t capacity, uint32_t entryCapacity, uint64_t overflowCapacity) {
+	struct fmap_header old = *(map->header);
+	size_t oldEntriesOffset = private_fmap_entriesOffset(old.capacity);
+	size_t oldOverflowOffset = private_fmap_overflowOffset(old.capacity, old.entryCapacity);
+
+	private_fmap_unmapFile(map);
+	if (private_fmap_mapFile(map, private_fmap_fileSize(capacity, entryCapacity, overflowCapacity)) == false) {
+		// Put the old mapping back so the map stays usable.
+		private_fmap_mapFile(map, private_fmap_fileSize(old.capacity, old.entryCapacity, old.overflowCapacity));
+		private_fmap_attach(map);
+		return false;
+	}
+
+	memmove(map->base + private_fmap_overflowOffset(capacity, entryCapacity), map->base + oldOverflowOffset,
+			(size_t) old.overflowUsed);
+	memmove(map->base + private_fmap_entriesOffset(capacity), map->base + oldEntriesOffset,
+			(size_t) old.entryCount * sizeof(struct fmap_entry));
+
+	map->header->capacity = capacity;
+	map->header->entryCapacity = entryCapacity;
+	map->header->overflowCapacity = overflowCapacity;
+	private_fmap_attach(map);
+
+	if (capacity != old.capacity) {
+		private_fmap_rebuildSlots(map);
+	}
+
+	return true;
+}
+
+/*******************************************************************************************/
+
+// Entries.
+
+bool private_fmap_checkType(const struct gvalue_type *type) {
+	uint64_t bits;
+	struct gvalue_value value = { .type = type };
+	return private_gmap_isStringType(type) || private_gmap_encodeScalar(value, &bits);
+}
+
+struct gvalue_value private_fmap_decode(struct fmap_map *map, int typeCode, uint64_t bits) {
+	struct gvalue_value value;
+	private_gmap_decodeValue(typeCode, bits, map->overflow, map->header->overflowUsed, &value);
+	return value;
+}
+
+// Space must have been reserved beforehand.
+uint64_t private_fmap_encode(struct fmap_map *map, struct gvalue_value value) {
+	uint64_t bits = 0;
+
+	if (private_gmap_isStringType(value.type) == false) {
+		private_gmap_encodeScalar(value, &bits);
+		return bits;
+	}
+
+	size_t size = private_gmap_stringPayloadSize(value);
+	char *target = map->overflow + map->header->overflowUsed;
+
+	memset(target, 0, size);
+	if (value.type->code == GVALUE_TYPE_BYTES) {
+		uint64_t length = value.primitive.bytesValue.length;
+		memcpy(target, &length, sizeof(length));
+		memcpy(target + sizeof(length), value.primitive.bytesValue.data, value.primitive.bytesValue.length);
+	}
+	else if (value.type->code != GVALUE_TYPE_WSTRING) {
+		memcpy(target, gvalue_stringChars(&value), strlen(gvalue_stringChars(&value)));
+	}
+	else {
+		memcpy(target, value.primitive.wstringValue, wcslen(value.primitive.wstringValue) * sizeof(wchar_t));
+	}
+
+	bits = map->header->overflowUsed;
+	map->header->overflowUsed += size;
+	return bits;
+}
+
+void private_fmap_discard(struct fmap_map *map, int typeCode, uint64_t bits) {
+	if (private_gmap_isStringType(gvalue_getType(typeCode))) {
+		map->header->overflowGarbage += private_gmap_stringPayloadSize(private_fmap_decode(map, typeCode, bits));
+	}
+}
+
+// Returns a pointer to the link that refers to the entry with the given key, or to the 0 at the end of
+// the chain if there is no such entry.
+uint32_t *private_fmap_findLink(struct fmap_map *map, struct gvalue_value key, uint32_t hashCode) {
+	uint32_t *link = &(map->slots[private_gmap_slot(hashCode, map->header->capacity)]);
+
+	while (*link != 0) {
+		struct fmap_entry *entry = &(map->entries[*link - 1]);
+		if (entry->hashCode == hashCode
+				&& gvalue_cmp(private_fmap_decode(map, entry->keyTypeCode, entry->key), key) == 0) {
+			return link;
+		}
+		link = &(entry->next);
+	}
+
+	return link;
+}
+
+// Makes sure a put of this key and value will not need to grow anything.
+bool private_fmap_reserve(struct fmap_map *map, struct gvalue_value key, struct gvalue_value value, bool isNewKey) {
+	struct fmap_header *header = map->header;
+	uint32_t capacity = header->capacity;
+	uint32_t entryCapacity = header->entryCapacity;
+	uint64_t overflowCapacity = header->overflowCapacity;
+	uint64_t needed = header->overflowUsed + private_gmap_stringPayloadSize(value);
+
+	if (isNewKey) {
+		needed += private_gmap_stringPayloadSize(key);
+
+		if (((uint64_t) header->size + 1) * 1000 / capacity >= GMAP_DEFAULT_LOAD_FACTOR_OVER_THOUSAND) {
+			capacity *= 2;
+		}
+
+		if (header->freeEntry == 0 && header->entryCount == entryCapacity) {
+			entryCapacity *= 2;
+		}
+	}
+
+	while (needed > overflowCapacity) {
+		overflowCapacity *= 2;
+	}
+
+	if (capacity == header->capacity && entryCapacity == header->entryCapacity
+			&& overflowCapacity == header->overflowCapacity) {
+		return true;
+	}
+
+	return private_fmap_resize(map, capacity, entryCapacity, overflowCapacity);
+}
+
+/*******************************************************************************************/
+
+// Constructors.
+
+void private_fmap_initHeader(struct fmap_header *header, const struct gvalue_type *keyType,
+		const struct gvalue_type *valueType) {
+
+	memset(header, 0, sizeof(struct fmap_header));
+	memcpy(header->magic, FMAP_MAGIC, sizeof(header->magic));
+	header->version = FMAP_VERSION;
+	header->byteOrderMark = FMAP_BYTE_ORDER_MARK;
+	header->hashVersion = GVALUE_HASH_VERSION;
+	header->keyTypeCode = (uint8_t) keyType->code;
+	header->valueTypeCode = (valueType == NULL) ? FMAP_ANY_TYPE : (uint8_t) valueType->code;
+	header->wcharSize = sizeof(wchar_t);
+	header->capacity = FMAP_DEFAULT_INITIAL_CAPACITY;
+	header->entryCapacity = FMAP_DEFAULT_INITIAL_CAPACITY;
+	header->overflowCapacity = FMAP_DEFAULT_OVERFLOW_CAPACITY;
+}
+
+bool private_fmap_checkHeader(struct fmap_map *map, size_t fileSize) {
+	struct fmap_header *header = map->header;
+	uint8_t valueTypeCode = (map->valueType == NULL) ? FMAP_ANY_TYPE : (uint8_t) map->valueType->code;
+
+	if (memcmp(header->magic, FMAP_MAGIC, sizeof(header->magic)) != 0 || header->version != FMAP_VERSION) {
+		printf("Error: fmap: Not a file map or unsupported version\n");
+		return false;
+	}
+
+	if (header->byteOrderMark != FMAP_BYTE_ORDER_MARK || header->wcharSize != sizeof(wchar_t)) {
+		printf("Error: fmap: File was written on an incompatible platform\n");
+		return false;
+	}
+
+	if (header->keyTypeCode != map->keyType->code || header->valueTypeCode != valueTypeCode) {
+		printf("Error: fmap: File was created with different key or value types\n");
+		return false;
+	}
+
+	if (header->capacity < 1 || header->entryCapacity < 1 || header->overflowCapacity < 1
+			|| header->entryCount > header->entryCapacity || header->overflowUsed > header->overflowCapacity
+			|| private_fmap_fileSize(header->capacity, header->entryCapacity, header->overflowCapacity) > fileSize) {
+		printf("Error: fmap: File is truncated or corrupt\n");
+		return false;
+	}
+
+	return true;
+}
+
+// Stored hash codes are only valid for the gvalue_hash they were computed with.
+void private_fmap_rehash(struct fmap_map *map) {
+	for (uint32_t i = 0; i < map->header->entryCount; i++) {
+		struct fmap_entry *entry = &(map->entries[i]);
+		if (entry->inUse) {
+			entry->hashCode = gvalue_hash(private_fmap_decode(map, entry->keyTypeCode, entry->key));
+		}
+	}
+
+	private_fmap_rebuildSlots(map);
+	map->header->hashVersion = GVALUE_HASH_VERSION;
+}
+
+// Opens the file at path, or creates it if it does not exist or is empty.
+// valueType may be NULL to allow values of any supported type.
+// Returns NULL on error.
+struct fmap_map *fmap_open(const char *path, const struct gvalue_type *keyType, const struct gvalue_type *valueType) {
+	if (keyType == NULL) {
+		printf("Error: fmap: keyType is required\n");
+		return NULL;
+	}
+
+	if (private_fmap_checkType(keyType) == false || (valueType != NULL && private_fmap_checkType(valueType) == false)) {
+		printf("Error: fmap: Type %s cannot be stored in a file\n",
+				private_fmap_checkType(keyType) ? valueType->name : keyType->name);
+		return NULL;
+	}
+
+	struct fmap_map *map = (struct fmap_map *) malloc(sizeof(struct fmap_map));
+	map->keyType = keyType;
+	map->valueType = valueType;
+
+	size_t fileSize = 0;
+	if (private_fmap_openFile(map, path, &fileSize) == false) {
+		free(map);
+		return NULL;
+	}
+
+	if (fileSize == 0) {
+		struct fmap_header header;
+		private_fmap_initHeader(&header, keyType, valueType);
+
+		if (private_fmap_mapFile(map, private_fmap_fileSize(header.capacity, header.entryCapacity, header.overflowCapacity))) {
+			*(map->header) = header;
+			private_fmap_attach(map);
+			memset(map->slots, 0, sizeof(uint32_t) * header.capacity);
+			return map;
+		}
+	}
+	else if (fileSize >= sizeof(struct fmap_header) && private_fmap_mapFile(map, fileSize)) {
+		if (private_fmap_checkHeader(map, fileSize)) {
+			private_fmap_attach(map);
+
+			if (map->header->hashVersion != GVALUE_HASH_VERSION) {
+				private_fmap_rehash(map);
+			}
+
+			return map;
+		}
+
+		private_fmap_unmapFile(map);
+	}
+	else {
+		printf("Error: fmap: Not a file map\n");
+	}
+
+	private_fmap_closeFile(map);
+	free(map);
+	return NULL;
+}
+
+/*******************************************************************************************/
+
+// Basic operations.
+
+// Returns true if a new key was added, false if an existing value was replaced or on error.
+bool fmap_put(struct fmap_map *map, struct gvalue_value key, struct gvalue_value value) {
+	if (key.type != map->keyType) {
+		printf("Error: fmap: Wrong key type. Expected=%s, Actual=%s\n", map->keyType->name, key.type->name);
+		return false;
+	}
+
+	if ((map->valueType != NULL && value.type != map->valueType) || private_fmap_checkType(value.type) == false) {
+		printf("Error: fmap: Wrong value type %s\n", value.type->name);
+		return false;
+	}
+
+	uint32_t hashCode = gvalue_hash(key);
+	bool isNewKey = *private_fmap_findLink(map, key, hashCode) == 0;
+
+	// This may remap the file, so entry pointers are only taken afterwards.
+	if (private_fmap_reserve(map, key, value, isNewKey) == false) {
+		return false;
+	}
+
+	uint32_t *link = private_fmap_findLink(map, key, hashCode);
+	struct fmap_header *header = map->header;
+
+	if (!isNewKey) {
+		struct fmap_entry *entry = &(map->entries[*link - 1]);
+		private_fmap_discard(map, entry->valueTypeCode, entry->value);
+		entry->valueTypeCode = (uint8_t) value.type->code;
+		entry->value = private_fmap_encode(map, value);
+		return false;
+	}
+
+	uint32_t index;
+	if (header->freeEntry != 0) {
+		index = header->freeEntry;
+		header->freeEntry = map->entries[index - 1].next;
+	}
+	else {
+		index = ++(header->entryCount);
+	}
+
+	struct fmap_entry *entry = &(map->entries[index - 1]);
+	memset(entry, 0, sizeof(struct fmap_entry));
+	entry->hashCode = hashCode;
+	entry->keyTypeCode = (uint8_t) key.type->code;
+	entry->valueTypeCode = (uint8_t) value.type->code;
+	entry->inUse = true;
+	entry->key = private_fmap_encode(map, key);
+	entry->value = private_fmap_encode(map, value);
+
+	*link = index;
+	header->size++;
+	return true;
+}
+
+// String values point into the mapping and stay valid until the next put or close.
+bool fmap_get(struct fmap_map *map, struct gvalue_value key, struct gvalue_value *outValue) {
+	if (key.type != map->keyType) {
+		printf("Error: fmap: Wrong key type. Expected=%s, Actual=%s\n", map->keyType->name, key.type->name);
+		return false;
+	}
+
+	uint32_t *link = private_fmap_findLink(map, key, gvalue_hash(key));
+	if (*link == 0) {
+		return false;
+	}
+
+	struct fmap_entry *entry = &(map->entries[*link - 1]);
+	*outValue = private_fmap_decode(map, entry->valueTypeCode, entry->value);
+	return true;
+}
+
+bool fmap_containsKey(struct fmap_map *map, struct gvalue_value key) {
+	struct gvalue_value value;
+	return fmap_get(map, key, &value);
+}
+
+// Returns true if key was removed.
+bool fmap_remove(struct fmap_map *map, struct gvalue_value key) {
+	if (key.type != map->keyType) {
+		printf("Error: fmap: Wrong key type. Expected=%s, Actual=%s\n", map->keyType->name, key.type->name);
+		return false;
+	}
+
+	uint32_t *link = private_fmap_findLink(map, key, gvalue_hash(key));
+	if (*link == 0) {
+		return false;
+	}
+
+	uint32_t index = *link;
+	struct fmap_entry *entry = &(map->entries[index - 1]);
+	*link = entry->next;
+
+	private_fmap_discard(map, entry->keyTypeCode, entry->key);
+	private_fmap_discard(map, entry->valueTypeCode, entry->value);
+
+	entry->inUse = false;
+	entry->next = map->header->freeEntry;
+	map->header->freeEntry = index;
+	map->header->size--;
+	return true;
+}
+
+/*******************************************************************************************/
+
+// More operations.
+
+void fmap_each(struct fmap_map *map, void (*func)(struct gvalue_value, struct gvalue_value)) {
+	for (uint32_t i = 0; i < map->header->entryCount; i++) {
+		struct fmap_entry *entry = &(map->entries[i]);
+		if (entry->inUse) {
+			func(private_fmap_decode(map, entry->keyTypeCode, entry->key),
+					private_fmap_decode(map, entry->valueTypeCode, entry->value));
+		}
+	}
+}
+
+// Durability point. Returns true once everything written so far is on disk.
+bool fmap_sync(struct fmap_map *map) {
+	return private_fmap_syncFile(map);
+}
+
+/*******************************************************************************************/
+
+// Destructor.
+
+// Syncs the file before closing it.
+void fmap_close(struct fmap_map *map) {
+	private_fmap_syncFile(map);
+	private_fmap_unmapFile(map);
+	private_fmap_closeFile(map);
+	free(map);
+}
@@ -0,0 +1,123 @@
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include <stdio.h>
+
+#include "GenericMap.h"
+
+/*******************************************************************************************/
+
+// Constants.
+
+#define FMAP_VERSION						1
+#define FMAP_DEFAULT_INITIAL_CAPACITY		16
+#define FMAP_DEFAULT_OVERFLOW_CAPACITY		4096
+
+/*******************************************************************************************/
+
+// Data types.
+
+// Everything below lives inside the file and is accessed directly through the mapping.
+// Entry and slot references are 1-based indexes into the entry array, 0 means none.
+struct fmap_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrderMark;
+	uint32_t hashVersion;
+	uint8_t keyTypeCode;
+	uint8_t valueTypeCode;
+	uint8_t wcharSize;
+	uint8_t reserved;
+	uint32_t capacity;
+	uint32_t size;
+	uint32_t entryCapacity;
+	uint32_t entryCount;
+	uint32_t freeEntry;
+	uint64_t overflowCapacity;
+	uint64_t overflowUsed;
+
+	// Bytes in the overflow region that belong to removed or replaced strings. They are not reused.
+	uint64_t overflowGarbage;
+};
+
+// Scalars are stored as their bits, strings as an offset into the overflow region.
+struct fmap_entry {
+	uint32_t hashCode;
+	uint32_t next;
+	uint8_t keyTypeCode;
+	uint8_t valueTypeCode;
+	bool inUse;
+	uint8_t reserved[5];
+	uint64_t key;
+	uint64_t value;
+};
+
+// Layout of the file: header, slot array, entry array, overflow region.
+// The pointers are only valid until the next put, since a put may grow and remap the file.
+struct fmap_map {
+	int fd;
+	size_t mappedSize;
+	unsigned char *base;
+	struct fmap_header *header;
+	uint32_t *slots;
+	struct fmap_entry *entries;
+	char *overflow;
+	const struct gvalue_type *keyType;
+	const struct gvalue_type *valueType;
+};
+
+// Pseudo class.
+struct fmap_class {
+
+	// Constructors.
+	struct fmap_map *(*open)(const char *path, const struct gvalue_type *keyType, const struct gvalue_type *valueType);
+
+	// Basic operations.
+	bool (*put)(struct fmap_map *map, struct gvalue_value key, struct gvalue_value value);
+	bool (*get)(struct fmap_map *map, struct gvalue_value key, struct gvalue_value *outValue);
+	bool (*containsKey)(struct fmap_map *map, struct gvalue_value key);
+	bool (*remove)(struct fmap_map *map, struct gvalue_value key);
+
+	// More operations.
+	void (*each)(struct fmap_map *map, void (*func)(struct gvalue_value, struct gvalue_value));
+	bool (*sync)(struct fmap_map *map);
+
+	// Destructor.
+	void (*close)(struct fmap_map *map);
+
+};
+
+// OOP class object.
+extern struct fmap_class fmap;
+
+/*******************************************************************************************/
+
+// Constructors.
+
+extern struct fmap_map *fmap_open(const char *path, const struct gvalue_type *keyType, const struct gvalue_type *valueType);
+
+/*******************************************************************************************/
+
+// Basic operations.
+
+extern bool fmap_put(struct fmap_map *map, struct gvalue_value key, struct gvalue_value value);
+extern bool fmap_get(struct fmap_map *map, struct gvalue_value key, struct gvalue_value *outValue);
+extern bool fmap_containsKey(struct fmap_map *map, struct gvalue_value key);
+extern bool fmap_remove(struct fmap_map *map, struct gvalue_value key);
+
+/*******************************************************************************************/
+
+// More operations.
+
+extern void fmap_each(struct fmap_map *map, void (*func)(struct gvalue_value, struct gvalue_value));
+extern bool fmap_sync(struct fmap_map *map);
+
+/*******************************************************************************************/
+
+// Destructor.
+
+extern void fmap_close(struct fmap_map *map);
+
+/*******************************************************************************************/
+
+#endif /* FILEMAP_H */
@@ -0,0 +1,255 @@
+/**
+ * Implementation of a generic value deque on a ring buffer.
+ *
+ * Both ends can be pushed and popped in O(1), so a work queue does not shift all its values on every
+ * pop like glist_removeIndex(list, 0) does. The capacity is a power of two, so positions wrap with a
+ * mask. The values must all be of the same data type.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "GenericDeque.h"
+
+// OOP class object.
+struct gdeque_class gdeque = {
+
+		// Constructors.
+		.create = gdeque_create,
+		.create1 = gdeque_create1,
+
+		// Basic operations.
+		.pushFront = gdeque_pushFront,
+		.pushFront1 = gdeque_pushFront1,
+		.pushBack = gdeque_pushBack,
+		.pushBack1 = gdeque_pushBack1,
+		.popFront = gdeque_popFront,
+		.popBack = gdeque_popBack,
+		.peekFront = gdeque_peekFront,
+		.peekBack = gdeque_peekBack,
+		.get = gdeque_get,
+		.clear = gdeque_clear,
+
+		// More operations.
+		.each = gdeque_each,
+		.print = gdeque_print,
+		.fprint = gdeque_fprint,
+
+		// Destructor.
+		.free = gdeque_free
+
+};
+
+/*******************************************************************************************/
+
+// Constructors.
+
+struct gdeque_deque *gdeque_create(const struct gvalue_type *dataType) {
+	struct gdeque_config config = { .dataType = dataType };
+	return gdeque_create1(config);
+}
+
+struct gdeque_deque *gdeque_create1(struct gdeque_config config) {
+	if (config.dataType == NULL) {
+		printf("Error: gdeque: dataType is required\n");
+		return NULL;
+	}
+
+	uint32_t capacity = GLIST_DEFAULT_INITIAL_CAPACITY;
+	while (capacity < config.capacity && capacity <= UINT32_MAX / 2) {
+		capacity *= 2;
+	}
+	config.capacity = capacity;
+
+	if (config.freeFunc == NULL) {
+		config.freeFunc = gvalue_free;
+	}
+
+	struct gdeque_deque *deque = (struct gdeque_deque *) malloc(sizeof(struct gdeque_deque));
+
+	deque->config = config;
+	deque->size = 0;
+	deque->head = 0;
+	deque->mask = capacity - 1;
+	deque->nodes = calloc(sizeof(struct glist_node), capacity);
+
+	return deque;
+}
+
+/*******************************************************************************************/
+
+// Basic operations.
+
+// Doubles the capacity. The values are copied so that the front lands at index 0 and the ring is
+// unwrapped, in at most two contiguous pieces.
+void private_gdeque_grow(struct gdeque_deque *deque) {
+	uint32_t oldCapacity = deque->config.capacity;
+	uint32_t newCapacity = oldCapacity * 2;
+	struct glist_node *nodes = malloc(sizeof(struct glist_node) * newCapacity);
+
+	uint32_t firstPart = oldCapacity - deque->head;
+	if (firstPart > deque->size) {
+		firstPart = deque->size;
+	}
+	memcpy(nodes, &(deque->nodes[deque->head]), sizeof(struct glist_node) * firstPart);
+	memcpy(&(nodes[firstPart]), deque->nodes, sizeof(struct glist_node) * (deque->size - firstPart));
+
+	free(deque->nodes);
+	deque->nodes = nodes;
+	deque->head = 0;
+	deque->mask = newCapacity - 1;
+	deque->config.capacity = newCapacity;
+}
+
+bool private_gdeque_checkDataType(struct gvalue_value givenValue, const struct gvalue_type *dataType) {
+	if (givenValue.type != dataType) {
+		printf("Error: gdeque: Wrong data type. Expected=%s, Actual=%s\n", dataType->name, givenValue.type->name);
+		return false;
+	}
+	return true;
+}
+
+void gdeque_pushFront(struct gdeque_deque *deque, struct gvalue_value value) {
+	gdeque_pushFront1(deque, value, false);
+}
+
+void gdeque_pushFront1(struct gdeque_deque *deque, struct gvalue_value value, bool freeOnRemove) {
+	if (private_gdeque_checkDataType(value, deque->config.dataType) == false) {
+		return;
+	}
+
+	if (deque->size == deque->config.capacity) {
+		private_gdeque_grow(deque);
+	}
+
+	deque->head = (deque->head - 1) & deque->mask;
+	deque->nodes[deque->head].value = value;
+	deque->nodes[deque->head].freeOnRemove = freeOnRemove;
+	deque->size++;
+}
+
+void gdeque_pushBack(struct gdeque_deque *deque, struct gvalue_value value) {
+	gdeque_pushBack1(deque, value, false);
+}
+
+void gdeque_pushBack1(struct gdeque_deque *deque, struct gvalue_value value, bool freeOnRemove) {
+	if (private_gdeque_checkDataType(value, deque->config.dataType) == false) {
+		return;
+	}
+
+	if (deque->size == deque->config.capacity) {
+		private_gdeque_grow(deque);
+	}
+
+	struct glist_node *node = &(deque->nodes[(deque->head + deque->size) & deque->mask]);
+	node->value = value;
+	node->freeOnRemove = freeOnRemove;
+	deque->size++;
+}
+
+void private_gdeque_take(struct gdeque_deque *deque, struct glist_node *node, struct gvalue_value *outValue) {
+	if (outValue != NULL) {
+		*outValue = node->value;
+	}
+	else if (node->freeOnRemove) {
+		deque->config.freeFunc(node->value);
+	}
+}
+
+bool gdeque_popFront(struct gdeque_deque *deque, struct gvalue_value *outValue) {
+	if (deque->size == 0) {
+		return false;
+	}
+
+	private_gdeque_take(deque, &(deque->nodes[deque->head]), outValue);
+	deque->head = (deque->head + 1) & deque->mask;
+	deque->size--;
+	return true;
+}
+
+bool gdeque_popBack(struct gdeque_deque *deque, struct gvalue_value *outValue) {
+	if (deque->size == 0) {
+		return false;
+	}
+
+	private_gdeque_take(deque, &(deque->nodes[(deque->head + deque->size - 1) & deque->mask]), outValue);
+	deque->size--;
+	return true;
+}
+
+struct gvalue_value *gdeque_peekFront(struct gdeque_deque *deque) {
+	if (deque->size == 0) {
+		return NULL;
+	}
+	return &(deque->nodes[deque->head].value);
+}
+
+struct gvalue_value *gdeque_peekBack(struct gdeque_deque *deque) {
+	if (deque->size == 0) {
+		return NULL;
+	}
+	return &(deque->nodes[(deque->head + deque->size - 1) & deque->mask].value);
+}
+
+struct gvalue_value *gdeque_get(struct gdeque_deque *deque, uint32_t index) {
+	if (index >= deque->size) {
+		printf("Error: gdeque: Index out of bounds. Given=%" PRIu32 ", Size=%" PRIu32 "\n", index, deque->size);
+		return NULL;
+	}
+	return &(deque->nodes[(deque->head + index) & deque->mask].value);
+}
+
+void gdeque_clear(struct gdeque_deque *deque) {
+	for (uint32_t i = 0; i < deque->size; i++) {
+		struct glist_node *node = &(deque->nodes[(deque->head + i) & deque->mask]);
+		if (node->freeOnRemove) {
+			deque->config.freeFunc(node->value);
+		}
+	}
+
+	deque->size = 0;
+	deque->head = 0;
+}
+
+/*******************************************************************************************/
+
+// More operations.
+
+void gdeque_each(struct gdeque_deque *deque, void (*func)(struct gvalue_value)) {
+	for (uint32_t i = 0; i < deque->size; i++) {
+		func(deque->nodes[(deque->head + i) & deque->mask].value);
+	}
+}
+
+void gdeque_print(struct gdeque_deque *deque) {
+	gdeque_fprint(deque, stdout);
+}
+
+void gdeque_fprint(struct gdeque_deque *deque, FILE *stream) {
+	struct gvalue_writer writer;
+	gvalue_initWriter(&writer, stream);
+
+	gvalue_write(&writer, "[ ");
+	for (uint32_t i = 0; i < deque->size; i++) {
+		if (i > 0) {
+			gvalue_write(&writer, ", ");
+		}
+		gvalue_writeValue(&writer, deque->nodes[(deque->head + i) & deque->mask].value);
+	}
+	gvalue_write(&writer, " ]");
+
+	gvalue_flushWriter(&writer);
+}
+
+/*******************************************************************************************/
+
+// Destructor.
+
+void gdeque_free(struct gdeque_deque *deque) {
+	gdeque_clear(deque);
+	free(deque->nodes);
+	free(deque);
+}
@@ -0,0 +1,106 @@
+#ifndef GENERICDEQUE_H
+#define GENERICDEQUE_H
+
+#include "GenericList.h"
+
+/*******************************************************************************************/
+
+// Data types.
+
+// For use in the constructor, like in the Builder pattern.
+// Only dataType is required. The rest are optional.
+struct gdeque_config {
+	const struct gvalue_type *dataType;
+	uint32_t capacity;
+	bool (*freeFunc)(struct gvalue_value);
+};
+
+// Ring buffer of glist nodes. The front is at nodes[head], and index i at nodes[(head + i) & mask].
+// config.capacity is always a power of two.
+struct gdeque_deque {
+	uint32_t size;
+	struct gdeque_config config;
+	uint32_t head;
+	uint32_t mask;
+	struct glist_node *nodes;
+};
+
+// Pseudo class.
+struct gdeque_class {
+
+	// Constructors.
+	struct gdeque_deque *(*create)(const struct gvalue_type *dataType);
+	struct gdeque_deque *(*create1)(struct gdeque_config config);
+
+	// Basic operations.
+	void (*pushFront)(struct gdeque_deque *deque, struct gvalue_value value);
+	void (*pushFront1)(struct gdeque_deque *deque, struct gvalue_value value, bool freeOnRemove);
+	void (*pushBack)(struct gdeque_deque *deque, struct gvalue_value value);
+	void (*pushBack1)(struct gdeque_deque *deque, struct gvalue_value value, bool freeOnRemove);
+	bool (*popFront)(struct gdeque_deque *deque, struct gvalue_value *outValue);
+	bool (*popBack)(struct gdeque_deque *deque, struct gvalue_value *outValue);
+	struct gvalue_value *(*peekFront)(struct gdeque_deque *deque);
+	struct gvalue_value *(*peekBack)(struct gdeque_deque *deque);
+	struct gvalue_value *(*get)(struct gdeque_deque *deque, uint32_t index);
+	void (*clear)(struct gdeque_deque *deque);
+
+	// More operations.
+	void (*each)(struct gdeque_deque *deque, void (*func)(struct gvalue_value));
+	void (*print)(struct gdeque_deque *deque);
+	void (*fprint)(struct gdeque_deque *deque, FILE *stream);
+
+	// Destructor.
+	void (*free)(struct gdeque_deque *deque);
+
+};
+
+// OOP class object.
+extern struct gdeque_class gdeque;
+
+/*******************************************************************************************/
+
+// Constructors.
+
+extern struct gdeque_deque *gdeque_create(const struct gvalue_type *dataType);
+extern struct gdeque_deque *gdeque_create1(struct gdeque_config config);
+
+/*******************************************************************************************/
+
+// Basic operations. All of them are O(1), pushes amortized.
+
+extern void gdeque_pushFront(struct gdeque_deque *deque, struct gvalue_value value);
+extern void gdeque_pushFront1(struct gdeque_deque *deque, struct gvalue_value value, bool freeOnRemove);
+extern void gdeque_pushBack(struct gdeque_deque *deque, struct gvalue_value value);
+extern void gdeque_pushBack1(struct gdeque_deque *deque, struct gvalue_value value, bool freeOnRemove);
+
+// A popped value is handed to outValue and is then the caller's, so it is never freed. With outValue
+// NULL, the value is dropped and freed if freeOnRemove was set. Returns false if the deque is empty.
+extern bool gdeque_popFront(struct gdeque_deque *deque, struct gvalue_value *outValue);
+extern bool gdeque_popBack(struct gdeque_deque *deque, struct gvalue_value *outValue);
+
+// NULL if the deque is empty.
+extern struct gvalue_value *gdeque_peekFront(struct gdeque_deque *deque);
+extern struct gvalue_value *gdeque_peekBack(struct gdeque_deque *deque);
+
+// Index 0 is the front.
+extern struct gvalue_value *gdeque_get(struct gdeque_deque *deque, uint32_t index);
+extern void gdeque_clear(struct gdeque_deque *deque);
+
+/*******************************************************************************************/
+
+// More operations.
+
+// From front to back.
+extern void gdeque_each(struct gdeque_deque *deque, void (*func)(struct gvalue_value));
+extern void gdeque_print(struct gdeque_deque *deque);
+extern void gdeque_fprint(struct gdeque_deque *deque, FILE *stream);
+
+/*******************************************************************************************/
+
+// Destructor.
+
+extern void gdeque_free(struct gdeque_deque *deque);
+
+/*******************************************************************************************/
+
+#endif /* GENERICDEQUE_H */
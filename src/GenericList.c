@@ -1,16 +1,20 @@
 /**
  * Implementation of a generic value array list.
  *
- * The nodes must all be of the same data type.
+ * The nodes must all be of the same data type. With packedStorage the list keeps the raw values in one
+ * array instead, and converts them at the API boundary.
  */
 
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "GenericList.h"
 
+extern bool private_glist_tryScan(struct glist_list *list, struct gvalue_value value, bool last, bool *outFound, uint32_t *outIndex);
+
 // OOP class object.
 struct glist_class glist = {
 
@@ -21,12 +25,20 @@ struct glist_class glist = {
 		// Basic operations.
 		.add = glist_add,
 		.add1 = glist_add1,
+		.insert = glist_insert,
+		.insert1 = glist_insert1,
+		.addAll = glist_addAll,
+		.addList = glist_addList,
+		.reserve = glist_reserve,
 		.get = glist_get,
 		.tryGetIndex = glist_tryGetIndex,
 		.tryGetLastIndex = glist_tryGetLastIndex,
 		.contains = glist_contains,
 		.removeIndex = glist_removeIndex,
 		.remove = glist_remove,
+		.removeRange = glist_removeRange,
+		.removeIf = glist_removeIf,
+		.removeAll = glist_removeAll,
 		.clear = glist_clear,
 
 		// More operations.
@@ -35,6 +47,22 @@ struct glist_class glist = {
 		.fprint = glist_fprint,
 		.getSlice = glist_getSlice,
 
+		// Sorting.
+		.sort = glist_sort,
+		.sortWith = glist_sortWith,
+
+		// Searching sorted lists.
+		.lowerBound = glist_lowerBound,
+		.upperBound = glist_upperBound,
+		.binarySearch = glist_binarySearch,
+		.createEytzinger = glist_createEytzinger,
+		.eytzingerLowerBound = glist_eytzingerLowerBound,
+		.eytzingerSearch = glist_eytzingerSearch,
+		.freeEytzinger = glist_freeEytzinger,
+
+		// Conversions.
+		.parseNumbers = glist_parseNumbers,
+
 		// Destructor.
 		.free = glist_free
 
@@ -42,6 +70,120 @@ struct glist_class glist = {
 
 /*******************************************************************************************/
 
+// Storage.
+
+// Bytes per value with config.packedStorage, or 0 for types that cannot be packed.
+size_t private_glist_packedWidth(int code) {
+	switch (code) {
+	case GVALUE_TYPE_BOOL:
+		return sizeof(bool);
+	case GVALUE_TYPE_BYTE:
+	case GVALUE_TYPE_UBYTE:
+	case GVALUE_TYPE_CHAR:
+		return 1;
+	case GVALUE_TYPE_SHORT:
+	case GVALUE_TYPE_USHORT:
+		return 2;
+	case GVALUE_TYPE_INT:
+	case GVALUE_TYPE_UINT:
+		return 4;
+	case GVALUE_TYPE_FLOAT:
+		return sizeof(float);
+	case GVALUE_TYPE_LONG:
+	case GVALUE_TYPE_ULONG:
+		return 8;
+	case GVALUE_TYPE_DOUBLE:
+		return sizeof(double);
+	case GVALUE_TYPE_WCHAR:
+		return sizeof(wchar_t);
+	case GVALUE_TYPE_POINTER:
+	case GVALUE_TYPE_STRING:
+	case GVALUE_TYPE_WSTRING:
+	case GVALUE_TYPE_ISTRING:
+		return sizeof(void *);
+	default:
+		return 0;
+	}
+}
+
+// Values of other types have nothing to free, unless the list frees them its own way.
+bool private_glist_needsFreeBits(struct glist_config config) {
+	int code = config.dataType->code;
+	return config.freeFunc != gvalue_free
+			|| code == GVALUE_TYPE_POINTER || code == GVALUE_TYPE_STRING || code == GVALUE_TYPE_WSTRING;
+}
+
+size_t private_glist_freeWords(uint32_t capacity) {
+	return ((size_t) capacity + 63) / 64;
+}
+
+// The value at index, whichever the storage.
+struct gvalue_value private_glist_valueAt(struct glist_list *list, uint32_t index) {
+	if (list->config.packedStorage == false) {
+		return list->nodes[index].value;
+	}
+
+	// Every member of the union starts at its first byte.
+	size_t width = private_glist_packedWidth(list->config.dataType->code);
+	struct gvalue_value value;
+	value.type = list->config.dataType;
+	value.primitive.ulongValue = 0;
+	memcpy(&(value.primitive), (char *) list->values + index * width, width);
+	return value;
+}
+
+bool private_glist_freeOnRemoveAt(struct glist_list *list, uint32_t index) {
+	if (list->config.packedStorage == false) {
+		return list->nodes[index].freeOnRemove;
+	}
+	return list->freeBits != NULL && ((list->freeBits[index / 64] >> (index % 64)) & 1) != 0;
+}
+
+void private_glist_setFreeBit(struct glist_list *list, uint32_t index, bool freeOnRemove) {
+	uint64_t bit = UINT64_C(1) << (index % 64);
+	if (freeOnRemove) {
+		list->freeBits[index / 64] |= bit;
+	}
+	else {
+		list->freeBits[index / 64] &= ~bit;
+	}
+}
+
+void private_glist_setAt(struct glist_list *list, uint32_t index, struct gvalue_value value, bool freeOnRemove) {
+	if (list->config.packedStorage == false) {
+		list->nodes[index].value = value;
+		list->nodes[index].freeOnRemove = freeOnRemove;
+		return;
+	}
+
+	size_t width = private_glist_packedWidth(list->config.dataType->code);
+	memcpy((char *) list->values + index * width, &(value.primitive), width);
+	if (list->freeBits != NULL) {
+		private_glist_setFreeBit(list, index, freeOnRemove);
+	}
+}
+
+// Moves count values from index from to index to, like memmove.
+void private_glist_move(struct glist_list *list, uint32_t to, uint32_t from, uint32_t count) {
+	if (list->config.packedStorage == false) {
+		memmove(&(list->nodes[to]), &(list->nodes[from]), sizeof(struct glist_node) * count);
+		return;
+	}
+
+	size_t width = private_glist_packedWidth(list->config.dataType->code);
+	memmove((char *) list->values + to * width, (char *) list->values + from * width, width * count);
+
+	// Bit by bit, in the direction that reads every bit before it is overwritten.
+	if (list->freeBits != NULL) {
+		for (uint32_t n = 0; n < count; n++) {
+			uint32_t i = (to < from) ? n : count - 1 - n;
+			private_glist_setFreeBit(list, to + i, private_glist_freeOnRemoveAt(list, from + i));
+		}
+	}
+}
+
+/*******************************************************************************************/
+
 // Constructors.
 
 struct glist_list *glist_create(const struct gvalue_type *dataType) {
@@ -69,11 +211,29 @@ struct glist_list *glist_create1(struct glist_config config) {
 		config.freeFunc = gvalue_free;
 	}
 
+	size_t width = private_glist_packedWidth(config.dataType->code);
+	if (config.packedStorage && width == 0) {
+		printf("Error: glist: packedStorage needs a number, char, bool, pointer or string type. Actual=%s\n", config.dataType->name);
+		return NULL;
+	}
+
 	struct glist_list *list = (struct glist_list *) malloc(sizeof(struct glist_list));
 
 	list->config = config;
 	list->size = 0;
-	list->nodes = calloc(sizeof(struct glist_node), config.capacity);
+	list->nodes = NULL;
+	list->values = NULL;
+	list->freeBits = NULL;
+
+	if (config.packedStorage) {
+		list->values = calloc(width, config.capacity);
+		if (private_glist_needsFreeBits(config)) {
+			list->freeBits = calloc(sizeof(uint64_t), private_glist_freeWords(config.capacity));
+		}
+	}
+	else {
+		list->nodes = calloc(sizeof(struct glist_node), config.capacity);
+	}
 
 	return list;
 }
@@ -82,12 +242,31 @@ struct glist_list *glist_create1(struct glist_config config) {
 
 // Basic operations.
 
+void private_glist_setCapacity(struct glist_list *list, uint32_t newCapacity) {
+	if (list->config.packedStorage) {
+		list->values = realloc(list->values, private_glist_packedWidth(list->config.dataType->code) * newCapacity);
+		if (list->freeBits != NULL) {
+			list->freeBits = realloc(list->freeBits, sizeof(uint64_t) * private_glist_freeWords(newCapacity));
+		}
+	}
+	else {
+		list->nodes = realloc(list->nodes, sizeof(struct glist_node) * newCapacity);
+	}
+	list->config.capacity = newCapacity;
+}
+
 void private_glist_grow(struct glist_list *list) {
-	uint32_t oldCapacity = list->config.capacity;
-	uint32_t newCapacity = oldCapacity * 2;
+	private_glist_setCapacity(list, list->config.capacity * 2);
+}
 
-	list->nodes = realloc(list->nodes, sizeof(struct glist_node) * newCapacity);
-	list->config.capacity = newCapacity;
+// Makes room for count more values with one realloc, at least doubling so that repeated bulk adds
+// stay amortized O(1) per value.
+void private_glist_growFor(struct glist_list *list, uint32_t count) {
+	uint32_t needed = list->size + count;
+	if (needed > list->config.capacity) {
+		uint32_t doubled = list->config.capacity * 2;
+		private_glist_setCapacity(list, (needed > doubled) ? needed : doubled);
+	}
 }
 
 bool private_glist_checkDataType(struct gvalue_value givenValue, const struct gvalue_type *dataType) {
@@ -119,16 +298,136 @@ void glist_add1(struct glist_list *list, struct gvalue_value value, bool freeOnR
 		private_glist_grow(list);
 	}
 
-	list->nodes[list->size].value = value;
-	list->nodes[list->size].freeOnRemove = freeOnRemove;
+	uint32_t index = list->size;
+	if (list->config.sorted) {
+		index = glist_upperBound(list, value);
+		private_glist_move(list, index + 1, index, list->size - index);
+	}
+
+	private_glist_setAt(list, index, value, freeOnRemove);
 	list->size++;
 }
 
+void glist_insert(struct glist_list *list, uint32_t index, struct gvalue_value value) {
+	glist_insert1(list, index, value, false);
+}
+
+// Index may be size, which appends.
+void glist_insert1(struct glist_list *list, uint32_t index, struct gvalue_value value, bool freeOnRemove) {
+	if (list->config.sorted) {
+		printf("Error: glist: insert would break the order of a sorted list, use add instead\n");
+		return;
+	}
+	if (private_glist_checkDataType(value, list->config.dataType) == false) {
+		return;
+	}
+	if (index != list->size && private_glist_checkBounds(list->size, index) == false) {
+		return;
+	}
+
+	if (list->size == list->config.capacity) {
+		private_glist_grow(list);
+	}
+
+	private_glist_move(list, index + 1, index, list->size - index);
+	private_glist_setAt(list, index, value, freeOnRemove);
+	list->size++;
+}
+
+// All values are checked before any is added, so a wrong one leaves the list unchanged.
+void glist_addAll(struct glist_list *list, const struct gvalue_value *values, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		if (private_glist_checkDataType(values[i], list->config.dataType) == false) {
+			return;
+		}
+	}
+
+	private_glist_growFor(list, count);
+
+	if (list->config.sorted) {
+		for (uint32_t i = 0; i < count; i++) {
+			glist_add1(list, values[i], false);
+		}
+		return;
+	}
+
+	if (list->config.packedStorage) {
+		for (uint32_t i = 0; i < count; i++) {
+			private_glist_setAt(list, list->size + i, values[i], false);
+		}
+	}
+	else {
+		struct glist_node *nodes = &(list->nodes[list->size]);
+		for (uint32_t i = 0; i < count; i++) {
+			nodes[i].value = values[i];
+			nodes[i].freeOnRemove = false;
+		}
+	}
+	list->size += count;
+}
+
+// Packed lists copy their values in one piece.
+void glist_addList(struct glist_list *list, struct glist_list *source) {
+	if (source->config.dataType != list->config.dataType) {
+		printf("Error: glist: Wrong data type. Expected=%s, Actual=%s\n", list->config.dataType->name, source->config.dataType->name);
+		return;
+	}
+
+	uint32_t count = source->size;
+	private_glist_growFor(list, count);
+
+	// Sorted adds shift the values, so they are taken out first in case source is the list itself.
+	if (list->config.sorted) {
+		struct gvalue_value *values = malloc(sizeof(struct gvalue_value) * ((size_t) count + 1));
+		for (uint32_t i = 0; i < count; i++) {
+			values[i] = private_glist_valueAt(source, i);
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			glist_add1(list, values[i], false);
+		}
+		free(values);
+		return;
+	}
+
+	if (list->config.packedStorage && source->config.packedStorage) {
+		size_t width = private_glist_packedWidth(list->config.dataType->code);
+		memcpy((char *) list->values + list->size * width, source->values, width * count);
+		if (list->freeBits != NULL) {
+			for (uint32_t i = 0; i < count; i++) {
+				private_glist_setFreeBit(list, list->size + i, false);
+			}
+		}
+	}
+	else if (list->config.packedStorage == false && source->config.packedStorage == false) {
+		struct glist_node *nodes = &(list->nodes[list->size]);
+		for (uint32_t i = 0; i < count; i++) {
+			nodes[i].value = source->nodes[i].value;
+			nodes[i].freeOnRemove = false;
+		}
+	}
+	else {
+		for (uint32_t i = 0; i < count; i++) {
+			private_glist_setAt(list, list->size + i, private_glist_valueAt(source, i), false);
+		}
+	}
+	list->size += count;
+}
+
+void glist_reserve(struct glist_list *list, uint32_t capacity) {
+	if (capacity > list->config.capacity) {
+		private_glist_setCapacity(list, capacity);
+	}
+}
+
 struct gvalue_value *glist_get(struct glist_list *list, uint32_t index) {
 	if (private_glist_checkBounds(list->size, index) == false) {
 		return NULL;
 	}
 
+	if (list->config.packedStorage) {
+		list->packedValue = private_glist_valueAt(list, index);
+		return &(list->packedValue);
+	}
 	return &(list->nodes[index].value);
 }
 
@@ -137,8 +436,17 @@ bool glist_tryGetIndex(struct glist_list *list, struct gvalue_value value, uint3
 		return false;
 	}
 
+	if (list->config.sorted) {
+		return glist_binarySearch(list, value, outIndex);
+	}
+
+	bool found;
+	if (private_glist_tryScan(list, value, false, &found, outIndex)) {
+		return found;
+	}
+
 	for (uint32_t i = 0; i < list->size; i++) {
-		if (list->config.cmpFunc(value, list->nodes[i].value) == 0) {
+		if (list->config.cmpFunc(value, private_glist_valueAt(list, i)) == 0) {
 			*outIndex = i;
 			return true;
 		}
@@ -152,10 +460,24 @@ bool glist_tryGetLastIndex(struct glist_list *list, struct gvalue_value value, u
 		return false;
 	}
 
+	if (list->config.sorted) {
+		uint32_t index = glist_upperBound(list, value);
+		if (index == 0 || list->config.cmpFunc(value, private_glist_valueAt(list, index - 1)) != 0) {
+			return false;
+		}
+		*outIndex = index - 1;
+		return true;
+	}
+
+	bool found;
+	if (private_glist_tryScan(list, value, true, &found, outIndex)) {
+		return found;
+	}
+
 	uint32_t i = list->size;
 	do {
 		i--;
-		if (list->config.cmpFunc(value, list->nodes[i].value) == 0) {
+		if (list->config.cmpFunc(value, private_glist_valueAt(list, i)) == 0) {
 			*outIndex = i;
 			return true;
 		}
@@ -175,13 +497,11 @@ bool glist_removeIndex(struct glist_list *list, uint32_t index) {
 		return false;
 	}
 
-	if (list->nodes[index].freeOnRemove) {
-		list->config.freeFunc(list->nodes[index].value);
+	if (private_glist_freeOnRemoveAt(list, index)) {
+		list->config.freeFunc(private_glist_valueAt(list, index));
 	}
 
-	for (uint32_t i = index; i < list->size - 1; i++) {
-		list->nodes[i] = list->nodes[i + 1];
-	}
+	private_glist_move(list, index, index + 1, list->size - index - 1);
 
 	list->size--;
 	return true;
@@ -192,19 +512,85 @@ bool glist_remove(struct glist_list *list, struct gvalue_value value) {
 		return false;
 	}
 
+	uint32_t index;
+	return glist_tryGetIndex(list, value, &index) && glist_removeIndex(list, index);
+}
+
+bool glist_removeRange(struct glist_list *list, uint32_t fromIndex, uint32_t toIndex) {
+	if (fromIndex > toIndex) {
+		return false;
+	}
+	if ((private_glist_checkBounds(list->size, fromIndex) == false)
+			|| (private_glist_checkBounds(list->size, toIndex) == false)) {
+		return false;
+	}
+
+	for (uint32_t i = fromIndex; i <= toIndex; i++) {
+		if (private_glist_freeOnRemoveAt(list, i)) {
+			list->config.freeFunc(private_glist_valueAt(list, i));
+		}
+	}
+
+	private_glist_move(list, fromIndex, toIndex + 1, list->size - toIndex - 1);
+
+	list->size -= toIndex - fromIndex + 1;
+	return true;
+}
+
+// Kept nodes are moved down over the removed ones as the scan goes, so every node moves at most once.
+uint32_t glist_removeIf(struct glist_list *list, bool (*predicate)(struct gvalue_value, void *), void *context) {
+	uint32_t kept = 0;
+
 	for (uint32_t i = 0; i < list->size; i++) {
-		if (list->config.cmpFunc(value, list->nodes[i].value) == 0) {
-			return glist_removeIndex(list, i);
+		struct gvalue_value value = private_glist_valueAt(list, i);
+		bool freeOnRemove = private_glist_freeOnRemoveAt(list, i);
+		if (predicate(value, context)) {
+			if (freeOnRemove) {
+				list->config.freeFunc(value);
+			}
+		}
+		else {
+			if (kept != i) {
+				private_glist_setAt(list, kept, value, freeOnRemove);
+			}
+			kept++;
 		}
 	}
 
-	return false;
+	uint32_t removed = list->size - kept;
+	list->size = kept;
+	return removed;
+}
+
+struct private_glist_equalContext {
+	int (*cmpFunc)(struct gvalue_value, struct gvalue_value);
+	struct gvalue_value value;
+};
+
+bool private_glist_isEqual(struct gvalue_value value, void *context) {
+	struct private_glist_equalContext *equal = (struct private_glist_equalContext *) context;
+	return equal->cmpFunc(equal->value, value) == 0;
+}
+
+uint32_t glist_removeAll(struct glist_list *list, struct gvalue_value value) {
+	if (list->config.sorted) {
+		uint32_t fromIndex = glist_lowerBound(list, value);
+		uint32_t toIndex = glist_upperBound(list, value);
+		if (fromIndex == toIndex) {
+			return 0;
+		}
+		glist_removeRange(list, fromIndex, toIndex - 1);
+		return toIndex - fromIndex;
+	}
+
+	struct private_glist_equalContext equal = { .cmpFunc = list->config.cmpFunc, .value = value };
+	return glist_removeIf(list, private_glist_isEqual, &equal);
 }
 
 void glist_clear(struct glist_list *list) {
 	for (uint32_t i = 0; i < list->size; i++) {
-		if (list->nodes[i].freeOnRemove) {
-			list->config.freeFunc(list->nodes[i].value);
+		if (private_glist_freeOnRemoveAt(list, i)) {
+			list->config.freeFunc(private_glist_valueAt(list, i));
 		}
 	}
 
@@ -217,7 +603,7 @@ void glist_clear(struct glist_list *list) {
 
 void glist_each(struct glist_list *list, void (*func)(struct gvalue_value)) {
 	for (uint32_t i = 0; i < list->size; i++) {
-		func(list->nodes[i].value);
+		func(private_glist_valueAt(list, i));
 	}
 }
 
@@ -225,20 +611,27 @@ void glist_print(struct glist_list* list) {
 	glist_fprint(list, stdout);
 }
 
+// Values are formatted into a gvalue_writer, so large lists reach the stream in a few big writes.
 void glist_fprint(struct glist_list* list, FILE *stream) {
-	fputs("[ ", stream);
+	struct gvalue_writer writer;
+	gvalue_initWriter(&writer, stream);
+
+	gvalue_write(&writer, "[ ");
 	for (uint32_t i = 0; i < list->size; i++) {
 		if (i > 0) {
-			fputs(", ", stream);
+			gvalue_write(&writer, ", ");
 		}
-		gvalue_fprint(list->nodes[i].value, stream);
+		gvalue_writeValue(&writer, private_glist_valueAt(list, i));
 	}
-	fputs(" ]", stream);
+	gvalue_write(&writer, " ]");
+
+	gvalue_flushWriter(&writer);
 }
 
 // Returned list points to the same memory location as the original list.
 // If original list changes, then don't use the returned list anymore.
 // We will not add any additional checks for misuse of returned slices.
+// Slices of packed lists do not carry freeOnRemove.
 struct glist_list glist_getSlice(struct glist_list *list, uint32_t fromIndex, uint32_t toIndex) {
 	struct glist_list slice = *list;
 
@@ -247,7 +640,13 @@ struct glist_list glist_getSlice(struct glist_list *list, uint32_t fromIndex, ui
 	}
 	else if ((private_glist_checkBounds(list->size, fromIndex) == true)
 			&& (private_glist_checkBounds(list->size, toIndex) == true)) {
-		slice.nodes = &(slice.nodes[fromIndex]);
+		if (list->config.packedStorage) {
+			slice.values = (char *) slice.values + fromIndex * private_glist_packedWidth(list->config.dataType->code);
+			slice.freeBits = NULL;
+		}
+		else {
+			slice.nodes = &(slice.nodes[fromIndex]);
+		}
 		slice.size = toIndex - fromIndex + 1;
 	}
 
@@ -256,10 +655,64 @@ struct glist_list glist_getSlice(struct glist_list *list, uint32_t fromIndex, ui
 
 /*******************************************************************************************/
 
+// Conversions.
+
+struct glist_list *glist_parseNumbers(struct glist_list *list, const struct gvalue_type *numberType, uint32_t *outFailures) {
+	int code = list->config.dataType->code;
+	if (code != GVALUE_TYPE_STRING && code != GVALUE_TYPE_ISTRING && code != GVALUE_TYPE_SSTRING) {
+		printf("Error: glist: parseNumbers needs a list of strings. Actual=%s\n", list->config.dataType->name);
+		return NULL;
+	}
+	if (numberType != gvalue.longType && numberType != gvalue.doubleType) {
+		printf("Error: glist: parseNumbers parses into long or double only. Given=%s\n", numberType->name);
+		return NULL;
+	}
+
+	struct glist_config config = { .dataType = numberType, .capacity = list->size };
+	struct glist_list *numbers = glist_create1(config);
+	uint32_t failures = 0;
+
+	// Nodes are filled in directly, as every value has the right type already.
+	for (uint32_t i = 0; i < list->size; i++) {
+		struct gvalue_value value = private_glist_valueAt(list, i);
+		char *chars = gvalue_stringChars(&value);
+		size_t length = (chars == NULL) ? 0 : strlen(chars);
+		struct glist_node *node = &(numbers->nodes[i]);
+
+		if (numberType == gvalue.longType) {
+			int64_t longValue;
+			if (chars == NULL || gvalue_parseLong(chars, length, &longValue) == false) {
+				longValue = 0;
+				failures++;
+			}
+			node->value = gvalue_getLong(longValue);
+		}
+		else {
+			double doubleValue;
+			if (chars == NULL || gvalue_parseDouble(chars, length, &doubleValue) == false) {
+				doubleValue = 0;
+				failures++;
+			}
+			node->value = gvalue_getDouble(doubleValue);
+		}
+		node->freeOnRemove = false;
+	}
+	numbers->size = list->size;
+
+	if (outFailures != NULL) {
+		*outFailures = failures;
+	}
+	return numbers;
+}
+
+/*******************************************************************************************/
+
 // Destructor.
 
 void glist_free(struct glist_list *list) {
 	glist_clear(list);
 	free(list->nodes);
+	free(list->values);
+	free(list->freeBits);
 	free(list);
 }
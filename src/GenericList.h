@@ -15,11 +15,21 @@
 
 // For use in the constructor, like in the Builder pattern.
 // Only dataType is required. The rest are optional.
+// With sorted, add keeps the values ordered by cmpFunc, equal values in the order they were added, and
+// lookups use binary search. Sorting it with another compare function breaks this.
 struct glist_config {
 	const struct gvalue_type *dataType;
 	uint32_t capacity;
 	int (*cmpFunc)(struct gvalue_value, struct gvalue_value);
 	bool (*freeFunc)(struct gvalue_value);
+	bool sorted;
+
+	// Stores the raw values of dataType in one packed array, like 4 bytes per int instead of a 32-byte
+	// node. freeOnRemove goes into a separate bitmap, which only pointer, string and wstring lists and
+	// lists with their own freeFunc get. dataType must be a number, char, bool, pointer, string, wstring
+	// or istring type. nodes is then NULL, and glist_get returns a pointer to a copy that is only valid
+	// until the next call.
+	bool packedStorage;
 };
 
 struct glist_node {
@@ -31,6 +41,23 @@ struct glist_list {
 	uint32_t size;
 	struct glist_config config;
 	struct glist_node *nodes;
+
+	// With config.packedStorage, these replace nodes. freeBits may be NULL.
+	void *values;
+	uint64_t *freeBits;
+
+	// Value returned by glist_get with config.packedStorage.
+	struct gvalue_value packedValue;
+};
+
+// Read-only search tree over the values of a sorted list, see glist_createEytzinger. Integer-like values
+// with the default compare function are kept as ordered keys, everything else as values.
+struct glist_eytzinger {
+	uint32_t size;
+	int (*cmpFunc)(struct gvalue_value, struct gvalue_value);
+	uint64_t *keys;
+	struct gvalue_value *values;
+	uint32_t *indexes;
 };
 
 // Pseudo class.
@@ -43,12 +70,20 @@ struct glist_class {
 	// Basic operations.
 	void (*add)(struct glist_list *list, struct gvalue_value value);
 	void (*add1)(struct glist_list *list, struct gvalue_value value, bool freeOnRemove);
+	void (*insert)(struct glist_list *list, uint32_t index, struct gvalue_value value);
+	void (*insert1)(struct glist_list *list, uint32_t index, struct gvalue_value value, bool freeOnRemove);
+	void (*addAll)(struct glist_list *list, const struct gvalue_value *values, uint32_t count);
+	void (*addList)(struct glist_list *list, struct glist_list *source);
+	void (*reserve)(struct glist_list *list, uint32_t capacity);
 	struct gvalue_value *(*get)(struct glist_list *list, uint32_t index);
 	bool (*tryGetIndex)(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex);
 	bool (*tryGetLastIndex)(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex);
 	bool (*contains)(struct glist_list *list, struct gvalue_value value);
 	bool (*removeIndex)(struct glist_list *list, uint32_t index);
 	bool (*remove)(struct glist_list *list, struct gvalue_value value);
+	bool (*removeRange)(struct glist_list *list, uint32_t fromIndex, uint32_t toIndex);
+	uint32_t (*removeIf)(struct glist_list *list, bool (*predicate)(struct gvalue_value, void *), void *context);
+	uint32_t (*removeAll)(struct glist_list *list, struct gvalue_value value);
 	void (*clear)(struct glist_list *list);
 
 	// More operations.
@@ -57,6 +92,22 @@ struct glist_class {
 	void (*fprint)(struct glist_list* list, FILE *stream);
 	struct glist_list (*getSlice)(struct glist_list *list, uint32_t fromIndex, uint32_t toIndex);
 
+	// Sorting.
+	void (*sort)(struct glist_list *list);
+	void (*sortWith)(struct glist_list *list, int (*cmpFunc)(struct gvalue_value, struct gvalue_value));
+
+	// Searching sorted lists.
+	uint32_t (*lowerBound)(struct glist_list *list, struct gvalue_value value);
+	uint32_t (*upperBound)(struct glist_list *list, struct gvalue_value value);
+	bool (*binarySearch)(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex);
+	struct glist_eytzinger *(*createEytzinger)(struct glist_list *list);
+	uint32_t (*eytzingerLowerBound)(struct glist_eytzinger *tree, struct gvalue_value value);
+	bool (*eytzingerSearch)(struct glist_eytzinger *tree, struct gvalue_value value, uint32_t *outIndex);
+	void (*freeEytzinger)(struct glist_eytzinger *tree);
+
+	// Conversions.
+	struct glist_list *(*parseNumbers)(struct glist_list *list, const struct gvalue_type *numberType, uint32_t *outFailures);
+
 	// Destructor.
 	void (*free)(struct glist_list *list);
 
@@ -78,12 +129,26 @@ extern struct glist_list *glist_create1(struct glist_config config);
 
 extern void glist_add(struct glist_list *list, struct gvalue_value value);
 extern void glist_add1(struct glist_list *list, struct gvalue_value value, bool freeOnRemove);
+// Shifts the values from index on back by one. Not for sorted lists.
+extern void glist_insert(struct glist_list *list, uint32_t index, struct gvalue_value value);
+extern void glist_insert1(struct glist_list *list, uint32_t index, struct gvalue_value value, bool freeOnRemove);
+// Append all values, growing the list at most once. The added values are not freed on remove, also
+// those copied from a list that frees them, so that no value is freed twice.
+extern void glist_addAll(struct glist_list *list, const struct gvalue_value *values, uint32_t count);
+extern void glist_addList(struct glist_list *list, struct glist_list *source);
+// Makes room for capacity values, for producers that know their size.
+extern void glist_reserve(struct glist_list *list, uint32_t capacity);
 extern struct gvalue_value *glist_get(struct glist_list *list, uint32_t index);
 extern bool glist_tryGetIndex(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex);
 extern bool glist_tryGetLastIndex(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex);
 extern bool glist_contains(struct glist_list *list, struct gvalue_value value);
 extern bool glist_removeIndex(struct glist_list *list, uint32_t index);
 extern bool glist_remove(struct glist_list *list, struct gvalue_value value);
+// Removes the nodes from fromIndex to toIndex, both included, like glist_getSlice.
+extern bool glist_removeRange(struct glist_list *list, uint32_t fromIndex, uint32_t toIndex);
+// Remove all matching nodes in one pass and return how many were removed.
+extern uint32_t glist_removeIf(struct glist_list *list, bool (*predicate)(struct gvalue_value, void *), void *context);
+extern uint32_t glist_removeAll(struct glist_list *list, struct gvalue_value value);
 extern void glist_clear(struct glist_list *list);
 
 /*******************************************************************************************/
@@ -97,6 +162,43 @@ extern struct glist_list glist_getSlice(struct glist_list *list, uint32_t fromIn
 
 /*******************************************************************************************/
 
+// Sorting. Not stable. freeOnRemove stays with its value.
+
+// Sorts by the list's cmpFunc. With the default one, integer, pointer and interned string lists are
+// radix sorted, double and float lists go through pdqsort on integer keys, and string lists through a
+// multikey quicksort.
+extern void glist_sort(struct glist_list *list);
+extern void glist_sortWith(struct glist_list *list, int (*cmpFunc)(struct gvalue_value, struct gvalue_value));
+
+/*******************************************************************************************/
+
+// Searching sorted lists. The list must be sorted by its cmpFunc.
+
+// Index of the first value not less than value, or size if there is none.
+extern uint32_t glist_lowerBound(struct glist_list *list, struct gvalue_value value);
+// Index of the first value greater than value, or size if there is none.
+extern uint32_t glist_upperBound(struct glist_list *list, struct gvalue_value value);
+// Finds the first index of value.
+extern bool glist_binarySearch(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex);
+
+// Copies the values into a cache-friendlier layout for large lists that do not change anymore. Results
+// are indexes into list. Rebuild the tree after the list changes.
+extern struct glist_eytzinger *glist_createEytzinger(struct glist_list *list);
+extern uint32_t glist_eytzingerLowerBound(struct glist_eytzinger *tree, struct gvalue_value value);
+extern bool glist_eytzingerSearch(struct glist_eytzinger *tree, struct gvalue_value value, uint32_t *outIndex);
+extern void glist_freeEytzinger(struct glist_eytzinger *tree);
+
+/*******************************************************************************************/
+
+// Conversions.
+
+// Parses every string of list into a new list of numberType, which must be long or double. Strings are
+// checked like gvalue_tryGetLong and gvalue_tryGetDouble do. Those that do not parse become 0, so that
+// the indexes of both lists match, and are counted in outFailures if it is not NULL.
+extern struct glist_list *glist_parseNumbers(struct glist_list *list, const struct gvalue_type *numberType, uint32_t *outFailures);
+
+/*******************************************************************************************/
+
 // Destructor.
 
 extern void glist_free(struct glist_list *list);
@@ -0,0 +1,264 @@
+/**
+ * Pattern-defeating quicksort (Orson Peters), included by GenericListSort.c once per element type.
+ *
+ * Quicksort with a median-of-three (ninther for large ranges) pivot that switches to insertion sort for
+ * small ranges, finishes nearly sorted ranges with a bounded insertion sort, shuffles a few elements
+ * when a partition comes out badly unbalanced and falls back to heapsort after too many of those, so it
+ * stays O(n log n) on every input. Not stable.
+ *
+ * Before including, define:
+ *   PRIVATE_PDQ_T           the element type
+ *   PRIVATE_PDQ_NAME(name)  the name of a generated function, for example private_glist_##name##Keys
+ *   PRIVATE_PDQ_LESS(a, b)  whether element a sorts before element b; may use the parameter cmp
+ * All three are undefined again at the end of this file. There is no include guard on purpose.
+ */
+
+#define PRIVATE_PDQ_INSERTION_SORT_THRESHOLD	24
+#define PRIVATE_PDQ_NINTHER_THRESHOLD			128
+#define PRIVATE_PDQ_PARTIAL_INSERTION_LIMIT		8
+
+#define PRIVATE_PDQ_SWAP(a, b) do { PRIVATE_PDQ_T swapped = *(a); *(a) = *(b); *(b) = swapped; } while (0)
+
+void PRIVATE_PDQ_NAME(insertionSort)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end, bool leftmost,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	if (begin == end) {
+		return;
+	}
+
+	// Unless leftmost, the element before begin is no greater than any in the range and stops the shift.
+	for (PRIVATE_PDQ_T *current = begin + 1; current != end; current++) {
+		if (PRIVATE_PDQ_LESS(*current, *(current - 1))) {
+			PRIVATE_PDQ_T moved = *current;
+			PRIVATE_PDQ_T *sift = current;
+			do {
+				*sift = *(sift - 1);
+				sift--;
+			}
+			while ((leftmost == false || sift != begin) && PRIVATE_PDQ_LESS(moved, *(sift - 1)));
+			*sift = moved;
+		}
+	}
+}
+
+// Insertion sort that gives up once it had to move more than a few elements. Returns whether the
+// range is sorted.
+bool PRIVATE_PDQ_NAME(partialInsertionSort)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	if (begin == end) {
+		return true;
+	}
+
+	size_t moves = 0;
+	for (PRIVATE_PDQ_T *current = begin + 1; current != end; current++) {
+		if (PRIVATE_PDQ_LESS(*current, *(current - 1))) {
+			PRIVATE_PDQ_T moved = *current;
+			PRIVATE_PDQ_T *sift = current;
+			do {
+				*sift = *(sift - 1);
+				sift--;
+			}
+			while (sift != begin && PRIVATE_PDQ_LESS(moved, *(sift - 1)));
+			*sift = moved;
+
+			moves += (size_t) (current - sift);
+			if (moves > PRIVATE_PDQ_PARTIAL_INSERTION_LIMIT) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void PRIVATE_PDQ_NAME(sort2)(PRIVATE_PDQ_T *a, PRIVATE_PDQ_T *b, int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	if (PRIVATE_PDQ_LESS(*b, *a)) {
+		PRIVATE_PDQ_SWAP(a, b);
+	}
+}
+
+void PRIVATE_PDQ_NAME(sort3)(PRIVATE_PDQ_T *a, PRIVATE_PDQ_T *b, PRIVATE_PDQ_T *c,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	PRIVATE_PDQ_NAME(sort2)(a, b, cmp);
+	PRIVATE_PDQ_NAME(sort2)(b, c, cmp);
+	PRIVATE_PDQ_NAME(sort2)(a, b, cmp);
+}
+
+void PRIVATE_PDQ_NAME(siftDown)(PRIVATE_PDQ_T *heap, size_t size, size_t root,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	PRIVATE_PDQ_T moved = heap[root];
+	for (size_t child = 2 * root + 1; child < size; child = 2 * root + 1) {
+		if (child + 1 < size && PRIVATE_PDQ_LESS(heap[child], heap[child + 1])) {
+			child++;
+		}
+		if (PRIVATE_PDQ_LESS(moved, heap[child]) == false) {
+			break;
+		}
+		heap[root] = heap[child];
+		root = child;
+	}
+	heap[root] = moved;
+}
+
+void PRIVATE_PDQ_NAME(heapSort)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end, int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	size_t size = (size_t) (end - begin);
+	for (size_t i = size / 2; i > 0; i--) {
+		PRIVATE_PDQ_NAME(siftDown)(begin, size, i - 1, cmp);
+	}
+	for (size_t last = size; last > 1; last--) {
+		PRIVATE_PDQ_SWAP(begin, begin + last - 1);
+		PRIVATE_PDQ_NAME(siftDown)(begin, last - 1, 0, cmp);
+	}
+}
+
+// Partitions around the pivot at begin into elements less than it and elements no less than it. Returns
+// where the pivot ended up, and whether the range was already partitioned.
+PRIVATE_PDQ_T *PRIVATE_PDQ_NAME(partitionRight)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end, bool *outAlreadyPartitioned,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	PRIVATE_PDQ_T pivot = *begin;
+	PRIVATE_PDQ_T *first = begin;
+	PRIVATE_PDQ_T *last = end;
+
+	// The median-of-three guarantees an element no less than the pivot before end.
+	while (PRIVATE_PDQ_LESS(*++first, pivot)) {
+	}
+	if (first - 1 == begin) {
+		while (first < last && PRIVATE_PDQ_LESS(*--last, pivot) == false) {
+		}
+	}
+	else {
+		while (PRIVATE_PDQ_LESS(*--last, pivot) == false) {
+		}
+	}
+
+	*outAlreadyPartitioned = first >= last;
+	while (first < last) {
+		PRIVATE_PDQ_SWAP(first, last);
+		while (PRIVATE_PDQ_LESS(*++first, pivot)) {
+		}
+		while (PRIVATE_PDQ_LESS(*--last, pivot) == false) {
+		}
+	}
+
+	PRIVATE_PDQ_T *pivotPosition = first - 1;
+	*begin = *pivotPosition;
+	*pivotPosition = pivot;
+	return pivotPosition;
+}
+
+// Like partitionRight, but puts elements equal to the pivot on the left. Used when the pivot equals
+// the element before the range, so all of them are done after this.
+PRIVATE_PDQ_T *PRIVATE_PDQ_NAME(partitionLeft)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	PRIVATE_PDQ_T pivot = *begin;
+	PRIVATE_PDQ_T *first = begin;
+	PRIVATE_PDQ_T *last = end;
+
+	while (PRIVATE_PDQ_LESS(pivot, *--last)) {
+	}
+	if (last + 1 == end) {
+		while (first < last && PRIVATE_PDQ_LESS(pivot, *++first) == false) {
+		}
+	}
+	else {
+		while (PRIVATE_PDQ_LESS(pivot, *++first) == false) {
+		}
+	}
+
+	while (first < last) {
+		PRIVATE_PDQ_SWAP(first, last);
+		while (PRIVATE_PDQ_LESS(pivot, *--last)) {
+		}
+		while (PRIVATE_PDQ_LESS(pivot, *++first) == false) {
+		}
+	}
+
+	*begin = *last;
+	*last = pivot;
+	return last;
+}
+
+// Moves a few elements of a badly unbalanced side to break up the pattern that caused it.
+void PRIVATE_PDQ_NAME(breakPatterns)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end) {
+	size_t size = (size_t) (end - begin);
+	if (size < PRIVATE_PDQ_INSERTION_SORT_THRESHOLD) {
+		return;
+	}
+
+	size_t quarter = size / 4;
+	PRIVATE_PDQ_SWAP(begin, begin + quarter);
+	PRIVATE_PDQ_SWAP(end - 1, end - quarter);
+	if (size > PRIVATE_PDQ_NINTHER_THRESHOLD) {
+		PRIVATE_PDQ_SWAP(begin + 1, begin + (quarter + 1));
+		PRIVATE_PDQ_SWAP(begin + 2, begin + (quarter + 2));
+		PRIVATE_PDQ_SWAP(end - 2, end - (quarter + 1));
+		PRIVATE_PDQ_SWAP(end - 3, end - (quarter + 2));
+	}
+}
+
+void PRIVATE_PDQ_NAME(loop)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end, int badAllowed, bool leftmost,
+		int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	while (true) {
+		size_t size = (size_t) (end - begin);
+		if (size < PRIVATE_PDQ_INSERTION_SORT_THRESHOLD) {
+			PRIVATE_PDQ_NAME(insertionSort)(begin, end, leftmost, cmp);
+			return;
+		}
+
+		size_t half = size / 2;
+		if (size > PRIVATE_PDQ_NINTHER_THRESHOLD) {
+			PRIVATE_PDQ_NAME(sort3)(begin, begin + half, end - 1, cmp);
+			PRIVATE_PDQ_NAME(sort3)(begin + 1, begin + (half - 1), end - 2, cmp);
+			PRIVATE_PDQ_NAME(sort3)(begin + 2, begin + (half + 1), end - 3, cmp);
+			PRIVATE_PDQ_NAME(sort3)(begin + (half - 1), begin + half, begin + (half + 1), cmp);
+			PRIVATE_PDQ_SWAP(begin, begin + half);
+		}
+		else {
+			PRIVATE_PDQ_NAME(sort3)(begin + half, begin, end - 1, cmp);
+		}
+
+		// Equal to the element before the range, which is its upper bound: many equal elements.
+		if (leftmost == false && PRIVATE_PDQ_LESS(*(begin - 1), *begin) == false) {
+			begin = PRIVATE_PDQ_NAME(partitionLeft)(begin, end, cmp) + 1;
+			continue;
+		}
+
+		bool alreadyPartitioned;
+		PRIVATE_PDQ_T *pivot = PRIVATE_PDQ_NAME(partitionRight)(begin, end, &alreadyPartitioned, cmp);
+		size_t leftSize = (size_t) (pivot - begin);
+		size_t rightSize = (size_t) (end - (pivot + 1));
+
+		if (leftSize < size / 8 || rightSize < size / 8) {
+			if (--badAllowed == 0) {
+				PRIVATE_PDQ_NAME(heapSort)(begin, end, cmp);
+				return;
+			}
+			PRIVATE_PDQ_NAME(breakPatterns)(begin, pivot);
+			PRIVATE_PDQ_NAME(breakPatterns)(pivot + 1, end);
+		}
+		else if (alreadyPartitioned
+				&& PRIVATE_PDQ_NAME(partialInsertionSort)(begin, pivot, cmp)
+				&& PRIVATE_PDQ_NAME(partialInsertionSort)(pivot + 1, end, cmp)) {
+			return;
+		}
+
+		// Recurse into the left side and loop on the right one.
+		PRIVATE_PDQ_NAME(loop)(begin, pivot, badAllowed, leftmost, cmp);
+		begin = pivot + 1;
+		leftmost = false;
+	}
+}
+
+void PRIVATE_PDQ_NAME(sort)(PRIVATE_PDQ_T *begin, PRIVATE_PDQ_T *end, int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	int badAllowed = 1;
+	for (size_t size = (size_t) (end - begin); size > 1; size >>= 1) {
+		badAllowed++;
+	}
+	PRIVATE_PDQ_NAME(loop)(begin, end, badAllowed, true, cmp);
+}
+
+#undef PRIVATE_PDQ_SWAP
+#undef PRIVATE_PDQ_INSERTION_SORT_THRESHOLD
+#undef PRIVATE_PDQ_NINTHER_THRESHOLD
+#undef PRIVATE_PDQ_PARTIAL_INSERTION_LIMIT
+#undef PRIVATE_PDQ_T
+#undef PRIVATE_PDQ_NAME
+#undef PRIVATE_PDQ_LESS
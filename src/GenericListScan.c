@@ -0,0 +1,298 @@
+/**
+ * Equality search in lists of integers, chars, pointers and interned strings.
+ *
+ * The values of such lists are equal exactly when their bytes are, so with the default compare function
+ * glist_tryGetIndex, glist_tryGetLastIndex and glist_contains do not need to call it at all. In nodes the
+ * values are compared directly, as integers of the right width. Packed lists keep them next to each
+ * other, so there they are compared 16 bytes per instruction with SSE2, or 32 with AVX2 when the CPU has
+ * it. Which one is used is decided once, on the first search. Other targets compare one value at a time.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRIVATE_GLIST_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 functions are compiled with a target attribute, so the rest of the build needs no -mavx2.
+#if defined(PRIVATE_GLIST_SCAN_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PRIVATE_GLIST_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+#include "GenericList.h"
+
+// Not found, as returned by the column scans.
+#define PRIVATE_GLIST_SCAN_NONE SIZE_MAX
+
+// Scans count values of width bytes for needle and returns the first index, or the last with last set.
+// Chosen on the first search.
+size_t (*private_glist_scanColumn)(const unsigned char *column, size_t count, size_t width,
+		const unsigned char *needle, bool last) = NULL;
+
+/*******************************************************************************************/
+
+// Column scans.
+
+size_t private_glist_scanScalar(const unsigned char *column, size_t count, size_t width, const unsigned char *needle, bool last) {
+	for (size_t n = 0; n < count; n++) {
+		size_t i = last ? count - 1 - n : n;
+		if (memcmp(column + i * width, needle, width) == 0) {
+			return i;
+		}
+	}
+	return PRIVATE_GLIST_SCAN_NONE;
+}
+
+uint32_t private_glist_lowestBit(uint32_t mask) {
+#if defined(__GNUC__)
+	return (uint32_t) __builtin_ctz(mask);
+#else
+	uint32_t bit = 0;
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+uint32_t private_glist_highestBit(uint32_t mask) {
+#if defined(__GNUC__)
+	return 31 - (uint32_t) __builtin_clz(mask);
+#else
+	uint32_t bit = 31;
+	while ((mask & (UINT32_C(1) << bit)) == 0) {
+		bit--;
+	}
+	return bit;
+#endif
+}
+
+#ifdef PRIVATE_GLIST_SCAN_SSE2
+
+// A bit per byte of the 16 bytes at chunk. Matching values set all of their bits.
+uint32_t private_glist_matchSse2(const unsigned char *chunk, __m128i needles, size_t width) {
+	__m128i bytes = _mm_loadu_si128((const __m128i *) chunk);
+	__m128i equal;
+	switch (width) {
+	case 1:
+		equal = _mm_cmpeq_epi8(bytes, needles);
+		break;
+	case 2:
+		equal = _mm_cmpeq_epi16(bytes, needles);
+		break;
+	case 4:
+		equal = _mm_cmpeq_epi32(bytes, needles);
+		break;
+	default:
+		// SSE2 has no 64-bit compare, so both halves must be equal.
+		equal = _mm_cmpeq_epi32(bytes, needles);
+		equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+		break;
+	}
+	return (uint32_t) _mm_movemask_epi8(equal);
+}
+
+__m128i private_glist_needlesSse2(const unsigned char *needle, size_t width) {
+	unsigned char repeated[16];
+	for (size_t i = 0; i < 16; i += width) {
+		memcpy(repeated + i, needle, width);
+	}
+	return _mm_loadu_si128((const __m128i *) repeated);
+}
+
+size_t private_glist_scanSse2(const unsigned char *column, size_t count, size_t width, const unsigned char *needle, bool last) {
+	__m128i needles = private_glist_needlesSse2(needle, width);
+	size_t bytes = count * width;
+	size_t tail = bytes % 16;
+
+	if (last == false) {
+		for (size_t at = 0; at + 16 <= bytes; at += 16) {
+			uint32_t mask = private_glist_matchSse2(column + at, needles, width);
+			if (mask != 0) {
+				return (at + private_glist_lowestBit(mask)) / width;
+			}
+		}
+		size_t i = private_glist_scanScalar(column + bytes - tail, tail / width, width, needle, false);
+		return (i == PRIVATE_GLIST_SCAN_NONE) ? i : (bytes - tail) / width + i;
+	}
+
+	size_t i = private_glist_scanScalar(column + bytes - tail, tail / width, width, needle, true);
+	if (i != PRIVATE_GLIST_SCAN_NONE) {
+		return (bytes - tail) / width + i;
+	}
+	for (size_t at = bytes - tail; at >= 16; at -= 16) {
+		uint32_t mask = private_glist_matchSse2(column + at - 16, needles, width);
+		if (mask != 0) {
+			return (at - 16 + private_glist_highestBit(mask)) / width;
+		}
+	}
+	return PRIVATE_GLIST_SCAN_NONE;
+}
+
+#endif
+
+#ifdef PRIVATE_GLIST_SCAN_AVX2
+
+__attribute__((target("avx2")))
+uint32_t private_glist_matchAvx2(const unsigned char *chunk, __m256i needles, size_t width) {
+	__m256i bytes = _mm256_loadu_si256((const __m256i *) chunk);
+	__m256i equal;
+	switch (width) {
+	case 1:
+		equal = _mm256_cmpeq_epi8(bytes, needles);
+		break;
+	case 2:
+		equal = _mm256_cmpeq_epi16(bytes, needles);
+		break;
+	case 4:
+		equal = _mm256_cmpeq_epi32(bytes, needles);
+		break;
+	default:
+		equal = _mm256_cmpeq_epi64(bytes, needles);
+		break;
+	}
+	return (uint32_t) _mm256_movemask_epi8(equal);
+}
+
+__attribute__((target("avx2")))
+size_t private_glist_scanAvx2(const unsigned char *column, size_t count, size_t width, const unsigned char *needle, bool last) {
+	unsigned char repeated[32];
+	for (size_t i = 0; i < 32; i += width) {
+		memcpy(repeated + i, needle, width);
+	}
+	__m256i needles = _mm256_loadu_si256((const __m256i *) repeated);
+	size_t bytes = count * width;
+	size_t tail = bytes % 32;
+
+	if (last == false) {
+		for (size_t at = 0; at + 32 <= bytes; at += 32) {
+			uint32_t mask = private_glist_matchAvx2(column + at, needles, width);
+			if (mask != 0) {
+				return (at + private_glist_lowestBit(mask)) / width;
+			}
+		}
+		size_t i = private_glist_scanSse2(column + bytes - tail, tail / width, width, needle, false);
+		return (i == PRIVATE_GLIST_SCAN_NONE) ? i : (bytes - tail) / width + i;
+	}
+
+	size_t i = private_glist_scanSse2(column + bytes - tail, tail / width, width, needle, true);
+	if (i != PRIVATE_GLIST_SCAN_NONE) {
+		return (bytes - tail) / width + i;
+	}
+	for (size_t at = bytes - tail; at >= 32; at -= 32) {
+		uint32_t mask = private_glist_matchAvx2(column + at - 32, needles, width);
+		if (mask != 0) {
+			return (at - 32 + private_glist_highestBit(mask)) / width;
+		}
+	}
+	return PRIVATE_GLIST_SCAN_NONE;
+}
+
+#endif
+
+void private_glist_chooseScan(void) {
+#if defined(PRIVATE_GLIST_SCAN_AVX2)
+	__builtin_cpu_init();
+	private_glist_scanColumn = __builtin_cpu_supports("avx2") ? private_glist_scanAvx2 : private_glist_scanSse2;
+#elif defined(PRIVATE_GLIST_SCAN_SSE2)
+	private_glist_scanColumn = private_glist_scanSse2;
+#else
+	private_glist_scanColumn = private_glist_scanScalar;
+#endif
+}
+
+/*******************************************************************************************/
+
+// Lists.
+
+// Bytes per value of the types whose values are equal exactly when their bytes are, or 0.
+size_t private_glist_scanWidth(int code) {
+	switch (code) {
+	case GVALUE_TYPE_BOOL:
+		return sizeof(bool);
+	case GVALUE_TYPE_BYTE:
+	case GVALUE_TYPE_UBYTE:
+	case GVALUE_TYPE_CHAR:
+		return 1;
+	case GVALUE_TYPE_SHORT:
+	case GVALUE_TYPE_USHORT:
+		return 2;
+	case GVALUE_TYPE_INT:
+	case GVALUE_TYPE_UINT:
+		return 4;
+	case GVALUE_TYPE_LONG:
+	case GVALUE_TYPE_ULONG:
+		return 8;
+	case GVALUE_TYPE_WCHAR:
+		return sizeof(wchar_t);
+	case GVALUE_TYPE_POINTER:
+	case GVALUE_TYPE_ISTRING:
+		return sizeof(void *);
+	default:
+		return 0;
+	}
+}
+
+// Index of the first node, or the last with last set, whose value has the bits of needle, or size.
+#define PRIVATE_GLIST_SCAN(nodes, size, member, needle, last, outIndex) do { \
+		uint32_t private_i; \
+		if (last) { \
+			for (private_i = (size); private_i > 0 && (nodes)[private_i - 1].value.primitive.member != (needle); private_i--); \
+			*(outIndex) = (private_i == 0) ? (size) : private_i - 1; \
+		} \
+		else { \
+			for (private_i = 0; private_i < (size) && (nodes)[private_i].value.primitive.member != (needle); private_i++); \
+			*(outIndex) = private_i; \
+		} \
+	} while (0)
+
+// Searches without calling cmpFunc where that gives the same result. Returns false when the list needs
+// the regular search, otherwise sets outFound and, if found, outIndex.
+bool private_glist_tryScan(struct glist_list *list, struct gvalue_value value, bool last, bool *outFound, uint32_t *outIndex) {
+	size_t width = private_glist_scanWidth(list->config.dataType->code);
+	if (width == 0 || list->config.cmpFunc != gvalue_cmp || value.type != list->config.dataType) {
+		return false;
+	}
+
+	if (list->config.packedStorage) {
+		if (private_glist_scanColumn == NULL) {
+			private_glist_chooseScan();
+		}
+		size_t i = private_glist_scanColumn((const unsigned char *) list->values, list->size, width,
+				(const unsigned char *) &(value.primitive), last);
+		*outFound = (i != PRIVATE_GLIST_SCAN_NONE);
+		if (*outFound) {
+			*outIndex = (uint32_t) i;
+		}
+		return true;
+	}
+
+	// Every member of the union starts at its first byte, so the unsigned member of the same width
+	// holds the same bits.
+	uint32_t index;
+	switch (width) {
+	case 1:
+		PRIVATE_GLIST_SCAN(list->nodes, list->size, ubyteValue, value.primitive.ubyteValue, last, &index);
+		break;
+	case 2:
+		PRIVATE_GLIST_SCAN(list->nodes, list->size, ushortValue, value.primitive.ushortValue, last, &index);
+		break;
+	case 4:
+		PRIVATE_GLIST_SCAN(list->nodes, list->size, uintValue, value.primitive.uintValue, last, &index);
+		break;
+	default:
+		PRIVATE_GLIST_SCAN(list->nodes, list->size, ulongValue, value.primitive.ulongValue, last, &index);
+		break;
+	}
+
+	*outFound = (index < list->size);
+	if (*outFound) {
+		*outIndex = index;
+	}
+	return true;
+}
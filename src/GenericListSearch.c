@@ -0,0 +1,186 @@
+/**
+ * Binary search in sorted generic value lists.
+ *
+ * glist_lowerBound, glist_upperBound and glist_binarySearch work on any list that is sorted by its
+ * cmpFunc, for example after glist_sort or when glist_config.sorted keeps it so. For large lists that
+ * are searched much more often than they change, glist_createEytzinger copies the values into the order
+ * of a breadth-first walk of the implicit search tree (Eytzinger layout). The first levels then share a
+ * few cache lines, and the next levels can be prefetched while the current one is compared.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "GenericList.h"
+
+extern bool private_glist_hasOrderedKey(int code);
+extern uint64_t private_glist_orderedKey(struct gvalue_value value);
+extern struct gvalue_value private_glist_valueAt(struct glist_list *list, uint32_t index);
+
+/*******************************************************************************************/
+
+// Binary search.
+
+// With the default compare function all values have the list's type, so its own compare function can be
+// called directly.
+int (*private_glist_searchCmp(struct glist_list *list))(struct gvalue_value, struct gvalue_value) {
+	int (*cmpFunc)(struct gvalue_value, struct gvalue_value) = list->config.cmpFunc;
+	return (cmpFunc == gvalue_cmp) ? list->config.dataType->cmp : cmpFunc;
+}
+
+uint32_t glist_lowerBound(struct glist_list *list, struct gvalue_value value) {
+	int (*cmp)(struct gvalue_value, struct gvalue_value) = private_glist_searchCmp(list);
+	uint32_t base = 0;
+	uint32_t count = list->size;
+
+	while (count > 0) {
+		uint32_t half = count / 2;
+		if (cmp(private_glist_valueAt(list, base + half), value) < 0) {
+			base += half + 1;
+			count -= half + 1;
+		}
+		else {
+			count = half;
+		}
+	}
+	return base;
+}
+
+uint32_t glist_upperBound(struct glist_list *list, struct gvalue_value value) {
+	int (*cmp)(struct gvalue_value, struct gvalue_value) = private_glist_searchCmp(list);
+	uint32_t base = 0;
+	uint32_t count = list->size;
+
+	while (count > 0) {
+		uint32_t half = count / 2;
+		if (cmp(private_glist_valueAt(list, base + half), value) <= 0) {
+			base += half + 1;
+			count -= half + 1;
+		}
+		else {
+			count = half;
+		}
+	}
+	return base;
+}
+
+bool glist_binarySearch(struct glist_list *list, struct gvalue_value value, uint32_t *outIndex) {
+	uint32_t index = glist_lowerBound(list, value);
+	if (index == list->size || list->config.cmpFunc(value, private_glist_valueAt(list, index)) != 0) {
+		return false;
+	}
+
+	*outIndex = index;
+	return true;
+}
+
+/*******************************************************************************************/
+
+// Eytzinger layout.
+
+// Fills slots from slot on in order of an in-order walk, so that the left subtree of every slot holds
+// smaller values. Returns the next index of the list to take.
+uint32_t private_glist_fillEytzinger(struct glist_eytzinger *tree, struct glist_list *list, uint32_t index, uint32_t slot) {
+	if (slot <= tree->size) {
+		index = private_glist_fillEytzinger(tree, list, index, 2 * slot);
+		if (tree->keys != NULL) {
+			tree->keys[slot] = private_glist_orderedKey(private_glist_valueAt(list, index));
+		}
+		else {
+			tree->values[slot] = private_glist_valueAt(list, index);
+		}
+		tree->indexes[slot] = index++;
+		index = private_glist_fillEytzinger(tree, list, index, 2 * slot + 1);
+	}
+	return index;
+}
+
+struct glist_eytzinger *glist_createEytzinger(struct glist_list *list) {
+	int (*cmp)(struct gvalue_value, struct gvalue_value) = private_glist_searchCmp(list);
+	for (uint32_t i = 1; i < list->size; i++) {
+		if (cmp(private_glist_valueAt(list, i - 1), private_glist_valueAt(list, i)) > 0) {
+			printf("Error: glist: createEytzinger needs a sorted list. Unsorted at index=%" PRIu32 "\n", i);
+			return NULL;
+		}
+	}
+
+	struct glist_eytzinger *tree = (struct glist_eytzinger *) malloc(sizeof(struct glist_eytzinger));
+	tree->size = list->size;
+	tree->cmpFunc = cmp;
+	tree->keys = NULL;
+	tree->values = NULL;
+
+	// Slot 0 is unused, so that the children of slot k are 2k and 2k + 1.
+	if (list->config.cmpFunc == gvalue_cmp && private_glist_hasOrderedKey(list->config.dataType->code)) {
+		tree->keys = malloc(sizeof(uint64_t) * ((size_t) list->size + 1));
+	}
+	else {
+		tree->values = malloc(sizeof(struct gvalue_value) * ((size_t) list->size + 1));
+	}
+	tree->indexes = malloc(sizeof(uint32_t) * ((size_t) list->size + 1));
+	tree->indexes[0] = list->size;
+
+	private_glist_fillEytzinger(tree, list, 0, 1);
+	return tree;
+}
+
+// Returns the slot of the first value not less than value, or 0 if there is none.
+size_t private_glist_eytzingerSlot(struct glist_eytzinger *tree, struct gvalue_value value) {
+	size_t slot = 1;
+
+	if (tree->keys != NULL) {
+		uint64_t key = private_glist_orderedKey(value);
+		while (slot <= tree->size) {
+#if defined(__GNUC__)
+			// The 16 slots four levels down are two cache lines.
+			__builtin_prefetch(tree->keys + 16 * slot);
+#endif
+			slot = 2 * slot + (tree->keys[slot] < key);
+		}
+	}
+	else {
+		while (slot <= tree->size) {
+#if defined(__GNUC__)
+			// The 4 slots two levels down span up to three cache lines.
+			__builtin_prefetch(tree->values + 4 * slot);
+			__builtin_prefetch(tree->values + 4 * slot + 2);
+			__builtin_prefetch(tree->values + 4 * slot + 3);
+#endif
+			slot = 2 * slot + (tree->cmpFunc(tree->values[slot], value) < 0);
+		}
+	}
+
+	// The lower bound is where the path last turned left. Dropping the right turns after it and that left
+	// turn gives its slot, or 0 if the path never turned left.
+	while ((slot & 1) != 0) {
+		slot >>= 1;
+	}
+	return slot >> 1;
+}
+
+uint32_t glist_eytzingerLowerBound(struct glist_eytzinger *tree, struct gvalue_value value) {
+	return tree->indexes[private_glist_eytzingerSlot(tree, value)];
+}
+
+// The tree holds copies of the values or exact keys, so the list itself is not touched.
+bool glist_eytzingerSearch(struct glist_eytzinger *tree, struct gvalue_value value, uint32_t *outIndex) {
+	size_t slot = private_glist_eytzingerSlot(tree, value);
+	if (slot == 0) {
+		return false;
+	}
+	if (tree->keys != NULL ? tree->keys[slot] != private_glist_orderedKey(value)
+			: tree->cmpFunc(value, tree->values[slot]) != 0) {
+		return false;
+	}
+
+	*outIndex = tree->indexes[slot];
+	return true;
+}
+
+void glist_freeEytzinger(struct glist_eytzinger *tree) {
+	free(tree->keys);
+	free(tree->values);
+	free(tree->indexes);
+	free(tree);
+}
@@ -0,0 +1,341 @@
+/**
+ * Sorting of generic value lists.
+ *
+ * With the default compare function, the list's data type picks the algorithm. Integers, pointers and
+ * interned strings are mapped to unsigned 64-bit keys with the same order and sorted with an LSD radix
+ * sort, doubles and floats get the same kind of keys and go through pdqsort, and strings use a multikey
+ * quicksort that looks at every character only about once. All of these sort small (key, index) pairs
+ * and move the nodes only once at the end, so freeOnRemove stays with its value. Everything else, and
+ * any custom compare function, uses pdqsort on the nodes. Packed lists are unpacked into nodes first.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GenericList.h"
+
+extern struct gvalue_value private_glist_valueAt(struct glist_list *list, uint32_t index);
+extern bool private_glist_freeOnRemoveAt(struct glist_list *list, uint32_t index);
+extern void private_glist_setAt(struct glist_list *list, uint32_t index, struct gvalue_value value, bool freeOnRemove);
+
+// Below this size pdqsort on the keys beats the fixed passes of the radix sort.
+#define PRIVATE_GLIST_RADIX_THRESHOLD 256
+
+// Below this size the multikey quicksort hands over to an insertion sort.
+#define PRIVATE_GLIST_STRING_INSERTION_THRESHOLD 16
+
+struct private_glist_sortKey {
+	uint64_t key;
+	uint32_t index;
+};
+
+struct private_glist_stringKey {
+	const unsigned char *chars;
+	uint32_t index;
+};
+
+/*******************************************************************************************/
+
+// pdqsort instances.
+
+#define PRIVATE_PDQ_T struct private_glist_sortKey
+#define PRIVATE_PDQ_NAME(name) private_glist_##name##Keys
+#define PRIVATE_PDQ_LESS(a, b) ((a).key < (b).key)
+#include "GenericListPdqsort.h"
+
+#define PRIVATE_PDQ_T struct glist_node
+#define PRIVATE_PDQ_NAME(name) private_glist_##name##Nodes
+#define PRIVATE_PDQ_LESS(a, b) (cmp((a).value, (b).value) < 0)
+#include "GenericListPdqsort.h"
+
+/*******************************************************************************************/
+
+// Keys.
+
+bool private_glist_hasOrderedKey(int code) {
+	switch (code) {
+	case GVALUE_TYPE_BOOL:
+	case GVALUE_TYPE_BYTE:
+	case GVALUE_TYPE_SHORT:
+	case GVALUE_TYPE_INT:
+	case GVALUE_TYPE_LONG:
+	case GVALUE_TYPE_UBYTE:
+	case GVALUE_TYPE_USHORT:
+	case GVALUE_TYPE_UINT:
+	case GVALUE_TYPE_ULONG:
+	case GVALUE_TYPE_FLOAT:
+	case GVALUE_TYPE_DOUBLE:
+	case GVALUE_TYPE_POINTER:
+	case GVALUE_TYPE_CHAR:
+	case GVALUE_TYPE_WCHAR:
+	case GVALUE_TYPE_ISTRING:
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint64_t private_glist_signedKey(int64_t i) {
+	return (uint64_t) i ^ (UINT64_C(1) << 63);
+}
+
+// Same order as gvalue_cmp: -0.0 equals 0.0 and all NaNs are equal and greater than everything else.
+uint64_t private_glist_doubleKey(double d) {
+	if (d != d) {
+		return UINT64_MAX;
+	}
+	if (d == 0) {
+		d = 0;
+	}
+
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	return ((bits >> 63) != 0) ? ~bits : bits | (UINT64_C(1) << 63);
+}
+
+uint64_t private_glist_orderedKey(struct gvalue_value value) {
+	switch (value.type->code) {
+	case GVALUE_TYPE_BOOL:
+		return value.primitive.boolValue ? 1 : 0;
+	case GVALUE_TYPE_BYTE:
+		return private_glist_signedKey(value.primitive.byteValue);
+	case GVALUE_TYPE_SHORT:
+		return private_glist_signedKey(value.primitive.shortValue);
+	case GVALUE_TYPE_INT:
+		return private_glist_signedKey(value.primitive.intValue);
+	case GVALUE_TYPE_LONG:
+		return private_glist_signedKey(value.primitive.longValue);
+	case GVALUE_TYPE_UBYTE:
+		return value.primitive.ubyteValue;
+	case GVALUE_TYPE_USHORT:
+		return value.primitive.ushortValue;
+	case GVALUE_TYPE_UINT:
+		return value.primitive.uintValue;
+	case GVALUE_TYPE_ULONG:
+		return value.primitive.ulongValue;
+	case GVALUE_TYPE_FLOAT:
+		return private_glist_doubleKey(value.primitive.floatValue);
+	case GVALUE_TYPE_DOUBLE:
+		return private_glist_doubleKey(value.primitive.doubleValue);
+	case GVALUE_TYPE_CHAR:
+		return private_glist_signedKey(value.primitive.charValue);
+	case GVALUE_TYPE_WCHAR:
+		return private_glist_signedKey(value.primitive.wcharValue);
+	default:
+		// Pointers and interned strings, which compare by address.
+		return (uint64_t) (uintptr_t) value.primitive.pointerValue;
+	}
+}
+
+/*******************************************************************************************/
+
+// Algorithms.
+
+// Sorts by one byte per pass, lowest first, skipping bytes that are the same in all keys. Returns
+// whichever of keys and buffer holds the result.
+struct private_glist_sortKey *private_glist_radixSort(struct private_glist_sortKey *keys,
+		struct private_glist_sortKey *buffer, size_t count) {
+	size_t (*counts)[256] = calloc(8, sizeof(*counts));
+
+	for (size_t i = 0; i < count; i++) {
+		uint64_t key = keys[i].key;
+		for (int b = 0; b < 8; b++) {
+			counts[b][(key >> (8 * b)) & 0xFF]++;
+		}
+	}
+
+	for (int b = 0; b < 8; b++) {
+		if (counts[b][(keys[0].key >> (8 * b)) & 0xFF] == count) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for (int digit = 0; digit < 256; digit++) {
+			size_t digitCount = counts[b][digit];
+			counts[b][digit] = offset;
+			offset += digitCount;
+		}
+		for (size_t i = 0; i < count; i++) {
+			buffer[counts[b][(keys[i].key >> (8 * b)) & 0xFF]++] = keys[i];
+		}
+
+		struct private_glist_sortKey *swapped = keys;
+		keys = buffer;
+		buffer = swapped;
+	}
+
+	free(counts);
+	return keys;
+}
+
+// Orders like strcmp from depth on.
+int private_glist_cmpFrom(const unsigned char *chars1, const unsigned char *chars2, size_t depth) {
+	return strcmp((const char *) chars1 + depth, (const char *) chars2 + depth);
+}
+
+// Multikey quicksort (Bentley and Sedgewick): a three-way partition on the character at depth, then
+// the equal part moves on to the next character. All keys agree on the characters before depth.
+void private_glist_multikeySort(struct private_glist_stringKey *keys, size_t count, size_t depth) {
+	while (count > 1) {
+		if (count < PRIVATE_GLIST_STRING_INSERTION_THRESHOLD) {
+			for (size_t i = 1; i < count; i++) {
+				struct private_glist_stringKey moved = keys[i];
+				size_t j = i;
+				for (; j > 0 && private_glist_cmpFrom(moved.chars, keys[j - 1].chars, depth) < 0; j--) {
+					keys[j] = keys[j - 1];
+				}
+				keys[j] = moved;
+			}
+			return;
+		}
+
+		// Median of three characters as the pivot.
+		unsigned char a = keys[0].chars[depth];
+		unsigned char b = keys[count / 2].chars[depth];
+		unsigned char c = keys[count - 1].chars[depth];
+		unsigned char pivot = (a < b) ? ((b < c) ? b : (a < c) ? c : a) : ((a < c) ? a : (b < c) ? c : b);
+
+		size_t less = 0;
+		size_t i = 0;
+		size_t greater = count;
+		while (i < greater) {
+			unsigned char ch = keys[i].chars[depth];
+			if (ch < pivot) {
+				struct private_glist_stringKey swapped = keys[less];
+				keys[less++] = keys[i];
+				keys[i++] = swapped;
+			}
+			else if (ch > pivot) {
+				struct private_glist_stringKey swapped = keys[--greater];
+				keys[greater] = keys[i];
+				keys[i] = swapped;
+			}
+			else {
+				i++;
+			}
+		}
+
+		private_glist_multikeySort(keys, less, depth);
+		private_glist_multikeySort(keys + greater, count - greater, depth);
+
+		// Strings that ended at depth are equal and done.
+		if (pivot == '\0') {
+			return;
+		}
+		keys += less;
+		count = greater - less;
+		depth++;
+	}
+}
+
+// Puts the node at index order[i] at position i for all i, following the cycles of the permutation
+// so that no second node array is needed. Overwrites order.
+void private_glist_permute(struct glist_node *nodes, uint32_t *order, size_t count, size_t stride) {
+	for (size_t i = 0; i < count; i++) {
+		uint32_t *next = (uint32_t *) ((char *) order + i * stride);
+		if (*next == i) {
+			continue;
+		}
+
+		struct glist_node moved = nodes[i];
+		size_t j = i;
+		while (true) {
+			uint32_t *at = (uint32_t *) ((char *) order + j * stride);
+			size_t k = *at;
+			*at = (uint32_t) j;
+			if (k == i) {
+				nodes[j] = moved;
+				break;
+			}
+			nodes[j] = nodes[k];
+			j = k;
+		}
+	}
+}
+
+void private_glist_sortByKeys(struct glist_list *list) {
+	size_t count = list->size;
+	struct private_glist_sortKey *keys = malloc(sizeof(struct private_glist_sortKey) * count);
+	for (size_t i = 0; i < count; i++) {
+		keys[i].key = private_glist_orderedKey(list->nodes[i].value);
+		keys[i].index = (uint32_t) i;
+	}
+
+	struct private_glist_sortKey *sorted = keys;
+	struct private_glist_sortKey *buffer = NULL;
+	int code = list->config.dataType->code;
+	if (count < PRIVATE_GLIST_RADIX_THRESHOLD || code == GVALUE_TYPE_FLOAT || code == GVALUE_TYPE_DOUBLE) {
+		private_glist_sortKeys(keys, keys + count, NULL);
+	}
+	else {
+		buffer = malloc(sizeof(struct private_glist_sortKey) * count);
+		sorted = private_glist_radixSort(keys, buffer, count);
+	}
+
+	private_glist_permute(list->nodes, &(sorted[0].index), count, sizeof(struct private_glist_sortKey));
+	free(buffer);
+	free(keys);
+}
+
+void private_glist_sortStrings(struct glist_list *list) {
+	size_t count = list->size;
+	struct private_glist_stringKey *keys = malloc(sizeof(struct private_glist_stringKey) * count);
+
+	// Short strings point into their node, which stays where it is until the end.
+	for (size_t i = 0; i < count; i++) {
+		keys[i].chars = (const unsigned char *) gvalue_stringChars(&(list->nodes[i].value));
+		keys[i].index = (uint32_t) i;
+	}
+
+	private_glist_multikeySort(keys, count, 0);
+	private_glist_permute(list->nodes, &(keys[0].index), count, sizeof(struct private_glist_stringKey));
+	free(keys);
+}
+
+/*******************************************************************************************/
+
+// Sorting.
+
+void glist_sort(struct glist_list *list) {
+	glist_sortWith(list, list->config.cmpFunc);
+}
+
+void glist_sortWith(struct glist_list *list, int (*cmpFunc)(struct gvalue_value, struct gvalue_value)) {
+	if (list->size < 2) {
+		return;
+	}
+
+	// Packed values are sorted as nodes and packed again.
+	if (list->config.packedStorage) {
+		struct glist_list unpacked = *list;
+		unpacked.config.packedStorage = false;
+		unpacked.nodes = malloc(sizeof(struct glist_node) * list->size);
+		for (uint32_t i = 0; i < list->size; i++) {
+			unpacked.nodes[i].value = private_glist_valueAt(list, i);
+			unpacked.nodes[i].freeOnRemove = private_glist_freeOnRemoveAt(list, i);
+		}
+
+		glist_sortWith(&unpacked, cmpFunc);
+		for (uint32_t i = 0; i < list->size; i++) {
+			private_glist_setAt(list, i, unpacked.nodes[i].value, unpacked.nodes[i].freeOnRemove);
+		}
+		free(unpacked.nodes);
+		return;
+	}
+
+	int code = list->config.dataType->code;
+	if (cmpFunc == gvalue_cmp && private_glist_hasOrderedKey(code)) {
+		private_glist_sortByKeys(list);
+	}
+	else if (cmpFunc == gvalue_cmp && (code == GVALUE_TYPE_STRING || code == GVALUE_TYPE_SSTRING)) {
+		private_glist_sortStrings(list);
+	}
+	else {
+		// Values all have the list's type, so its compare function can be called directly.
+		if (cmpFunc == gvalue_cmp) {
+			cmpFunc = list->config.dataType->cmp;
+		}
+		private_glist_sortNodes(list->nodes, list->nodes + list->size, cmpFunc);
+	}
+}
@@ -14,12 +14,16 @@
 
 #include "GenericMap.h"
 
+// Maps with config.weakKeys, linked through nextWeakMap. Not thread-safe.
+struct gmap_map *private_gmap_weakMaps = NULL;
+
 // OOP class object.
 struct gmap_class gmap = {
 
 		// Constructors.
 		.create = gmap_create,
 		.create1 = gmap_create1,
+		.createIdentity = gmap_createIdentity,
 
 		// Basic operations.
 		.put = gmap_put,
@@ -35,11 +39,18 @@ struct gmap_class gmap = {
 		.next = gmap_next,
 		.getKeyValueList = gmap_getKeyValueList,
 		.freeKeyValueList = gmap_freeKeyValueList,
+		.equals = gmap_equals,
+		.forgetObject = gmap_forgetObject,
 		.each = gmap_each,
+		.scan = gmap_scan,
 		.print = gmap_print,
 		.fprint = gmap_fprint,
 		.hashDeviation = gmap_hashDeviation,
 
+		// Persistence.
+		.saveBinary = gmap_saveBinary,
+		.loadBinary = gmap_loadBinary,
+
 		// Destructor.
 		.free = gmap_free
 
@@ -60,6 +71,16 @@ struct gmap_map *gmap_create1(struct gmap_config config) {
 		return NULL;
 	}
 
+	if (config.compactStorage && (config.maintainInsertionOrder || gvalue_isCompactType(config.keyType) == false)) {
+		printf("Error: gmap: compactStorage needs a compact keyType and no insertion order\n");
+		return NULL;
+	}
+
+	if (config.weakKeys && config.keyType != gvalue.pointerType) {
+		printf("Error: gmap: weakKeys needs keys of type pointer instead of %s\n", config.keyType->name);
+		return NULL;
+	}
+
 	// Minimum capacity of 1 is to make sure we don't use calloc with a size of 0.
 	// Otherwise we can allow for a minimum capacity of 0.
 	if (config.capacity < 1) {
@@ -71,12 +92,14 @@ struct gmap_map *gmap_create1(struct gmap_config config) {
 		config.loadFactorOverThousand = GMAP_DEFAULT_LOAD_FACTOR_OVER_THOUSAND;
 	}
 
+	// Keys are always checked against keyType, so the type's own functions can be called directly
+	// instead of going through gvalue_hash and gvalue_cmp.
 	if (config.hashFunc == NULL) {
-		config.hashFunc = gvalue_hash;
+		config.hashFunc = config.keyType->hash;
 	}
 
 	if (config.cmpFunc == NULL) {
-		config.cmpFunc = gvalue_cmp;
+		config.cmpFunc = config.keyType->cmp;
 	}
 
 	if (config.freeFunc == NULL) {
@@ -90,6 +113,11 @@ struct gmap_map *gmap_create1(struct gmap_config config) {
 	map->size = 0;
 	map->revision = 0;
 	map->table = calloc(sizeof(struct gmap_bucket *), config.capacity);
+	map->fingerprint = 0;
+	map->ownedStrings = NULL;
+	map->changeListener = NULL;
+	map->changeListenerContext = NULL;
+	map->nextWeakMap = NULL;
 
 	if (config.maintainInsertionOrder) {
 		struct gmap_ordered_map *m = (struct gmap_ordered_map *) map;
@@ -97,13 +125,36 @@ struct gmap_map *gmap_create1(struct gmap_config config) {
 		m->lastInsertedBucket = NULL;
 	}
 
+	if (config.weakKeys) {
+		map->nextWeakMap = private_gmap_weakMaps;
+		private_gmap_weakMaps = map;
+	}
+
 	return map;
 }
 
+// Map keyed by object identity, e.g. the visited set of a graph traversal. Keys are pointers that are
+// compared by address and never freed by the map.
+struct gmap_map *gmap_createIdentity(void) {
+	return gmap_create(gvalue.pointerType);
+}
+
 /*******************************************************************************************/
 
 // Internal operations.
 
+// Maps a hash code onto a slot. The hash code is first scrambled with a Fibonacci multiplier so that all
+// of its bits reach the top of the word, and then scaled onto [0, capacity) with a multiply-shift
+// instead of a modulo. The result is monotonic in the scrambled hash, which is what lets gmap_scan
+// describe its progress as a position in hash space that stays valid across resizes.
+uint32_t private_gmap_scanPosition(uint32_t hashCode) {
+	return hashCode * UINT32_C(2654435769);
+}
+
+uint32_t private_gmap_slot(uint32_t hashCode, uint32_t capacity) {
+	return (uint32_t) (((uint64_t) private_gmap_scanPosition(hashCode) * capacity) >> 32);
+}
+
 void private_gmap_grow(struct gmap_map *map) {
 	uint32_t capacity = map->config.capacity;
 	uint32_t newCapacity = (capacity <= 3) ? 7 : capacity * 2;
@@ -114,7 +165,7 @@ void private_gmap_grow(struct gmap_map *map) {
 		for (uint32_t slot = 0; slot < capacity && size > 0; slot++) {
 			struct gmap_bucket *bucket = map->table[slot];
 			while (bucket != NULL) {
-				uint32_t newSlot = bucket->hashCode % newCapacity;
+				uint32_t newSlot = private_gmap_slot(bucket->hashCode, newCapacity);
 				struct gmap_bucket *thisNode = bucket;
 				bucket = bucket->next;
 
@@ -131,13 +182,92 @@ void private_gmap_grow(struct gmap_map *map) {
 	map->config.capacity = newCapacity;
 }
 
+// Keys and values of compact maps are stored as gvalue_toCompact words and expanded on every access.
+struct gvalue_value private_gmap_bucketKey(struct gmap_map *map, struct gmap_bucket *bucket) {
+	return map->config.compactStorage ? gvalue_fromCompact(((struct gmap_compact_bucket *) bucket)->key) : bucket->key;
+}
+
+struct gvalue_value private_gmap_bucketValue(struct gmap_map *map, struct gmap_bucket *bucket) {
+	return map->config.compactStorage ? gvalue_fromCompact(((struct gmap_compact_bucket *) bucket)->value) : bucket->value;
+}
+
+// For compact maps, the value must already be known to have a compact form.
+void private_gmap_setBucketEntry(struct gmap_map *map, struct gmap_bucket *bucket,
+		struct gvalue_value key, struct gvalue_value value) {
+
+	if (map->config.compactStorage) {
+		gvalue_toCompact(key, &(((struct gmap_compact_bucket *) bucket)->key));
+		gvalue_toCompact(value, &(((struct gmap_compact_bucket *) bucket)->value));
+	}
+	else {
+		bucket->key = key;
+		bucket->value = value;
+	}
+}
+
 void private_gmap_freeKeyAndValueIfNeeded(struct gmap_map *map, struct gmap_bucket *node) {
 	if (node->freeKeyOnRemove) {
-		map->config.freeFunc(node->key);
+		map->config.freeFunc(private_gmap_bucketKey(map, node));
 	}
 
 	if (node->freeValueOnRemove) {
-		map->config.freeFunc(node->value);
+		map->config.freeFunc(private_gmap_bucketValue(map, node));
+	}
+}
+
+// Contribution of a single entry to the map fingerprint. The key and value hashes are mixed together
+// so that swapping values between keys changes the sum.
+uint64_t private_gmap_entryFingerprint(uint32_t hashCode, struct gvalue_value value) {
+	uint64_t x = ((uint64_t) hashCode << 32) | gvalue_hash(value);
+	x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return x ^ (x >> 31);
+}
+
+// Appends a new bucket at the given chain position without looking for an existing key.
+void private_gmap_addBucket(struct gmap_map *map, struct gmap_bucket **addToNode,
+		struct gvalue_value key, struct gvalue_value value, uint32_t hashCode,
+		bool freeKeyOnRemove, bool freeValueOnRemove) {
+
+	size_t allocSize = map->config.maintainInsertionOrder ? sizeof(struct gmap_ordered_bucket)
+			: map->config.compactStorage ? sizeof(struct gmap_compact_bucket) : sizeof(struct gmap_bucket);
+	struct gmap_bucket *list = malloc(allocSize);
+	private_gmap_setBucketEntry(map, list, key, value);
+	list->hashCode = hashCode;
+	list->freeKeyOnRemove = freeKeyOnRemove;
+	list->freeValueOnRemove = freeValueOnRemove;
+	list->next = *addToNode;
+
+	if (map->config.maintainInsertionOrder) {
+		struct gmap_ordered_map *m = (struct gmap_ordered_map *) map;
+		struct gmap_ordered_bucket *b = (struct gmap_ordered_bucket *) list;
+
+		if (m->firstInsertedBucket == NULL) {
+			m->firstInsertedBucket = b;
+			b->prev = NULL;
+		}
+		else {
+			b->prev = m->lastInsertedBucket;
+			m->lastInsertedBucket->next = b;
+		}
+
+		b->next = NULL;
+		m->lastInsertedBucket = b;
+	}
+
+	*addToNode = list;
+	map->size++;
+
+	if (map->config.maintainFingerprint) {
+		map->fingerprint += private_gmap_entryFingerprint(hashCode, value);
+	}
+}
+
+void private_gmap_notifyChange(struct gmap_map *map, enum gmap_change change,
+		struct gvalue_value key, struct gvalue_value value) {
+
+	if (map->changeListener != NULL) {
+		map->changeListener(map, change, key, value);
 	}
 }
 
@@ -170,22 +300,43 @@ bool gmap_put1(struct gmap_map *map, struct gvalue_value key, struct gvalue_valu
 		return false;
 	}
 
+	// The map never owns weak keys.
+	if (map->config.weakKeys) {
+		freeKeyOnRemove = false;
+	}
+
+	uint64_t word;
+	if (map->config.compactStorage) {
+		if (gvalue_toCompact(key, &word) == false) {
+			printf("Error: gmap: Key has no compact form\n");
+			return false;
+		}
+		if (gvalue_toCompact(value, &word) == false) {
+			printf("Error: gmap: Value of type %s has no compact form\n", value.type->name);
+			return false;
+		}
+	}
+
 	uint32_t newLoadFactorOverThousand = ((map->size + 1) * 1000) / map->config.capacity;
 	if (newLoadFactorOverThousand >= map->config.loadFactorOverThousand) {
 		private_gmap_grow(map);
 	}
 
 	uint32_t hashCode = map->config.hashFunc(key);
-	uint32_t slot = hashCode % map->config.capacity;
+	uint32_t slot = private_gmap_slot(hashCode, map->config.capacity);
 	struct gmap_bucket **addToNode = &(map->table[slot]);
 
 	while (*addToNode != NULL) {
-		if (map->config.cmpFunc((*addToNode)->key, key) == 0) {
+		if ((*addToNode)->hashCode == hashCode && map->config.cmpFunc(private_gmap_bucketKey(map, *addToNode), key) == 0) {
+
+			if (map->config.maintainFingerprint) {
+				map->fingerprint += private_gmap_entryFingerprint(hashCode, value)
+						- private_gmap_entryFingerprint((*addToNode)->hashCode, private_gmap_bucketValue(map, *addToNode));
+			}
 
 			private_gmap_freeKeyAndValueIfNeeded(map, (*addToNode));
 
-			(*addToNode)->key = key;
-			(*addToNode)->value = value;
+			private_gmap_setBucketEntry(map, *addToNode, key, value);
 			(*addToNode)->hashCode = hashCode;
 			(*addToNode)->freeKeyOnRemove = freeKeyOnRemove;
 			(*addToNode)->freeValueOnRemove = freeValueOnRemove;
@@ -208,10 +359,7 @@ bool gmap_put1(struct gmap_map *map, struct gvalue_value key, struct gvalue_valu
 
 					next->prev = prev;
 
-					if (m->lastInsertedBucket->prev != NULL) {
-						m->lastInsertedBucket->prev->next = b;
-					}
-
+					m->lastInsertedBucket->next = b;
 					b->prev = m->lastInsertedBucket;
 					m->lastInsertedBucket = b;
 					b->next = NULL;
@@ -219,45 +367,22 @@ bool gmap_put1(struct gmap_map *map, struct gvalue_value key, struct gvalue_valu
 			}
 
 			map->revision++;
+			private_gmap_notifyChange(map, GMAP_CHANGE_PUT, key, value);
 			return false;
 		}
 
 		addToNode = &((*addToNode)->next);
 	}
 
-	size_t allocSize = map->config.maintainInsertionOrder ? sizeof(struct gmap_ordered_bucket) : sizeof(struct gmap_bucket);
-	struct gmap_bucket *list = malloc(allocSize);
-	list->key = key;
-	list->value = value;
-	list->hashCode = hashCode;
-	list->freeKeyOnRemove = freeKeyOnRemove;
-	list->freeValueOnRemove = freeValueOnRemove;
-	list->next = NULL;
-
-	if (map->config.maintainInsertionOrder) {
-		struct gmap_ordered_map *m = (struct gmap_ordered_map *) map;
-		struct gmap_ordered_bucket *b = (struct gmap_ordered_bucket *) list;
-
-		if (m->firstInsertedBucket == NULL) {
-			m->firstInsertedBucket = b;
-			b->prev = NULL;
-		}
-		else {
-			b->prev = m->lastInsertedBucket;
-			m->lastInsertedBucket->next = b;
-		}
-
-		b->next = NULL;
-		m->lastInsertedBucket = b;
-	}
-
-	*addToNode = list;
-	map->size++;
+	private_gmap_addBucket(map, addToNode, key, value, hashCode, freeKeyOnRemove, freeValueOnRemove);
 	map->revision++;
+	private_gmap_notifyChange(map, GMAP_CHANGE_PUT, key, value);
 	return true;
 }
 
 // Returns NULL if key is not found.
+// With config.compactStorage, the result points to a copy inside the map that the next call replaces,
+// so changing it does not change the map.
 struct gvalue_value *gmap_get(struct gmap_map *map, struct gvalue_value key) {
 	if (private_gmap_checkKeyType(key, map->config.keyType) == false) {
 		return NULL;
@@ -268,11 +393,15 @@ struct gvalue_value *gmap_get(struct gmap_map *map, struct gvalue_value key) {
 	}
 
 	uint32_t hashCode = map->config.hashFunc(key);
-	uint32_t slot = hashCode % map->config.capacity;
+	uint32_t slot = private_gmap_slot(hashCode, map->config.capacity);
 	struct gmap_bucket *bucket = map->table[slot];
 
 	while (bucket != NULL) {
-		if (map->config.cmpFunc(bucket->key, key) == 0) {
+		if (bucket->hashCode == hashCode && map->config.cmpFunc(private_gmap_bucketKey(map, bucket), key) == 0) {
+			if (map->config.compactStorage) {
+				map->compactValue = private_gmap_bucketValue(map, bucket);
+				return &(map->compactValue);
+			}
 			return &(bucket->value);
 		}
 		bucket = bucket->next;
@@ -301,11 +430,11 @@ bool gmap_remove(struct gmap_map *map, struct gvalue_value key) {
 	}
 
 	uint32_t hashCode = map->config.hashFunc(key);
-	uint32_t slot = hashCode % map->config.capacity;
+	uint32_t slot = private_gmap_slot(hashCode, map->config.capacity);
 	struct gmap_bucket **removeFromNode = &(map->table[slot]);
 
 	while (*removeFromNode != NULL) {
-		if (map->config.cmpFunc((*removeFromNode)->key, key) == 0) {
+		if ((*removeFromNode)->hashCode == hashCode && map->config.cmpFunc(private_gmap_bucketKey(map, *removeFromNode), key) == 0) {
 			struct gmap_bucket *removedNode = *removeFromNode;
 			*removeFromNode = (*removeFromNode)->next;
 
@@ -337,11 +466,17 @@ bool gmap_remove(struct gmap_map *map, struct gvalue_value key) {
 				}
 			}
 
-			private_gmap_freeKeyAndValueIfNeeded(map, removedNode);
-			free(removedNode);
+			if (map->config.maintainFingerprint) {
+				map->fingerprint -= private_gmap_entryFingerprint(removedNode->hashCode, private_gmap_bucketValue(map, removedNode));
+			}
 
+			// Notify before the stored key may be freed. The given key is still owned by the caller.
 			map->size--;
 			map->revision++;
+			private_gmap_notifyChange(map, GMAP_CHANGE_REMOVE, key, private_gmap_bucketValue(map, removedNode));
+
+			private_gmap_freeKeyAndValueIfNeeded(map, removedNode);
+			free(removedNode);
 			return true;
 		}
 
@@ -351,7 +486,8 @@ bool gmap_remove(struct gmap_map *map, struct gvalue_value key) {
 	return false;
 }
 
-void gmap_clear(struct gmap_map *map) {
+// Only a clear that was asked for is reported to the change listener, not the one of gmap_free.
+void private_gmap_clear(struct gmap_map *map, bool notify) {
 	uint32_t size = map->size;
 
 	if (size == 0) {
@@ -373,14 +509,18 @@ void gmap_clear(struct gmap_map *map) {
 		while (b != NULL);
 
 		map->size = 0;
+		map->fingerprint = 0;
 		map->revision = 0;
 		m->firstInsertedBucket = NULL;
 		m->lastInsertedBucket = NULL;
 
-		for (size_t i = 0, j = map->config.capacity - 1; i < j; i++) {
-			map->table[i] = NULL;
+		for (uint32_t slot = 0; slot < map->config.capacity; slot++) {
+			map->table[slot] = NULL;
 		}
 
+		if (notify) {
+			private_gmap_notifyChange(map, GMAP_CHANGE_CLEAR, gvalue_getBool(false), gvalue_getBool(false));
+		}
 		return;
 	}
 
@@ -399,13 +539,21 @@ void gmap_clear(struct gmap_map *map) {
 			size--;
 			if (size == 0) {
 				map->size = 0;
+				map->fingerprint = 0;
 				map->revision = 0;
+				if (notify) {
+					private_gmap_notifyChange(map, GMAP_CHANGE_CLEAR, gvalue_getBool(false), gvalue_getBool(false));
+				}
 				return;
 			}
 		}
 	}
 }
 
+void gmap_clear(struct gmap_map *map) {
+	private_gmap_clear(map, true);
+}
+
 /*******************************************************************************************/
 
 // More operations.
@@ -467,8 +615,8 @@ bool gmap_next(struct gmap_iterator *iterator) {
 		return false;
 	}
 
-	iterator->key = iterator->nextBucket->key;
-	iterator->value = iterator->nextBucket->value;
+	iterator->key = private_gmap_bucketKey(iterator->map, iterator->nextBucket);
+	iterator->value = private_gmap_bucketValue(iterator->map, iterator->nextBucket);
 	iterator->nextBucket = iterator->nextBucket->next;
 	return true;
 }
@@ -509,7 +657,7 @@ struct gmap_keyvalue_list gmap_getKeyValueList(struct gmap_map *map) {
 			for (uint32_t slot = 0, index = 0; slot < map->config.capacity && size > 0; slot++) {
 				struct gmap_bucket *bucket = map->table[slot];
 				while (bucket != NULL) {
-					struct gmap_keyvalue pair = { .key = bucket->key, .value = bucket->value };
+					struct gmap_keyvalue pair = { .key = private_gmap_bucketKey(map, bucket), .value = private_gmap_bucketValue(map, bucket) };
 					list.keyValuePairs[index++] = pair;
 					bucket = bucket->next;
 					size--;
@@ -527,6 +675,61 @@ void gmap_freeKeyValueList(struct gmap_keyvalue_list kvlist) {
 	}
 }
 
+// Returns true if both maps have the same keys mapped to equal values. Insertion order does not matter.
+// When both maps maintain a fingerprint with the same hash function, different fingerprints return
+// false right away, so only maps that are most likely equal are compared entry by entry.
+bool gmap_equals(struct gmap_map *map1, struct gmap_map *map2) {
+	if (map1 == map2) {
+		return true;
+	}
+
+	if (map1->size != map2->size || map1->config.keyType != map2->config.keyType) {
+		return false;
+	}
+
+	if (map1->config.maintainFingerprint && map2->config.maintainFingerprint
+			&& map1->config.hashFunc == map2->config.hashFunc && map1->fingerprint != map2->fingerprint) {
+		return false;
+	}
+
+	uint32_t size = map1->size;
+	for (uint32_t slot = 0; slot < map1->config.capacity && size > 0; slot++) {
+		struct gmap_bucket *bucket = map1->table[slot];
+		while (bucket != NULL) {
+			struct gvalue_value *value = gmap_get(map2, private_gmap_bucketKey(map1, bucket));
+			if (value == NULL || gvalue_cmp(*value, private_gmap_bucketValue(map1, bucket)) != 0) {
+				return false;
+			}
+			bucket = bucket->next;
+			size--;
+		}
+	}
+
+	return true;
+}
+
+// Removes the given object from every map with config.weakKeys, calling weakKeyCallback before each
+// removal. Meant to be called when the object is destroyed. Returns the number of removed entries.
+uint32_t gmap_forgetObject(void *object) {
+	struct gvalue_value key = gvalue_getPointer(object);
+	uint32_t removed = 0;
+
+	for (struct gmap_map *map = private_gmap_weakMaps; map != NULL; map = map->nextWeakMap) {
+		struct gvalue_value *value = gmap_get(map, key);
+		if (value == NULL) {
+			continue;
+		}
+
+		if (map->config.weakKeyCallback != NULL) {
+			map->config.weakKeyCallback(map, key, *value);
+		}
+		gmap_remove(map, key);
+		removed++;
+	}
+
+	return removed;
+}
+
 void gmap_each(struct gmap_map *map, void (*func)(struct gvalue_value, struct gvalue_value)) {
 	struct gmap_iterator iterator = gmap_iterator(map);
 	while (gmap_next(&iterator)) {
@@ -534,17 +737,66 @@ void gmap_each(struct gmap_map *map, void (*func)(struct gvalue_value, struct gv
 	}
 }
 
+// Stateless cursor-based iteration in the spirit of the Redis SCAN command. Start with a cursor of 0 and
+// keep passing the returned cursor back in until it comes back as 0. Each call visits up to count slots
+// (not entries) and calls func for every key-value found in them. No memory is allocated.
+//
+//   uint32_t cursor = 0;
+//   do {
+//       cursor = gmap.scan(map, cursor, 10, func);
+//       // the map may be modified freely here, in between calls
+//   }
+//   while (cursor != 0);
+//
+// The cursor is a position in the scrambled hash space rather than a slot number, and slots cover
+// consecutive ranges of that space at every capacity (see private_gmap_slot). So even if the map grows
+// between calls, every entry that is present for the whole scan is returned at least once. Entries
+// added or removed during the scan may or may not be returned, and some entries may be returned twice.
+// The map must not be modified from within func itself.
+uint32_t gmap_scan(struct gmap_map *map, uint32_t cursor, uint32_t count,
+		void (*func)(struct gvalue_value, struct gvalue_value)) {
+
+	uint64_t capacity = map->config.capacity;
+	uint64_t slot = (((uint64_t) cursor) * capacity) >> 32;
+
+	if (count < 1) {
+		count = GMAP_DEFAULT_SCAN_COUNT;
+	}
+
+	while (count > 0 && slot < capacity) {
+		struct gmap_bucket *bucket = map->table[slot];
+		while (bucket != NULL) {
+			struct gmap_bucket *next = bucket->next;
+			func(private_gmap_bucketKey(map, bucket), private_gmap_bucketValue(map, bucket));
+			bucket = next;
+		}
+
+		slot++;
+		count--;
+	}
+
+	if (slot >= capacity) {
+		return 0;
+	}
+
+	// Smallest scan position that falls into the next slot, i.e. ceil(slot * 2^32 / capacity).
+	return (uint32_t) (((slot << 32) + capacity - 1) / capacity);
+}
+
 void gmap_print(struct gmap_map *map) {
 	gmap_fprint(map, stdout);
 }
 
+// Values are formatted into a gvalue_writer, so large maps reach the stream in a few big writes.
 void gmap_fprint(struct gmap_map *map, FILE *stream) {
 	if (map->size == 0) {
 		fputs("{}", stream);
 		return;
 	}
 
-	fputs("{ ", stream);
+	struct gvalue_writer writer;
+	gvalue_initWriter(&writer, stream);
+	gvalue_write(&writer, "{ ");
 
 	struct gmap_iterator iterator = gmap_iterator(map);
 	bool isFirst = true;
@@ -554,17 +806,18 @@ void gmap_fprint(struct gmap_map *map, FILE *stream) {
 			isFirst = false;
 		}
 		else {
-			fputs(", ", stream);
+			gvalue_write(&writer, ", ");
 		}
 
-		fputc('{', stream);
-		gvalue_fprint(iterator.key, stream);
-		fputs("=", stream);
-		gvalue_fprint(iterator.value, stream);
-		fputc('}', stream);
+		gvalue_write(&writer, "{");
+		gvalue_writeValue(&writer, iterator.key);
+		gvalue_write(&writer, "=");
+		gvalue_writeValue(&writer, iterator.value);
+		gvalue_write(&writer, "}");
 	}
 
-	fputs(" }", stream);
+	gvalue_write(&writer, " }");
+	gvalue_flushWriter(&writer);
 }
 
 // Lower score is better.
@@ -600,7 +853,16 @@ float gmap_hashDeviation(struct gmap_map *map) {
 // Destructor.
 
 void gmap_free(struct gmap_map *map) {
-	gmap_clear(map);
+	if (map->config.weakKeys) {
+		struct gmap_map **link = &private_gmap_weakMaps;
+		while (*link != map) {
+			link = &((*link)->nextWeakMap);
+		}
+		*link = map->nextWeakMap;
+	}
+
+	private_gmap_clear(map, false);
 	free(map->table);
+	free(map->ownedStrings);
 	free(map);
 }
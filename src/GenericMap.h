@@ -11,18 +11,34 @@
 #define GMAP_DEFAULT_LOAD_FACTOR_OVER_THOUSAND	600
 #define GMAP_MIN_LOAD_FACTOR_OVER_THOUSAND	    100
 #define GMAP_MAX_LOAD_FACTOR_OVER_THOUSAND	    1000
+#define GMAP_DEFAULT_SCAN_COUNT				    10
+#define GMAP_BINARY_VERSION						1
 
 /*******************************************************************************************/
 
 // Data types.
 
+struct gmap_map;
+
+// The fields up to and including freeValueOnRemove are shared with gmap_compact_bucket.
 struct gmap_bucket {
+	struct gmap_bucket *next;
+	uint32_t hashCode;
+	bool freeKeyOnRemove;
+	bool freeValueOnRemove;
 	struct gvalue_value key;
 	struct gvalue_value value;
+};
+
+// Bucket of a map with config.compactStorage. Key and value are gvalue_toCompact words, which makes the
+// bucket half the size of a regular one.
+struct gmap_compact_bucket {
+	struct gmap_bucket *next;
 	uint32_t hashCode;
 	bool freeKeyOnRemove;
 	bool freeValueOnRemove;
-	struct gmap_bucket *next;
+	uint64_t key;
+	uint64_t value;
 };
 
 struct gmap_ordered_bucket {
@@ -39,9 +55,31 @@ struct gmap_config {
 	uint32_t loadFactorOverThousand;
 	const struct gvalue_type *restrictValueToType;
 	bool maintainInsertionOrder;
+	bool maintainFingerprint;
+
+	// Keys that compare equal must have the same hash code. Stored hash codes are compared first,
+	// so cmpFunc only runs on likely matches. Both default to the functions of keyType.
 	uint32_t (*hashFunc)(struct gvalue_value);
 	int (*cmpFunc)(struct gvalue_value, struct gvalue_value);
 	bool (*freeFunc)(struct gvalue_value);
+
+	// Stores keys and values in their compact form, see gvalue_toCompact, which roughly halves the memory
+	// of maps with number, pointer or string keys and values. keyType must be a compact type, and values
+	// without a compact form are rejected. Cannot be combined with maintainInsertionOrder.
+	// gmap_get then returns a pointer to a copy that is only valid until the next call.
+	bool compactStorage;
+
+	// Only for pointer keys. The map does not own its keys, so they are never freed, and
+	// gmap_forgetObject removes an object from all such maps once it is gone. weakKeyCallback is
+	// optional and is called right before the entry is removed, e.g. to release the value.
+	bool weakKeys;
+	void (*weakKeyCallback)(struct gmap_map *map, struct gvalue_value key, struct gvalue_value value);
+};
+
+enum gmap_change {
+	GMAP_CHANGE_PUT,
+	GMAP_CHANGE_REMOVE,
+	GMAP_CHANGE_CLEAR
 };
 
 struct gmap_map {
@@ -49,6 +87,25 @@ struct gmap_map {
 	uint32_t size;
 	uint32_t revision;
 	struct gmap_bucket **table;
+
+	// Order-independent hash of all entries, only kept up to date with config.maintainFingerprint.
+	// Maps with the same entries have the same fingerprint, so a mismatch proves they are different.
+	uint64_t fingerprint;
+
+	// String payloads that belong to the map itself rather than to its entries, e.g. after
+	// gmap_loadBinary. Freed together with the map.
+	void *ownedStrings;
+
+	// Optional observer that is called after every change has been applied, e.g. by a write-ahead log.
+	// For a clear, key and value carry no meaning. gmap_free is not a change and is not reported.
+	void (*changeListener)(struct gmap_map *map, enum gmap_change change, struct gvalue_value key, struct gvalue_value value);
+	void *changeListenerContext;
+
+	// Next map with config.weakKeys, see gmap_forgetObject.
+	struct gmap_map *nextWeakMap;
+
+	// Value returned by gmap_get with config.compactStorage.
+	struct gvalue_value compactValue;
 };
 
 struct gmap_ordered_map {
@@ -82,6 +139,7 @@ struct gmap_class {
 	// Constructors.
 	struct gmap_map *(*create)(const struct gvalue_type *keyType);
 	struct gmap_map *(*create1)(struct gmap_config config);
+	struct gmap_map *(*createIdentity)(void);
 
 	// Basic operations.
 	bool (*put)(struct gmap_map *map, struct gvalue_value key, struct gvalue_value value);
@@ -97,11 +155,18 @@ struct gmap_class {
 	bool (*next)(struct gmap_iterator *iterator);
 	struct gmap_keyvalue_list (*getKeyValueList)(struct gmap_map *map);
 	void (*freeKeyValueList)(struct gmap_keyvalue_list kvlist);
+	bool (*equals)(struct gmap_map *map1, struct gmap_map *map2);
+	uint32_t (*forgetObject)(void *object);
 	void (*each)(struct gmap_map *map, void (*func)(struct gvalue_value, struct gvalue_value));
+	uint32_t (*scan)(struct gmap_map *map, uint32_t cursor, uint32_t count, void (*func)(struct gvalue_value, struct gvalue_value));
 	void (*print)(struct gmap_map* map);
 	void (*fprint)(struct gmap_map* map, FILE *stream);
 	float (*hashDeviation)(struct gmap_map* map);
 
+	// Persistence.
+	bool (*saveBinary)(struct gmap_map *map, const char *path);
+	struct gmap_map *(*loadBinary)(const char *path);
+
 	// Destructor.
 	void (*free)(struct gmap_map *map);
 
@@ -116,6 +181,7 @@ extern struct gmap_class gmap;
 
 extern struct gmap_map *gmap_create(const struct gvalue_type *keyType);
 extern struct gmap_map *gmap_create1(struct gmap_config config);
+extern struct gmap_map *gmap_createIdentity(void);
 
 /*******************************************************************************************/
 
@@ -137,13 +203,23 @@ extern struct gmap_iterator gmap_iterator(struct gmap_map *map);
 extern bool gmap_next(struct gmap_iterator *iterator);
 extern struct gmap_keyvalue_list gmap_getKeyValueList(struct gmap_map *map);
 extern void gmap_freeKeyValueList(struct gmap_keyvalue_list kvlist);
+extern bool gmap_equals(struct gmap_map *map1, struct gmap_map *map2);
+extern uint32_t gmap_forgetObject(void *object);
 extern void gmap_each(struct gmap_map *map, void (*func)(struct gvalue_value, struct gvalue_value));
+extern uint32_t gmap_scan(struct gmap_map *map, uint32_t cursor, uint32_t count, void (*func)(struct gvalue_value, struct gvalue_value));
 extern void gmap_print(struct gmap_map* map);
 extern void gmap_fprint(struct gmap_map* map, FILE *stream);
 extern float gmap_hashDeviation(struct gmap_map* map);
 
 /*******************************************************************************************/
 
+// Persistence (implemented in GenericMapIO.c).
+
+extern bool gmap_saveBinary(struct gmap_map *map, const char *path);
+extern struct gmap_map *gmap_loadBinary(const char *path);
+
+/*******************************************************************************************/
+
 // Destructor.
 
 extern void gmap_free(struct gmap_map *map);
@@ -0,0 +1,688 @@
+/**
+ * Binary snapshots for generic maps.
+ *
+ * A snapshot is a single file made of a fixed-size header, an array of fixed-size entries and a packed
+ * string section holding all string and wstring payloads. Loading maps the file into memory, verifies it,
+ * copies the string section into one block owned by the map and links every entry straight into a table
+ * that is already big enough, so there is no resizing and no allocation per key string.
+ *
+ * The format uses the native byte order and wchar_t size. A snapshot is rejected on a machine where
+ * either of them differs. Pointer values are not meaningful outside of the process and cannot be saved.
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "GenericMap.h"
+
+/*******************************************************************************************/
+
+// File format.
+
+#define GMAP_BINARY_MAGIC			"GMAPSNAP"
+#define GMAP_BINARY_BYTE_ORDER_MARK	0x01020304
+#define GMAP_BINARY_NO_TYPE			0xFF
+#define GMAP_BINARY_BUFFER_SIZE		65536
+
+struct private_gmap_binary_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrderMark;
+	uint32_t headerSize;
+	uint32_t entrySize;
+	uint8_t keyTypeCode;
+	uint8_t restrictValueToTypeCode;
+	uint8_t maintainInsertionOrder;
+	uint8_t wcharSize;
+	uint32_t loadFactorOverThousand;
+	uint64_t entryCount;
+	uint64_t stringSectionSize;
+
+	// FNV-1a over the 64-bit words of everything after the header.
+	uint64_t checksum;
+};
+
+// Scalars are stored as their bits. Strings are stored as an offset into the string section.
+struct private_gmap_binary_entry {
+	uint8_t keyTypeCode;
+	uint8_t valueTypeCode;
+	uint8_t reserved[6];
+	uint64_t key;
+	uint64_t value;
+};
+
+struct gmap_map *private_gmap_loadBinary1(const char *path, const struct gmap_config *baseConfig);
+
+// Defined in GenericMap.c.
+extern uint32_t private_gmap_slot(uint32_t hashCode, uint32_t capacity);
+extern void private_gmap_addBucket(struct gmap_map *map, struct gmap_bucket **addToNode,
+		struct gvalue_value key, struct gvalue_value value, uint32_t hashCode,
+		bool freeKeyOnRemove, bool freeValueOnRemove);
+
+/*******************************************************************************************/
+
+// Encoding of single values.
+
+uint64_t private_gmap_checksum(uint64_t checksum, const unsigned char *data, size_t size) {
+	for (size_t i = 0; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		checksum = (checksum ^ word) * UINT64_C(1099511628211);
+	}
+	return checksum;
+}
+
+// Types that keep their payload in the string section. Byte slices are stored there as a uint64_t
+// length followed by the bytes.
+bool private_gmap_isStringType(const struct gvalue_type *type) {
+	return type->code == GVALUE_TYPE_STRING || type->code == GVALUE_TYPE_WSTRING
+			|| type->code == GVALUE_TYPE_ISTRING || type->code == GVALUE_TYPE_SSTRING
+			|| type->code == GVALUE_TYPE_BYTES;
+}
+
+// Number of bytes taken by the value in the string section, including the terminator and the
+// padding to the next multiple of 8. Zero for non-string types.
+size_t private_gmap_stringPayloadSize(struct gvalue_value value) {
+	size_t size;
+
+	switch (value.type->code) {
+	case GVALUE_TYPE_STRING:
+	case GVALUE_TYPE_ISTRING:
+	case GVALUE_TYPE_SSTRING:
+		size = strlen(gvalue_stringChars(&value)) + 1;
+		break;
+	case GVALUE_TYPE_WSTRING:
+		size = (wcslen(value.primitive.wstringValue) + 1) * sizeof(wchar_t);
+		break;
+	case GVALUE_TYPE_BYTES:
+		size = sizeof(uint64_t) + value.primitive.bytesValue.length;
+		break;
+	default:
+		return 0;
+	}
+
+	return (size + 7) & ~((size_t) 7);
+}
+
+// Returns false if the value cannot be stored as plain bits, which includes strings.
+bool private_gmap_encodeScalar(struct gvalue_value value, uint64_t *outBits) {
+	uint32_t floatBits;
+
+	switch (value.type->code) {
+	case GVALUE_TYPE_BOOL:
+		*outBits = value.primitive.boolValue ? 1 : 0;
+		return true;
+	case GVALUE_TYPE_BYTE:
+		*outBits = (uint8_t) value.primitive.byteValue;
+		return true;
+	case GVALUE_TYPE_SHORT:
+		*outBits = (uint16_t) value.primitive.shortValue;
+		return true;
+	case GVALUE_TYPE_INT:
+		*outBits = (uint32_t) value.primitive.intValue;
+		return true;
+	case GVALUE_TYPE_LONG:
+		*outBits = (uint64_t) value.primitive.longValue;
+		return true;
+
+	case GVALUE_TYPE_UBYTE:
+		*outBits = value.primitive.ubyteValue;
+		return true;
+	case GVALUE_TYPE_USHORT:
+		*outBits = value.primitive.ushortValue;
+		return true;
+	case GVALUE_TYPE_UINT:
+		*outBits = value.primitive.uintValue;
+		return true;
+	case GVALUE_TYPE_ULONG:
+		*outBits = value.primitive.ulongValue;
+		return true;
+
+	case GVALUE_TYPE_FLOAT:
+		memcpy(&floatBits, &(value.primitive.floatValue), sizeof(floatBits));
+		*outBits = floatBits;
+		return true;
+	case GVALUE_TYPE_DOUBLE:
+		memcpy(outBits, &(value.primitive.doubleValue), sizeof(*outBits));
+		return true;
+
+	case GVALUE_TYPE_CHAR:
+		*outBits = (uint8_t) value.primitive.charValue;
+		return true;
+	case GVALUE_TYPE_WCHAR:
+		*outBits = (uint32_t) value.primitive.wcharValue;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+// Strings point into the given string section, which must stay alive as long as the value is used.
+// Interned strings are interned into the global pool instead, and short strings are copied into the
+// value where they fit.
+bool private_gmap_decodeValue(int typeCode, uint64_t bits, char *strings, uint64_t stringSectionSize,
+		struct gvalue_value *outValue) {
+
+	const struct gvalue_type *type = gvalue_getType(typeCode);
+	uint32_t floatBits;
+	uint64_t length;
+
+	if (type == NULL) {
+		return false;
+	}
+
+	outValue->type = type;
+
+	switch (typeCode) {
+	case GVALUE_TYPE_BOOL:
+		outValue->primitive.boolValue = (bits != 0);
+		return true;
+	case GVALUE_TYPE_BYTE:
+		outValue->primitive.byteValue = (int8_t) bits;
+		return true;
+	case GVALUE_TYPE_SHORT:
+		outValue->primitive.shortValue = (int16_t) bits;
+		return true;
+	case GVALUE_TYPE_INT:
+		outValue->primitive.intValue = (int32_t) bits;
+		return true;
+	case GVALUE_TYPE_LONG:
+		outValue->primitive.longValue = (int64_t) bits;
+		return true;
+
+	case GVALUE_TYPE_UBYTE:
+		outValue->primitive.ubyteValue = (uint8_t) bits;
+		return true;
+	case GVALUE_TYPE_USHORT:
+		outValue->primitive.ushortValue = (uint16_t) bits;
+		return true;
+	case GVALUE_TYPE_UINT:
+		outValue->primitive.uintValue = (uint32_t) bits;
+		return true;
+	case GVALUE_TYPE_ULONG:
+		outValue->primitive.ulongValue = bits;
+		return true;
+
+	case GVALUE_TYPE_FLOAT:
+		floatBits = (uint32_t) bits;
+		memcpy(&(outValue->primitive.floatValue), &floatBits, sizeof(floatBits));
+		return true;
+	case GVALUE_TYPE_DOUBLE:
+		memcpy(&(outValue->primitive.doubleValue), &bits, sizeof(bits));
+		return true;
+
+	case GVALUE_TYPE_CHAR:
+		outValue->primitive.charValue = (char) bits;
+		return true;
+	case GVALUE_TYPE_WCHAR:
+		outValue->primitive.wcharValue = (wchar_t) bits;
+		return true;
+
+	// Offsets are 8-byte aligned and the payload must be terminated inside the string section.
+	case GVALUE_TYPE_STRING:
+	case GVALUE_TYPE_ISTRING:
+	case GVALUE_TYPE_SSTRING:
+		if (bits >= stringSectionSize || (bits & 7) != 0
+				|| memchr(strings + bits, '\0', stringSectionSize - bits) == NULL) {
+			return false;
+		}
+		if (typeCode == GVALUE_TYPE_SSTRING) {
+			*outValue = gvalue_getSString(strings + bits);
+			return true;
+		}
+		outValue->primitive.stringValue = (typeCode == GVALUE_TYPE_ISTRING) ? gvalue_intern(strings + bits) : strings + bits;
+		return true;
+	case GVALUE_TYPE_WSTRING:
+		if (bits >= stringSectionSize || (bits & 7) != 0
+				|| wmemchr((wchar_t *) (strings + bits), L'\0', (stringSectionSize - bits) / sizeof(wchar_t)) == NULL) {
+			return false;
+		}
+		outValue->primitive.wstringValue = (wchar_t *) (strings + bits);
+		return true;
+	case GVALUE_TYPE_BYTES:
+		if (bits >= stringSectionSize || (bits & 7) != 0 || stringSectionSize - bits < sizeof(uint64_t)) {
+			return false;
+		}
+		memcpy(&length, strings + bits, sizeof(length));
+		if (length > stringSectionSize - bits - sizeof(uint64_t)) {
+			return false;
+		}
+		*outValue = gvalue_getBytes(strings + bits + sizeof(uint64_t), (size_t) length);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/*******************************************************************************************/
+
+// Saving.
+
+// Flushes the stream and makes sure its contents have reached the disk.
+bool private_gmap_syncFile(FILE *file) {
+	if (fflush(file) != 0) {
+		return false;
+	}
+#if defined(_WIN32)
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+struct private_gmap_writer {
+	FILE *file;
+	uint64_t checksum;
+	size_t used;
+	unsigned char *buffer;
+};
+
+// All chunks written after the header add up to multiples of 8 bytes, and the buffer size is one too,
+// so the checksum always sees whole words.
+bool private_gmap_flush(struct private_gmap_writer *writer) {
+	writer->checksum = private_gmap_checksum(writer->checksum, writer->buffer, writer->used);
+	bool ok = fwrite(writer->buffer, 1, writer->used, writer->file) == writer->used;
+	writer->used = 0;
+	return ok;
+}
+
+bool private_gmap_write(struct private_gmap_writer *writer, const void *data, size_t size) {
+	const unsigned char *bytes = (const unsigned char *) data;
+
+	while (size > 0) {
+		size_t chunk = GMAP_BINARY_BUFFER_SIZE - writer->used;
+		if (chunk > size) {
+			chunk = size;
+		}
+
+		memcpy(writer->buffer + writer->used, bytes, chunk);
+		writer->used += chunk;
+		bytes += chunk;
+		size -= chunk;
+
+		if (writer->used == GMAP_BINARY_BUFFER_SIZE && private_gmap_flush(writer) == false) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool private_gmap_writeString(struct private_gmap_writer *writer, struct gvalue_value value) {
+	static const unsigned char padding[8] = { 0 };
+	size_t size = private_gmap_stringPayloadSize(value);
+	size_t used;
+
+	if (value.type->code == GVALUE_TYPE_BYTES) {
+		uint64_t length = value.primitive.bytesValue.length;
+		used = sizeof(length) + value.primitive.bytesValue.length;
+		if (private_gmap_write(writer, &length, sizeof(length)) == false
+				|| private_gmap_write(writer, value.primitive.bytesValue.data, value.primitive.bytesValue.length) == false) {
+			return false;
+		}
+	}
+	else if (value.type->code != GVALUE_TYPE_WSTRING) {
+		used = strlen(gvalue_stringChars(&value)) + 1;
+		if (private_gmap_write(writer, gvalue_stringChars(&value), used) == false) {
+			return false;
+		}
+	}
+	else {
+		used = (wcslen(value.primitive.wstringValue) + 1) * sizeof(wchar_t);
+		if (private_gmap_write(writer, value.primitive.wstringValue, used) == false) {
+			return false;
+		}
+	}
+
+	return private_gmap_write(writer, padding, size - used);
+}
+
+bool private_gmap_encodeEntryField(struct gvalue_value value, uint64_t *stringOffset, uint64_t *outBits) {
+	if (private_gmap_isStringType(value.type)) {
+		*outBits = *stringOffset;
+		*stringOffset += private_gmap_stringPayloadSize(value);
+		return true;
+	}
+
+	if (private_gmap_encodeScalar(value, outBits) == false) {
+		printf("Error: gmap: Cannot save values of type %s\n", value.type->name);
+		return false;
+	}
+
+	return true;
+}
+
+// Writes the snapshot to a temporary file first, syncs it and then moves it into place, so an existing
+// snapshot at the same path is only replaced once the new one is complete and on disk.
+// Returns true on success.
+bool gmap_saveBinary(struct gmap_map *map, const char *path) {
+	if (map->config.keyType->code == GVALUE_TYPE_POINTER) {
+		printf("Error: gmap: Cannot save maps with %s keys\n", map->config.keyType->name);
+		return false;
+	}
+
+	size_t pathLength = strlen(path);
+	char *tempPath = malloc(pathLength + 5);
+	memcpy(tempPath, path, pathLength);
+	memcpy(tempPath + pathLength, ".tmp", 5);
+
+	struct private_gmap_writer writer = {
+			.file = fopen(tempPath, "wb"),
+			.checksum = UINT64_C(14695981039346656037),
+			.used = 0,
+			.buffer = NULL
+	};
+
+	if (writer.file == NULL) {
+		printf("Error: gmap: Cannot open %s for writing\n", tempPath);
+		free(tempPath);
+		return false;
+	}
+
+	writer.buffer = malloc(GMAP_BINARY_BUFFER_SIZE);
+
+	struct private_gmap_binary_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GMAP_BINARY_MAGIC, sizeof(header.magic));
+	header.version = GMAP_BINARY_VERSION;
+	header.byteOrderMark = GMAP_BINARY_BYTE_ORDER_MARK;
+	header.headerSize = sizeof(struct private_gmap_binary_header);
+	header.entrySize = sizeof(struct private_gmap_binary_entry);
+	header.keyTypeCode = (uint8_t) map->config.keyType->code;
+	header.restrictValueToTypeCode = (map->config.restrictValueToType == NULL)
+			? GMAP_BINARY_NO_TYPE : (uint8_t) map->config.restrictValueToType->code;
+	header.maintainInsertionOrder = map->config.maintainInsertionOrder;
+	header.wcharSize = sizeof(wchar_t);
+	header.loadFactorOverThousand = map->config.loadFactorOverThousand;
+	header.entryCount = map->size;
+
+	// The header is rewritten with the checksum and string section size at the end.
+	bool ok = fwrite(&header, sizeof(header), 1, writer.file) == 1;
+
+	// First pass writes the entries, second pass writes the strings in the same order.
+	uint64_t stringOffset = 0;
+	struct gmap_iterator iterator = gmap_iterator(map);
+
+	while (ok && gmap_next(&iterator)) {
+		struct private_gmap_binary_entry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.keyTypeCode = (uint8_t) iterator.key.type->code;
+		entry.valueTypeCode = (uint8_t) iterator.value.type->code;
+
+		ok = private_gmap_encodeEntryField(iterator.key, &stringOffset, &(entry.key))
+				&& private_gmap_encodeEntryField(iterator.value, &stringOffset, &(entry.value))
+				&& private_gmap_write(&writer, &entry, sizeof(entry));
+	}
+
+	iterator = gmap_iterator(map);
+
+	while (ok && gmap_next(&iterator)) {
+		if (private_gmap_isStringType(iterator.key.type)) {
+			ok = private_gmap_writeString(&writer, iterator.key);
+		}
+		if (ok && private_gmap_isStringType(iterator.value.type)) {
+			ok = private_gmap_writeString(&writer, iterator.value);
+		}
+	}
+
+	if (ok) {
+		ok = private_gmap_flush(&writer);
+	}
+
+	if (ok) {
+		header.stringSectionSize = stringOffset;
+		header.checksum = writer.checksum;
+		ok = fseek(writer.file, 0, SEEK_SET) == 0
+				&& fwrite(&header, sizeof(header), 1, writer.file) == 1
+				&& private_gmap_syncFile(writer.file);
+	}
+
+	ok = (fclose(writer.file) == 0) && ok;
+	free(writer.buffer);
+
+	if (ok) {
+#if defined(_WIN32)
+		remove(path);
+#endif
+		ok = rename(tempPath, path) == 0;
+	}
+
+	if (!ok) {
+		printf("Error: gmap: Failed to write %s\n", path);
+		remove(tempPath);
+	}
+
+	free(tempPath);
+	return ok;
+}
+
+/*******************************************************************************************/
+
+// Loading.
+
+// Maps the whole file read-only. On platforms without mmap the file is read into memory instead.
+const unsigned char *private_gmap_mapFile(const char *path, size_t *outSize) {
+#if defined(_WIN32)
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+
+	unsigned char *data = NULL;
+	long size = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+
+	if (size > 0 && fseek(file, 0, SEEK_SET) == 0) {
+		data = malloc((size_t) size);
+		if (fread(data, 1, (size_t) size, file) != (size_t) size) {
+			free(data);
+			data = NULL;
+		}
+	}
+
+	fclose(file);
+	*outSize = (size_t) size;
+	return data;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	void *data = NULL;
+
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			data = NULL;
+		}
+		else {
+			*outSize = (size_t) st.st_size;
+		}
+	}
+
+	close(fd);
+	return (const unsigned char *) data;
+#endif
+}
+
+void private_gmap_unmapFile(const unsigned char *data, size_t size) {
+#if defined(_WIN32)
+	free((void *) data);
+#else
+	munmap((void *) data, size);
+#endif
+}
+
+bool private_gmap_checkHeader(const struct private_gmap_binary_header *header, size_t fileSize) {
+	if (memcmp(header->magic, GMAP_BINARY_MAGIC, sizeof(header->magic)) != 0) {
+		printf("Error: gmap: Not a gmap snapshot\n");
+		return false;
+	}
+
+	if (header->version != GMAP_BINARY_VERSION) {
+		printf("Error: gmap: Unsupported snapshot version %u\n", (unsigned) header->version);
+		return false;
+	}
+
+	if (header->byteOrderMark != GMAP_BINARY_BYTE_ORDER_MARK || header->wcharSize != sizeof(wchar_t)
+			|| header->headerSize != sizeof(struct private_gmap_binary_header)
+			|| header->entrySize != sizeof(struct private_gmap_binary_entry)) {
+		printf("Error: gmap: Snapshot was written on an incompatible platform\n");
+		return false;
+	}
+
+	size_t available = fileSize - sizeof(struct private_gmap_binary_header);
+	if (header->entryCount > UINT32_MAX
+			|| header->entryCount > available / sizeof(struct private_gmap_binary_entry)
+			|| header->stringSectionSize != available - header->entryCount * sizeof(struct private_gmap_binary_entry)) {
+		printf("Error: gmap: Snapshot is truncated or has the wrong size\n");
+		return false;
+	}
+
+	return true;
+}
+
+// Longs only have a compact form in a limited range.
+bool private_gmap_alwaysCompact(const struct gvalue_type *type) {
+	return gvalue_isCompactType(type) && type->code != GVALUE_TYPE_LONG && type->code != GVALUE_TYPE_ULONG;
+}
+
+struct gmap_map *private_gmap_buildFromSnapshot(const struct private_gmap_binary_header *header,
+		const unsigned char *data, const struct gmap_config *baseConfig) {
+
+	const struct gvalue_type *keyType = gvalue_getType(header->keyTypeCode);
+	const struct gvalue_type *valueType = (header->restrictValueToTypeCode == GMAP_BINARY_NO_TYPE)
+			? NULL : gvalue_getType(header->restrictValueToTypeCode);
+
+	if (keyType == NULL || (valueType == NULL && header->restrictValueToTypeCode != GMAP_BINARY_NO_TYPE)) {
+		printf("Error: gmap: Snapshot has an unknown type\n");
+		return NULL;
+	}
+
+	uint32_t entryCount = (uint32_t) header->entryCount;
+	uint32_t loadFactor = header->loadFactorOverThousand;
+	if (loadFactor < GMAP_MIN_LOAD_FACTOR_OVER_THOUSAND || loadFactor > GMAP_MAX_LOAD_FACTOR_OVER_THOUSAND) {
+		loadFactor = GMAP_DEFAULT_LOAD_FACTOR_OVER_THOUSAND;
+	}
+
+	// Large enough that none of the entries below and not even the next put causes a resize.
+	struct gmap_config config = {
+			.keyType = keyType,
+			.capacity = (uint32_t) (((uint64_t) entryCount + 1) * 1000 / loadFactor + 1),
+			.loadFactorOverThousand = loadFactor,
+			.restrictValueToType = valueType,
+			.maintainInsertionOrder = header->maintainInsertionOrder
+	};
+
+	if (baseConfig != NULL) {
+		if (baseConfig->keyType != keyType) {
+			printf("Error: gmap: Snapshot has keys of type %s instead of %s\n", keyType->name, baseConfig->keyType->name);
+			return NULL;
+		}
+
+		config.hashFunc = baseConfig->hashFunc;
+		config.cmpFunc = baseConfig->cmpFunc;
+		config.freeFunc = baseConfig->freeFunc;
+		config.maintainFingerprint = baseConfig->maintainFingerprint;
+
+		// Only when every entry is certain to have a compact form.
+		config.compactStorage = baseConfig->compactStorage && config.maintainInsertionOrder == false
+				&& private_gmap_alwaysCompact(keyType) && valueType != NULL && private_gmap_alwaysCompact(valueType);
+	}
+
+	struct gmap_map *map = gmap_create1(config);
+
+	uint64_t stringSectionSize = header->stringSectionSize;
+	const struct private_gmap_binary_entry *entries = (const struct private_gmap_binary_entry *) (data + header->headerSize);
+
+	if (stringSectionSize > 0) {
+		map->ownedStrings = malloc(stringSectionSize);
+		memcpy(map->ownedStrings, data + header->headerSize + entryCount * sizeof(struct private_gmap_binary_entry),
+				stringSectionSize);
+	}
+
+	for (uint32_t i = 0; i < entryCount; i++) {
+		struct gvalue_value key;
+		struct gvalue_value value;
+
+		if (entries[i].keyTypeCode != keyType->code
+				|| (valueType != NULL && entries[i].valueTypeCode != valueType->code)
+				|| entries[i].valueTypeCode == GVALUE_TYPE_POINTER
+				|| private_gmap_decodeValue(entries[i].keyTypeCode, entries[i].key, map->ownedStrings, stringSectionSize, &key) == false
+				|| private_gmap_decodeValue(entries[i].valueTypeCode, entries[i].value, map->ownedStrings, stringSectionSize, &value) == false) {
+
+			printf("Error: gmap: Snapshot entry %u is invalid\n", i);
+			gmap_free(map);
+			return NULL;
+		}
+
+		uint32_t hashCode = map->config.hashFunc(key);
+		uint32_t slot = private_gmap_slot(hashCode, map->config.capacity);
+		private_gmap_addBucket(map, &(map->table[slot]), key, value, hashCode, false, false);
+	}
+
+	return map;
+}
+
+// Returns NULL if the file cannot be read or is not a valid snapshot.
+// String payloads live in a single block owned by the returned map. Entries are not marked to be freed
+// on removal, but anything put into the map later can still use put1 with its own flags.
+struct gmap_map *gmap_loadBinary(const char *path) {
+	return private_gmap_loadBinary1(path, NULL);
+}
+
+// Same as gmap_loadBinary, but takes the key type and the hash, compare and free functions from
+// baseConfig, since functions cannot be saved.
+struct gmap_map *private_gmap_loadBinary1(const char *path, const struct gmap_config *baseConfig) {
+	size_t fileSize = 0;
+	const unsigned char *data = private_gmap_mapFile(path, &fileSize);
+
+	if (data == NULL) {
+		printf("Error: gmap: Cannot read %s\n", path);
+		return NULL;
+	}
+
+	struct gmap_map *map = NULL;
+	struct private_gmap_binary_header header;
+
+	if (fileSize < sizeof(header)) {
+		printf("Error: gmap: Not a gmap snapshot\n");
+	}
+	else {
+		memcpy(&header, data, sizeof(header));
+
+		if (private_gmap_checkHeader(&header, fileSize)) {
+			uint64_t checksum = private_gmap_checksum(UINT64_C(14695981039346656037),
+					data + sizeof(header), fileSize - sizeof(header));
+
+			if (checksum != header.checksum) {
+				printf("Error: gmap: Snapshot checksum mismatch\n");
+			}
+			else {
+				map = private_gmap_buildFromSnapshot(&header, data, baseConfig);
+			}
+		}
+	}
+
+	private_gmap_unmapFile(data, fileSize);
+	return map;
+}
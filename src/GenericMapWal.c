@@ -0,0 +1,558 @@
+/**
+ * Write-ahead log for generic maps.
+ *
+ * The log is attached to a gmap_map as its change listener, so every put, remove and clear done through
+ * the regular gmap functions is appended to the log as a small binary record. Records are buffered and
+ * the log is only synced to disk once every groupCommitSize changes (group commit), or on gwal_commit.
+ * Changes since the last commit can be lost in a crash, but the map never goes back further than that.
+ *
+ * When the log grows beyond compactThreshold, the whole map is written to the snapshot file and the log
+ * starts over. Opening a log loads the snapshot and replays the log on top of it. Replaying a log over a
+ * snapshot that already contains its changes gives the same map, so a crash during compaction is safe.
+ *
+ * Strings that are replayed from the log are allocated copies owned by the map, except for interned
+ * strings, which are interned again, and short strings that fit into the value.
+ *
+ * The change listener is called after the map has changed, so a change that cannot be logged, e.g. a
+ * value of a type that has no binary form, cannot be undone. It is counted in lostChanges instead, and
+ * gwal_commit and gwal_close fail until gwal_compact has written the whole map to the snapshot.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "GenericMapWal.h"
+
+#define GWAL_MAGIC				"GMAPWAL"
+#define GWAL_MAX_RECORD_SIZE	(1024 * 1024 * 1024)
+
+struct private_gwal_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t wcharSize;
+};
+
+// Defined in GenericMapIO.c.
+extern bool private_gmap_encodeScalar(struct gvalue_value value, uint64_t *outBits);
+extern bool private_gmap_decodeValue(int typeCode, uint64_t bits, char *strings, uint64_t stringSectionSize,
+		struct gvalue_value *outValue);
+extern bool private_gmap_syncFile(FILE *file);
+extern struct gmap_map *private_gmap_loadBinary1(const char *path, const struct gmap_config *baseConfig);
+
+// OOP class object.
+struct gwal_class gwal = {
+
+		// Constructors.
+		.open = gwal_open,
+
+		// Operations.
+		.commit = gwal_commit,
+		.compact = gwal_compact,
+
+		// Destructor.
+		.close = gwal_close
+
+};
+
+/*******************************************************************************************/
+
+// Records.
+//
+// Each record is a uint32_t payload size, the payload and a uint32_t checksum of the payload.
+// The payload is the change code followed by the key and the value where applicable. Each of them is
+// a type code followed by either the 8 bits of a scalar or a uint32_t length and the characters of a
+// string or wstring, without terminator.
+
+uint32_t private_gwal_checksum(const unsigned char *data, size_t size) {
+	uint32_t checksum = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		checksum = (checksum ^ data[i]) * 16777619u;
+	}
+	return checksum;
+}
+
+void private_gwal_reserve(struct gwal_log *wal, size_t size) {
+	if (size > wal->recordBufferCapacity) {
+		while (size > wal->recordBufferCapacity) {
+			wal->recordBufferCapacity *= 2;
+		}
+		wal->recordBuffer = realloc(wal->recordBuffer, wal->recordBufferCapacity);
+	}
+}
+
+void private_gwal_append(struct gwal_log *wal, size_t *used, const void *data, size_t size) {
+	private_gwal_reserve(wal, *used + size);
+	memcpy(wal->recordBuffer + *used, data, size);
+	*used += size;
+}
+
+// Pointers and custom types have no binary form.
+bool private_gwal_canLog(const struct gvalue_type *type) {
+	return type->code < GVALUE_TYPES_COUNT && type->code != GVALUE_TYPE_POINTER;
+}
+
+bool private_gwal_appendValue(struct gwal_log *wal, size_t *used, struct gvalue_value value) {
+	uint8_t typeCode = (uint8_t) value.type->code;
+	uint64_t bits;
+	uint32_t length;
+
+	private_gwal_append(wal, used, &typeCode, sizeof(typeCode));
+
+	switch (value.type->code) {
+	case GVALUE_TYPE_STRING:
+	case GVALUE_TYPE_ISTRING:
+	case GVALUE_TYPE_SSTRING:
+		length = (uint32_t) strlen(gvalue_stringChars(&value));
+		private_gwal_append(wal, used, &length, sizeof(length));
+		private_gwal_append(wal, used, gvalue_stringChars(&value), length);
+		return true;
+	case GVALUE_TYPE_WSTRING:
+		length = (uint32_t) wcslen(value.primitive.wstringValue);
+		private_gwal_append(wal, used, &length, sizeof(length));
+		private_gwal_append(wal, used, value.primitive.wstringValue, length * sizeof(wchar_t));
+		return true;
+	case GVALUE_TYPE_BYTES:
+		if (value.primitive.bytesValue.length > GWAL_MAX_RECORD_SIZE) {
+			printf("Error: gwal: Byte slice too large to log\n");
+			return false;
+		}
+		length = (uint32_t) value.primitive.bytesValue.length;
+		private_gwal_append(wal, used, &length, sizeof(length));
+		private_gwal_append(wal, used, value.primitive.bytesValue.data, length);
+		return true;
+	default:
+		if (private_gmap_encodeScalar(value, &bits) == false) {
+			printf("Error: gwal: Cannot log values of type %s\n", value.type->name);
+			return false;
+		}
+		private_gwal_append(wal, used, &bits, sizeof(bits));
+		return true;
+	}
+}
+
+// Reads one value from the payload. Strings are returned as allocated copies.
+bool private_gwal_readValue(const unsigned char *payload, size_t size, size_t *offset,
+		struct gvalue_value *outValue, bool *outAllocated) {
+
+	uint32_t length;
+	uint64_t bits;
+
+	*outAllocated = false;
+	if (*offset + 1 > size) {
+		return false;
+	}
+
+	int typeCode = payload[(*offset)++];
+
+	switch (typeCode) {
+	case GVALUE_TYPE_STRING:
+	case GVALUE_TYPE_WSTRING:
+	case GVALUE_TYPE_ISTRING:
+	case GVALUE_TYPE_SSTRING:
+	case GVALUE_TYPE_BYTES:
+		if (*offset + sizeof(length) > size) {
+			return false;
+		}
+		memcpy(&length, payload + *offset, sizeof(length));
+		*offset += sizeof(length);
+
+		size_t charSize = (typeCode == GVALUE_TYPE_WSTRING) ? sizeof(wchar_t) : sizeof(char);
+		if (length > (size - *offset) / charSize) {
+			return false;
+		}
+
+		char *chars = malloc(((size_t) length + 1) * charSize);
+		memcpy(chars, payload + *offset, (size_t) length * charSize);
+		memset(chars + (size_t) length * charSize, 0, charSize);
+		*offset += (size_t) length * charSize;
+
+		if (typeCode == GVALUE_TYPE_BYTES) {
+			*outValue = gvalue_getBytes(chars, length);
+			*outAllocated = true;
+			return true;
+		}
+
+		if (typeCode == GVALUE_TYPE_ISTRING) {
+			*outValue = gvalue_getIString(gvalue_intern(chars));
+			free(chars);
+			return true;
+		}
+
+		if (typeCode == GVALUE_TYPE_SSTRING) {
+			*outValue = gvalue_getSString(chars);
+			if (strlen(chars) <= GVALUE_SSTRING_CAPACITY) {
+				free(chars);
+			}
+			else {
+				*outAllocated = true;
+			}
+			return true;
+		}
+
+		*outValue = (typeCode == GVALUE_TYPE_STRING) ? gvalue_getString(chars) : gvalue_getWString((wchar_t *) chars);
+		*outAllocated = true;
+		return true;
+
+	default:
+		if (*offset + sizeof(bits) > size) {
+			return false;
+		}
+		memcpy(&bits, payload + *offset, sizeof(bits));
+		*offset += sizeof(bits);
+		return private_gmap_decodeValue(typeCode, bits, NULL, 0, outValue);
+	}
+}
+
+bool private_gwal_apply(struct gmap_map *map, const unsigned char *payload, size_t size) {
+	struct gvalue_value key;
+	struct gvalue_value value;
+	bool keyAllocated;
+	bool valueAllocated;
+	size_t offset = 1;
+
+	if (size < 1) {
+		return false;
+	}
+
+	switch (payload[0]) {
+	case GMAP_CHANGE_PUT:
+		if (private_gwal_readValue(payload, size, &offset, &key, &keyAllocated) == false) {
+			return false;
+		}
+		if (private_gwal_readValue(payload, size, &offset, &value, &valueAllocated) == false) {
+			if (keyAllocated) {
+				gvalue_free(key);
+			}
+			return false;
+		}
+
+		// When the key already exists, put1 keeps the new key, so the copy is still owned by the map.
+		gmap_put1(map, key, value, keyAllocated, valueAllocated);
+		return true;
+
+	case GMAP_CHANGE_REMOVE:
+		if (private_gwal_readValue(payload, size, &offset, &key, &keyAllocated) == false) {
+			return false;
+		}
+
+		gmap_remove(map, key);
+		if (keyAllocated) {
+			gvalue_free(key);
+		}
+		return true;
+
+	case GMAP_CHANGE_CLEAR:
+		gmap_clear(map);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/*******************************************************************************************/
+
+// Log file.
+
+bool private_gwal_writeHeader(struct gwal_log *wal) {
+	struct private_gwal_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GWAL_MAGIC, sizeof(GWAL_MAGIC));
+	header.version = GWAL_VERSION;
+	header.wcharSize = sizeof(wchar_t);
+
+	wal->logSize = sizeof(header);
+	wal->pendingRecords = 0;
+	return fwrite(&header, sizeof(header), 1, wal->file) == 1 && private_gmap_syncFile(wal->file);
+}
+
+// Replays the log into the map. A torn or corrupt record at the end, as left behind by a crash in the
+// middle of a write, ends the replay and is reported through outTornTail.
+// Returns false if the file is not a log that can be replayed.
+bool private_gwal_replay(struct gwal_log *wal, bool *outExists, bool *outTornTail) {
+	FILE *file = fopen(wal->config.logPath, "rb");
+
+	*outExists = (file != NULL);
+	*outTornTail = false;
+
+	if (file == NULL) {
+		return true;
+	}
+
+	struct private_gwal_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1) {
+		*outTornTail = true;
+		fclose(file);
+		return true;
+	}
+
+	if (memcmp(header.magic, GWAL_MAGIC, sizeof(GWAL_MAGIC)) != 0 || header.version != GWAL_VERSION
+			|| header.wcharSize != sizeof(wchar_t)) {
+		printf("Error: gwal: %s is not a compatible log\n", wal->config.logPath);
+		fclose(file);
+		return false;
+	}
+
+	uint32_t payloadSize;
+	uint32_t checksum;
+	size_t prefixSize;
+
+	while ((prefixSize = fread(&payloadSize, 1, sizeof(payloadSize), file)) == sizeof(payloadSize)) {
+		if (payloadSize > GWAL_MAX_RECORD_SIZE) {
+			*outTornTail = true;
+			break;
+		}
+
+		private_gwal_reserve(wal, payloadSize);
+
+		if (fread(wal->recordBuffer, 1, payloadSize, file) != payloadSize
+				|| fread(&checksum, sizeof(checksum), 1, file) != 1
+				|| checksum != private_gwal_checksum(wal->recordBuffer, payloadSize)
+				|| private_gwal_apply(wal->map, wal->recordBuffer, payloadSize) == false) {
+			*outTornTail = true;
+			break;
+		}
+	}
+
+	// Only a log that ends right after a record is complete. A size that was cut short is a torn tail too,
+	// otherwise records appended after it would be read from the wrong offset.
+	if (prefixSize != 0 || ferror(file)) {
+		*outTornTail = true;
+	}
+
+	fclose(file);
+	return true;
+}
+
+bool private_gwal_sync(struct gwal_log *wal) {
+	wal->pendingRecords = 0;
+	if (private_gmap_syncFile(wal->file) == false) {
+		printf("Error: gwal: Failed to sync %s\n", wal->config.logPath);
+		return false;
+	}
+	return true;
+}
+
+void private_gwal_onChange(struct gmap_map *map, enum gmap_change change, struct gvalue_value key, struct gvalue_value value) {
+	struct gwal_log *wal = (struct gwal_log *) map->changeListenerContext;
+	uint8_t changeCode = (uint8_t) change;
+	size_t used = sizeof(uint32_t);
+
+	// The log is closed after a failed compaction.
+	if (wal->file == NULL) {
+		printf("Error: gwal: %s is not open, the change is not logged\n", wal->config.logPath);
+		wal->lostChanges++;
+		return;
+	}
+
+	private_gwal_append(wal, &used, &changeCode, sizeof(changeCode));
+
+	if ((change != GMAP_CHANGE_CLEAR && private_gwal_appendValue(wal, &used, key) == false)
+			|| (change == GMAP_CHANGE_PUT && private_gwal_appendValue(wal, &used, value) == false)) {
+		wal->lostChanges++;
+		return;
+	}
+
+	uint32_t payloadSize = (uint32_t) (used - sizeof(uint32_t));
+	uint32_t checksum = private_gwal_checksum(wal->recordBuffer + sizeof(uint32_t), payloadSize);
+	memcpy(wal->recordBuffer, &payloadSize, sizeof(payloadSize));
+	private_gwal_append(wal, &used, &checksum, sizeof(checksum));
+
+	if (fwrite(wal->recordBuffer, 1, used, wal->file) != used) {
+		printf("Error: gwal: Failed to write to %s\n", wal->config.logPath);
+		wal->lostChanges++;
+		return;
+	}
+
+	wal->logSize += used;
+	wal->pendingRecords++;
+
+	if (wal->pendingRecords >= wal->config.groupCommitSize) {
+		private_gwal_sync(wal);
+
+		if (wal->logSize >= wal->config.compactThreshold) {
+			gwal_compact(wal);
+		}
+	}
+}
+
+/*******************************************************************************************/
+
+// Constructors.
+
+// Loads the snapshot if there is one, replays the log on top of it and attaches the log to the map,
+// which is then available as wal->map. Use the regular gmap functions on it.
+// Returns NULL on error.
+struct gwal_log *gwal_open(struct gmap_config mapConfig, struct gwal_config config) {
+	if (config.logPath == NULL || config.snapshotPath == NULL) {
+		printf("Error: gwal: logPath and snapshotPath are required\n");
+		return NULL;
+	}
+
+	if (mapConfig.keyType == NULL) {
+		printf("Error: gwal: keyType is required\n");
+		return NULL;
+	}
+
+	if (private_gwal_canLog(mapConfig.keyType) == false) {
+		printf("Error: gwal: Cannot log keys of type %s\n", mapConfig.keyType->name);
+		return NULL;
+	}
+
+	if (mapConfig.restrictValueToType != NULL && private_gwal_canLog(mapConfig.restrictValueToType) == false) {
+		printf("Error: gwal: Cannot log values of type %s\n", mapConfig.restrictValueToType->name);
+		return NULL;
+	}
+
+	if (config.groupCommitSize < 1) {
+		config.groupCommitSize = GWAL_DEFAULT_GROUP_COMMIT_SIZE;
+	}
+
+	if (config.compactThreshold < 1) {
+		config.compactThreshold = GWAL_DEFAULT_COMPACT_THRESHOLD;
+	}
+
+	struct gmap_map *map;
+	FILE *snapshot = fopen(config.snapshotPath, "rb");
+
+	if (snapshot != NULL) {
+		fclose(snapshot);
+		map = private_gmap_loadBinary1(config.snapshotPath, &mapConfig);
+	}
+	else {
+		map = gmap_create1(mapConfig);
+	}
+
+	if (map == NULL) {
+		return NULL;
+	}
+
+	struct gwal_log *wal = (struct gwal_log *) malloc(sizeof(struct gwal_log));
+	wal->config = config;
+	wal->map = map;
+	wal->file = NULL;
+	wal->lostChanges = 0;
+	wal->recordBufferCapacity = 256;
+	wal->recordBuffer = malloc(wal->recordBufferCapacity);
+
+	bool exists;
+	bool tornTail;
+
+	if (private_gwal_replay(wal, &exists, &tornTail) == false) {
+		gmap_free(map);
+		free(wal->recordBuffer);
+		free(wal);
+		return NULL;
+	}
+
+	map->changeListener = private_gwal_onChange;
+	map->changeListenerContext = wal;
+
+	// A torn tail cannot be appended to, so everything that was recovered goes into a fresh snapshot.
+	if (exists && !tornTail) {
+		wal->file = fopen(config.logPath, "ab");
+		if (wal->file != NULL) {
+			fseek(wal->file, 0, SEEK_END);
+			wal->logSize = (uint64_t) ftell(wal->file);
+			wal->pendingRecords = 0;
+		}
+	}
+	else if (tornTail) {
+		gwal_compact(wal);
+	}
+	else {
+		wal->file = fopen(config.logPath, "wb");
+		if (wal->file != NULL && private_gwal_writeHeader(wal) == false) {
+			fclose(wal->file);
+			wal->file = NULL;
+		}
+	}
+
+	if (wal->file == NULL) {
+		printf("Error: gwal: Cannot open %s for writing\n", config.logPath);
+		map->changeListener = NULL;
+		gmap_free(map);
+		free(wal->recordBuffer);
+		free(wal);
+		return NULL;
+	}
+
+	return wal;
+}
+
+/*******************************************************************************************/
+
+// Operations.
+
+// Durability point. Returns true once all changes so far are on disk, and false if any of them could
+// not be logged.
+bool gwal_commit(struct gwal_log *wal) {
+	if (wal->file == NULL) {
+		printf("Error: gwal: %s is not open\n", wal->config.logPath);
+		return false;
+	}
+
+	if (private_gwal_sync(wal) == false) {
+		return false;
+	}
+
+	if (wal->lostChanges > 0) {
+		printf("Error: gwal: %" PRIu32 " changes were not logged, compact to save them\n", wal->lostChanges);
+		return false;
+	}
+	return true;
+}
+
+// Writes the whole map to the snapshot and starts a new, empty log. This also saves the changes that
+// could not be logged.
+bool gwal_compact(struct gwal_log *wal) {
+	if (wal->file != NULL && private_gwal_sync(wal) == false) {
+		return false;
+	}
+
+	if (gmap_saveBinary(wal->map, wal->config.snapshotPath) == false) {
+		return false;
+	}
+
+	wal->lostChanges = 0;
+
+	if (wal->file != NULL) {
+		fclose(wal->file);
+	}
+
+	wal->file = fopen(wal->config.logPath, "wb");
+	if (wal->file == NULL || private_gwal_writeHeader(wal) == false) {
+		printf("Error: gwal: Failed to reset %s\n", wal->config.logPath);
+		if (wal->file != NULL) {
+			fclose(wal->file);
+			wal->file = NULL;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/*******************************************************************************************/
+
+// Destructor.
+
+// Commits and closes the log and detaches it from the map. The map itself stays usable, without
+// logging, and is freed with gmap_free as usual, but only after the log is closed.
+bool gwal_close(struct gwal_log *wal) {
+	bool ok = gwal_commit(wal);
+	if (wal->file != NULL) {
+		ok = (fclose(wal->file) == 0) && ok;
+	}
+
+	wal->map->changeListener = NULL;
+	wal->map->changeListenerContext = NULL;
+
+	free(wal->recordBuffer);
+	free(wal);
+	return ok;
+}
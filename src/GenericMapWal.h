@@ -0,0 +1,85 @@
+#ifndef GENERICMAPWAL_H
+#define GENERICMAPWAL_H
+
+#include <stdio.h>
+
+#include "GenericMap.h"
+
+/*******************************************************************************************/
+
+// Constants.
+
+#define GWAL_VERSION						1
+#define GWAL_DEFAULT_GROUP_COMMIT_SIZE		1024
+#define GWAL_DEFAULT_COMPACT_THRESHOLD		(64 * 1024 * 1024)
+
+/*******************************************************************************************/
+
+// Data types.
+
+// For use in the constructor, like in the Builder pattern.
+// logPath and snapshotPath are required. The rest are optional.
+struct gwal_config {
+	const char *logPath;
+	const char *snapshotPath;
+
+	// Number of logged changes after which the log is flushed and synced to disk.
+	uint32_t groupCommitSize;
+
+	// Log size in bytes after which the map is written to the snapshot and the log is truncated.
+	uint64_t compactThreshold;
+};
+
+struct gwal_log {
+	struct gwal_config config;
+	struct gmap_map *map;
+	FILE *file;
+	uint64_t logSize;
+	uint32_t pendingRecords;
+
+	// Changes that were applied to the map but could not be logged. Reset by gwal_compact.
+	uint32_t lostChanges;
+	unsigned char *recordBuffer;
+	size_t recordBufferCapacity;
+};
+
+// Pseudo class.
+struct gwal_class {
+
+	// Constructors.
+	struct gwal_log *(*open)(struct gmap_config mapConfig, struct gwal_config config);
+
+	// Operations.
+	bool (*commit)(struct gwal_log *wal);
+	bool (*compact)(struct gwal_log *wal);
+
+	// Destructor.
+	bool (*close)(struct gwal_log *wal);
+
+};
+
+// OOP class object.
+extern struct gwal_class gwal;
+
+/*******************************************************************************************/
+
+// Constructors.
+
+extern struct gwal_log *gwal_open(struct gmap_config mapConfig, struct gwal_config config);
+
+/*******************************************************************************************/
+
+// Operations.
+
+extern bool gwal_commit(struct gwal_log *wal);
+extern bool gwal_compact(struct gwal_log *wal);
+
+/*******************************************************************************************/
+
+// Destructor.
+
+extern bool gwal_close(struct gwal_log *wal);
+
+/*******************************************************************************************/
+
+#endif /* GENERICMAPWAL_H */
@@ -16,6 +16,7 @@ struct gset_class gset = {
 		// Constructors.
 		.create = gset_create,
 		.create1 = gset_create1,
+		.createIdentity = gset_createIdentity,
 
 		// Basic operations.
 		.put = gset_put,
@@ -29,6 +30,7 @@ struct gset_class gset = {
 		.next = gset_next,
 		.getValueList = gset_getValueList,
 		.freeValueList = gset_freeValueList,
+		.equals = gset_equals,
 		.each = gset_each,
 		.print = gset_print,
 		.fprint = gset_fprint,
@@ -59,6 +61,8 @@ struct gset_set *gset_create1(struct gset_config config) {
 			.capacity = config.capacity,
 			.loadFactorOverThousand = config.loadFactorOverThousand,
 			.maintainInsertionOrder = config.maintainInsertionOrder,
+			.maintainFingerprint = config.maintainFingerprint,
+			.compactStorage = config.compactStorage,
 			.hashFunc = config.hashFunc,
 			.cmpFunc = config.cmpFunc,
 			.freeFunc = config.freeFunc
@@ -76,6 +80,11 @@ struct gset_set *gset_create1(struct gset_config config) {
 	return set;
 }
 
+// Set of objects compared by address, e.g. the visited set of a graph traversal.
+struct gset_set *gset_createIdentity(void) {
+	return gset_create(gvalue.pointerType);
+}
+
 /*******************************************************************************************/
 
 // Basic operations.
@@ -202,6 +211,11 @@ void gset_freeValueList(struct gset_value_list list) {
 	}
 }
 
+// Returns true if both sets have the same values. See gmap_equals.
+bool gset_equals(struct gset_set *set1, struct gset_set *set2) {
+	return gmap_equals(set1->map, set2->map);
+}
+
 void gset_each(struct gset_set *set, void (*func)(struct gvalue_value)) {
 	struct gmap_iterator iterator = gmap_iterator(set->map);
 	while (gmap_next(&iterator)) {
@@ -213,12 +227,17 @@ void gset_print(struct gset_set *set) {
 	gset_fprint(set, stdout);
 }
 
+// Values are formatted into a gvalue_writer, so large sets reach the stream in a few big writes.
 void gset_fprint(struct gset_set *set, FILE *stream) {
 	if (set->size == 0) {
 		fputs("()", stream);
 		return;
 	}
 
+	struct gvalue_writer writer;
+	gvalue_initWriter(&writer, stream);
+	gvalue_write(&writer, "( ");
+
 	struct gmap_iterator iterator = gmap_iterator(set->map);
 	bool isFirst = true;
 
@@ -227,13 +246,14 @@ void gset_fprint(struct gset_set *set, FILE *stream) {
 			isFirst = false;
 		}
 		else {
-			fputs(", ", stream);
+			gvalue_write(&writer, ", ");
 		}
 
-		gvalue_fprint(iterator.key, stream);
+		gvalue_writeValue(&writer, iterator.key);
 	}
 
-	fputs(" )", stream);
+	gvalue_write(&writer, " )");
+	gvalue_flushWriter(&writer);
 }
 
 // Lower score is better.
@@ -14,6 +14,11 @@ struct gset_config {
 	uint32_t capacity;
 	uint32_t loadFactorOverThousand;
 	bool maintainInsertionOrder;
+	bool maintainFingerprint;
+
+	// See gmap_config.compactStorage.
+	bool compactStorage;
+
 	uint32_t (*hashFunc)(struct gvalue_value);
 	int (*cmpFunc)(struct gvalue_value, struct gvalue_value);
 	bool (*freeFunc)(struct gvalue_value);
@@ -42,6 +47,7 @@ struct gset_class {
 	// Constructors.
 	struct gset_set *(*create)(const struct gvalue_type *dataType);
 	struct gset_set *(*create1)(struct gset_config config);
+	struct gset_set *(*createIdentity)(void);
 
 	// Basic operations.
 	bool (*put)(struct gset_set *set, struct gvalue_value value);
@@ -55,6 +61,7 @@ struct gset_class {
 	bool (*next)(struct gset_iterator *iterator);
 	struct gset_value_list (*getValueList)(struct gset_set *set);
 	void (*freeValueList)(struct gset_value_list list);
+	bool (*equals)(struct gset_set *set1, struct gset_set *set2);
 	void (*each)(struct gset_set *set, void (*func)(struct gvalue_value));
 	void (*print)(struct gset_set* set);
 	void (*fprint)(struct gset_set* set, FILE *stream);
@@ -74,6 +81,7 @@ extern struct gset_class gset;
 
 extern struct gset_set *gset_create(const struct gvalue_type *dataType);
 extern struct gset_set *gset_create1(struct gset_config config);
+extern struct gset_set *gset_createIdentity(void);
 
 /*******************************************************************************************/
 
@@ -93,6 +101,7 @@ extern struct gset_iterator gset_iterator(struct gset_set *set);
 extern bool gset_next(struct gset_iterator *iterator);
 extern struct gset_value_list gset_getValueList(struct gset_set *set);
 extern void gset_freeValueList(struct gset_value_list list);
+extern bool gset_equals(struct gset_set *set1, struct gset_set *set2);
 extern void gset_each(struct gset_set *set, void (*func)(struct gvalue_value));
 extern void gset_print(struct gset_set* set);
 extern void gset_fprint(struct gset_set* set, FILE *stream);
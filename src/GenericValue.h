@@ -4,10 +4,31 @@
 #include <stdbool.h>
 #include <float.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <wchar.h>
 
 #define GVALUE_BUFFER_SIZE 100
 
+// Longest string that a short string keeps inside the value itself.
+#define GVALUE_SSTRING_CAPACITY 15
+#define GVALUE_SSTRING_POINTER_TAG ((char) 0x7F)
+
+// Values of registered types up to this size are stored inside the value itself.
+#define GVALUE_INLINE_CAPACITY 16
+
+#define GVALUE_TUPLE_MIN_FIELDS 2
+#define GVALUE_TUPLE_MAX_FIELDS 4
+
+// Size of the block that a gvalue_writer collects before writing it to its stream.
+#define GVALUE_WRITER_BUFFER_SIZE (16 * 1024)
+
+// Most bytes that gvalue_encodeUtf8 writes for one wchar_t.
+#define GVALUE_UTF8_MAX_BYTES_PER_WCHAR 4
+
+// Bumped whenever gvalue_hash changes its output, so that anything that keeps hash codes outside of
+// the process (like FileMap) knows to rehash.
+#define GVALUE_HASH_VERSION 3
+
 /*******************************************************************************************/
 
 // Data types.
@@ -34,15 +55,52 @@ enum gvalue_type_codes {
 	GVALUE_TYPE_STRING,
 	GVALUE_TYPE_WSTRING,
 
+	// Interned string, see gvalue_intern. Uses stringValue. New types are added at the end so that
+	// the codes in files written by earlier versions keep their meaning.
+	GVALUE_TYPE_ISTRING,
+
+	// Short string, see gvalue_getSString. Uses sstringValue.
+	GVALUE_TYPE_SSTRING,
+
+	// Byte slice of a given length, see gvalue_getBytes. Uses bytesValue.
+	GVALUE_TYPE_BYTES,
+
 	// Stores the total number of types. This is not a data type.
 	GVALUE_TYPES_COUNT
 };
 
-// Strongly-typed enum.
+struct gvalue_value;
+
+// Strongly-typed enum. Each type also carries the operations on its values, so that gvalue_hash,
+// gvalue_cmp and the like are a single indirect call. All of them must be set. cmp is only called
+// with two values of this type.
+// Types other than the built-in ones are added with gvalue_registerType.
 struct gvalue_type {
 	int code;
 	char *name;
 	char *cTypeName;
+
+	// Number of bytes of the primitive that hold the value. For registered types, the size of the
+	// data given to gvalue_getCustom.
+	size_t size;
+
+	// Free for use by registered types.
+	const void *context;
+
+	uint32_t (*hash)(struct gvalue_value value);
+	int (*cmp)(struct gvalue_value value1, struct gvalue_value value2);
+	bool (*free)(struct gvalue_value value);
+	void (*fprint)(struct gvalue_value value, FILE *stream);
+	char *(*allocString)(struct gvalue_value value);
+
+	// Same contract as gvalue_format.
+	size_t (*format)(struct gvalue_value value, char *buffer, size_t length);
+};
+
+// Points into memory owned by someone else, like a receive buffer. Need not be NUL-terminated.
+struct gvalue_bytes {
+	const unsigned char *data;
+	size_t length;
 };
 
 union gvalue_primitive {
@@ -66,6 +124,15 @@ union gvalue_primitive {
 	wchar_t wcharValue;
 	char *stringValue;
 	wchar_t *wstringValue;
+
+	// Up to GVALUE_SSTRING_CAPACITY characters and the terminator. The last byte is 0 for inline
+	// strings and GVALUE_SSTRING_POINTER_TAG when stringValue points to a longer string instead.
+	char sstringValue[GVALUE_SSTRING_CAPACITY + 1];
+
+	struct gvalue_bytes bytesValue;
+
+	// Data of registered types that fit, see gvalue_getCustom.
+	unsigned char inlineValue[GVALUE_INLINE_CAPACITY];
 };
 
 struct gvalue_value {
@@ -73,6 +140,27 @@ struct gvalue_value {
 	union gvalue_primitive primitive;
 };
 
+// Set of canonical strings. Interning the same characters twice returns the same pointer, so interned
+// strings can be compared by address. Each string is stored once, right after its precomputed hash
+// code and length, in large blocks that are only released when the whole pool is freed.
+// Not thread-safe.
+struct gvalue_intern_pool {
+	uint32_t size;
+	uint32_t capacity;
+	char **table;
+	void *block;
+	size_t blockUsed;
+	size_t blockCapacity;
+};
+
+// Collects formatted values and writes them to the stream in blocks of GVALUE_WRITER_BUFFER_SIZE,
+// instead of going through stdio for every value. Usually lives on the stack, see gvalue_initWriter.
+struct gvalue_writer {
+	FILE *stream;
+	size_t used;
+	char buffer[GVALUE_WRITER_BUFFER_SIZE];
+};
+
 // Pseudo class.
 struct gvalue_class {
 
@@ -97,6 +185,9 @@ struct gvalue_class {
 	const struct gvalue_type *wcharType;
 	const struct gvalue_type *stringType;
 	const struct gvalue_type *wstringType;
+	const struct gvalue_type *istringType;
+	const struct gvalue_type *sstringType;
+	const struct gvalue_type *bytesType;
 
 	// Primitives.
 	union gvalue_primitive (*getBoolPrimitive)(bool boolValue);
@@ -133,8 +224,27 @@ struct gvalue_class {
 	struct gvalue_value (*getWChar)(wchar_t wcharValue);
 	struct gvalue_value (*getString)(char *stringValue);
 	struct gvalue_value (*getWString)(wchar_t *wstringValue);
+	struct gvalue_value (*getIString)(char *internedString);
+	struct gvalue_value (*getSString)(char *stringValue);
+	struct gvalue_value (*getBytes)(const void *data, size_t length);
+
+	// String interning.
+	struct gvalue_intern_pool *(*createInternPool)(void);
+	char *(*intern)(const char *string);
+	char *(*internIn)(struct gvalue_intern_pool *pool, const char *string);
+	void (*freeInternPool)(struct gvalue_intern_pool *pool);
+
+	// Registered types.
+	const struct gvalue_type *(*registerType)(struct gvalue_type type);
+	struct gvalue_value (*getCustom)(const struct gvalue_type *type, const void *data);
+	const void *(*customData)(const struct gvalue_value *value);
+	const struct gvalue_type *(*getTupleType)(int count, const struct gvalue_type *const *fieldTypes);
+	struct gvalue_value (*getTuple)(const struct gvalue_type *tupleType, const struct gvalue_value *fields);
+	struct gvalue_value (*tupleField)(struct gvalue_value tuple, int index);
+	void (*freeRegisteredTypes)(void);
 
 	// Helpers.
+	const struct gvalue_type *(*getType)(int code);
 	void (*print)(struct gvalue_value primitive);
 	void (*fprint)(struct gvalue_value primitive, FILE *stream);
 	void (*dump)(struct gvalue_value primitive);
@@ -143,18 +253,45 @@ struct gvalue_class {
 	int64_t (*longValue)(struct gvalue_value primitive);
 	bool (*tryGetDouble)(struct gvalue_value primitive, double *outDoubleValue);
 	double (*doubleValue)(struct gvalue_value primitive);
+	char *(*stringChars)(struct gvalue_value *primitive);
 	char *(*getAllocStringValue)(struct gvalue_value primitive);
 	wchar_t *(*getAllocWStringValue)(struct gvalue_value primitive);
 	bool (*free)(struct gvalue_value primitive);
 	int (*cmp)(struct gvalue_value value1, struct gvalue_value value2);
 
+	// Compact representation.
+	bool (*isCompactType)(const struct gvalue_type *type);
+	bool (*toCompact)(struct gvalue_value value, uint64_t *outWord);
+	struct gvalue_value (*fromCompact)(uint64_t word);
+
+	// Formatting.
+	size_t (*format)(struct gvalue_value value, char *buffer, size_t length);
+	void (*initWriter)(struct gvalue_writer *writer, FILE *stream);
+	void (*write)(struct gvalue_writer *writer, const char *chars);
+	void (*writeValue)(struct gvalue_writer *writer, struct gvalue_value value);
+	void (*flushWriter)(struct gvalue_writer *writer);
+
+	// Number parsing.
+	bool (*parseLong)(const char *chars, size_t length, int64_t *outLongValue);
+	bool (*parseDouble)(const char *chars, size_t length, double *outDoubleValue);
+
+	// UTF-8 transcoding.
+	size_t (*encodeUtf8)(const wchar_t *source, size_t count, char *out);
+	size_t (*decodeUtf8)(const char *source, size_t length, wchar_t *out);
+
 	// Hash code.
 	uint32_t (*hashInt)(uint32_t i);
 	uint32_t (*hashDouble)(double d);
+	uint32_t (*hashPointer)(const void *pointer);
 	uint32_t (*hashString)(char *string);
 	uint32_t (*hashWString)(wchar_t *wstring);
+	uint32_t (*hashBytes)(const void *data, size_t length);
 	uint32_t (*hash)(struct gvalue_value primitive);
 
+	// Case-insensitive keys.
+	uint32_t (*hashIgnoreCase)(struct gvalue_value value);
+	int (*cmpIgnoreCase)(struct gvalue_value value1, struct gvalue_value value2);
+
 };
 
 // OOP class object.
@@ -201,11 +338,36 @@ extern struct gvalue_value gvalue_getChar(char charValue);
 extern struct gvalue_value gvalue_getWChar(wchar_t wcharValue);
 extern struct gvalue_value gvalue_getString(char *stringValue);
 extern struct gvalue_value gvalue_getWString(wchar_t *wstringValue);
+extern struct gvalue_value gvalue_getIString(char *internedString);
+extern struct gvalue_value gvalue_getSString(char *stringValue);
+extern struct gvalue_value gvalue_getBytes(const void *data, size_t length);
+
+/*******************************************************************************************/
+
+// String interning.
+
+extern struct gvalue_intern_pool *gvalue_createInternPool(void);
+extern char *gvalue_intern(const char *string);
+extern char *gvalue_internIn(struct gvalue_intern_pool *pool, const char *string);
+extern void gvalue_freeInternPool(struct gvalue_intern_pool *pool);
+
+/*******************************************************************************************/
+
+// Registered types.
+
+extern const struct gvalue_type *gvalue_registerType(struct gvalue_type type);
+extern struct gvalue_value gvalue_getCustom(const struct gvalue_type *type, const void *data);
+extern const void *gvalue_customData(const struct gvalue_value *value);
+extern const struct gvalue_type *gvalue_getTupleType(int count, const struct gvalue_type *const *fieldTypes);
+extern struct gvalue_value gvalue_getTuple(const struct gvalue_type *tupleType, const struct gvalue_value *fields);
+extern struct gvalue_value gvalue_tupleField(struct gvalue_value tuple, int index);
+extern void gvalue_freeRegisteredTypes(void);
 
 /*******************************************************************************************/
 
 // Convenient helpers.
 
+extern const struct gvalue_type *gvalue_getType(int code);
 extern void gvalue_print(struct gvalue_value value);
 extern void gvalue_fprint(struct gvalue_value value, FILE *stream);
 extern void gvalue_dump(struct gvalue_value value);
@@ -214,6 +376,7 @@ extern bool gvalue_tryGetLong(struct gvalue_value value, int64_t *outLongValue);
 extern int64_t gvalue_longValue(struct gvalue_value value);
 extern bool gvalue_tryGetDouble(struct gvalue_value value, double *outDoubleValue);
 extern double gvalue_doubleValue(struct gvalue_value value);
+extern char *gvalue_stringChars(struct gvalue_value *value);
 extern char *gvalue_getAllocStringValue(struct gvalue_value value);
 extern wchar_t *gvalue_getAllocWStringValue(struct gvalue_value value);
 extern bool gvalue_free(struct gvalue_value value);
@@ -221,15 +384,68 @@ extern int gvalue_cmp(struct gvalue_value value1, struct gvalue_value value2);
 
 /*******************************************************************************************/
 
+// Compact representation.
+
+extern bool gvalue_isCompactType(const struct gvalue_type *type);
+extern bool gvalue_toCompact(struct gvalue_value value, uint64_t *outWord);
+extern struct gvalue_value gvalue_fromCompact(uint64_t word);
+
+/*******************************************************************************************/
+
+// Formatting.
+
+extern size_t gvalue_format(struct gvalue_value value, char *buffer, size_t length);
+extern void gvalue_initWriter(struct gvalue_writer *writer, FILE *stream);
+extern void gvalue_write(struct gvalue_writer *writer, const char *chars);
+extern void gvalue_writeValue(struct gvalue_writer *writer, struct gvalue_value value);
+extern void gvalue_flushWriter(struct gvalue_writer *writer);
+
+/*******************************************************************************************/
+
+// Number parsing. Both read exactly length characters, which need not be NUL-terminated.
+
+// Accepts the canonical decimal form only, the one gvalue_format writes: an optional minus sign and
+// digits without leading zeros, within the range of int64_t. Same as gvalue_tryGetLong on a string.
+extern bool gvalue_parseLong(const char *chars, size_t length, int64_t *outLongValue);
+
+// Accepts whatever strtod accepts when it has to consume all characters, with the same result.
+extern bool gvalue_parseDouble(const char *chars, size_t length, double *outDoubleValue);
+
+/*******************************************************************************************/
+
+// UTF-8 transcoding. wchar_t strings are UTF-32, or UTF-16 where wchar_t is 16 bits wide.
+// Neither function writes a terminator, and malformed input becomes U+FFFD.
+
+// Writes count characters of source to out, which must have room for
+// count * GVALUE_UTF8_MAX_BYTES_PER_WCHAR bytes, and returns the number of bytes written.
+extern size_t gvalue_encodeUtf8(const wchar_t *source, size_t count, char *out);
+
+// Writes length bytes of source to out, which must have room for length wchar_t, and returns the
+// number of wchar_t written.
+extern size_t gvalue_decodeUtf8(const char *source, size_t length, wchar_t *out);
+
+/*******************************************************************************************/
+
 // Calculate hash code.
 
 extern uint32_t gvalue_hashInt(uint32_t i);
 extern uint32_t gvalue_hashLong(uint64_t i);
 extern uint32_t gvalue_hashDouble(double d);
+extern uint32_t gvalue_hashPointer(const void *pointer);
 extern uint32_t gvalue_hashString(char *string);
 extern uint32_t gvalue_hashWString(wchar_t *wstring);
+extern uint32_t gvalue_hashBytes(const void *data, size_t length);
 extern uint32_t gvalue_hash(struct gvalue_value value);
 
 /*******************************************************************************************/
 
+// Case-insensitive keys. For gmap_config.hashFunc and cmpFunc with string, istring, sstring or wstring
+// keys. Narrow strings fold ASCII letters only, wide strings also fold other letters with towlower.
+// Values of other types are hashed and compared as usual.
+
+extern uint32_t gvalue_hashIgnoreCase(struct gvalue_value value);
+extern int gvalue_cmpIgnoreCase(struct gvalue_value value1, struct gvalue_value value2);
+
+/*******************************************************************************************/
+
 #endif /* GENERIC_VALUE_H */
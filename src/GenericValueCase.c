@@ -0,0 +1,244 @@
+/**
+ * Case-insensitive hashing and comparison of string keys.
+ *
+ * gvalue_hashIgnoreCase and gvalue_cmpIgnoreCase go into gmap_config.hashFunc and cmpFunc, so that
+ * keys like HTTP header names or host names can be looked up without lowercasing a copy first.
+ * Narrow strings fold ASCII letters only, 16 bytes at a time with SSE2 or 8 at a time with 64-bit words
+ * on other targets; bytes of UTF-8 sequences are compared as they are. Wide strings fold ASCII the same
+ * way and everything else with towlower, so they follow the current locale.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRIVATE_GVALUE_CASE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "GenericValue.h"
+
+// Strings are folded into a stack buffer this many characters at a time. Shorter strings hash to the
+// same code as their lowercase form does with gvalue_hashString and gvalue_hashWString.
+#define PRIVATE_GVALUE_FOLD_CHUNK 256
+
+/*******************************************************************************************/
+
+// Folding.
+
+// Lowercases the ASCII letters of count bytes of source into out. Everything else is copied unchanged.
+void private_gvalue_foldAscii(const unsigned char *source, size_t count, unsigned char *out) {
+	size_t i = 0;
+
+#ifdef PRIVATE_GVALUE_CASE_SSE2
+	// Bytes from 0x80 on are negative as signed bytes, so they never fall into the range.
+	const __m128i beforeA = _mm_set1_epi8('A' - 1);
+	const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi8(0x20);
+	while (i + 16 <= count) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *) (source + i));
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeA), _mm_cmplt_epi8(bytes, afterZ));
+		_mm_storeu_si128((__m128i *) (out + i), _mm_or_si128(bytes, _mm_and_si128(upper, caseBit)));
+		i += 16;
+	}
+#endif
+
+	while (i + 8 <= count) {
+		uint64_t word;
+		memcpy(&word, source + i, sizeof(word));
+
+		// Per byte, the high bit of atLeastA is set from 'A' on and that of pastZ from past 'Z' on. The
+		// low seven bits never carry into the next byte.
+		uint64_t low = word & UINT64_C(0x7F7F7F7F7F7F7F7F);
+		uint64_t atLeastA = low + UINT64_C(0x0101010101010101) * (0x80 - 'A');
+		uint64_t pastZ = low + UINT64_C(0x0101010101010101) * (0x80 - 'Z' - 1);
+		uint64_t upper = atLeastA & ~pastZ & ~word & UINT64_C(0x8080808080808080);
+		word |= upper >> 2;
+
+		memcpy(out + i, &word, sizeof(word));
+		i += 8;
+	}
+
+	for (; i < count; i++) {
+		unsigned char c = source[i];
+		out[i] = (c >= 'A' && c <= 'Z') ? (unsigned char) (c | 0x20) : c;
+	}
+}
+
+wchar_t private_gvalue_foldWChar(wchar_t c) {
+	if ((uint32_t) c < 0x80) {
+		return (c >= L'A' && c <= L'Z') ? (wchar_t) (c | 0x20) : c;
+	}
+	return (wchar_t) towlower((wint_t) c);
+}
+
+// Folds count characters of source into out, blocks of ASCII with SSE2 where available.
+void private_gvalue_foldWide(const wchar_t *source, size_t count, wchar_t *out) {
+	size_t i = 0;
+
+#ifdef PRIVATE_GVALUE_CASE_SSE2
+#if WCHAR_MAX > 0xFFFF
+	const __m128i nonAscii = _mm_set1_epi32(~0x7F);
+	const __m128i beforeA = _mm_set1_epi32('A' - 1);
+	const __m128i afterZ = _mm_set1_epi32('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi32(0x20);
+	const __m128i zero = _mm_setzero_si128();
+	while (i + 4 <= count) {
+		__m128i chars = _mm_loadu_si128((const __m128i *) (source + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(chars, nonAscii), zero)) != 0xFFFF) {
+			out[i] = private_gvalue_foldWChar(source[i]);
+			i++;
+			continue;
+		}
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi32(chars, beforeA), _mm_cmplt_epi32(chars, afterZ));
+		_mm_storeu_si128((__m128i *) (out + i), _mm_or_si128(chars, _mm_and_si128(upper, caseBit)));
+		i += 4;
+	}
+#else
+	const __m128i nonAscii = _mm_set1_epi16((short) ~0x7F);
+	const __m128i beforeA = _mm_set1_epi16('A' - 1);
+	const __m128i afterZ = _mm_set1_epi16('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi16(0x20);
+	const __m128i zero = _mm_setzero_si128();
+	while (i + 8 <= count) {
+		__m128i chars = _mm_loadu_si128((const __m128i *) (source + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, nonAscii), zero)) != 0xFFFF) {
+			out[i] = private_gvalue_foldWChar(source[i]);
+			i++;
+			continue;
+		}
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi16(chars, beforeA), _mm_cmplt_epi16(chars, afterZ));
+		_mm_storeu_si128((__m128i *) (out + i), _mm_or_si128(chars, _mm_and_si128(upper, caseBit)));
+		i += 8;
+	}
+#endif
+#endif
+
+	for (; i < count; i++) {
+		out[i] = private_gvalue_foldWChar(source[i]);
+	}
+}
+
+/*******************************************************************************************/
+
+// Narrow and wide strings.
+
+uint32_t private_gvalue_hashStringIgnoreCase(const char *string) {
+	unsigned char folded[PRIVATE_GVALUE_FOLD_CHUNK];
+	size_t length = strlen(string);
+
+	if (length <= PRIVATE_GVALUE_FOLD_CHUNK) {
+		private_gvalue_foldAscii((const unsigned char *) string, length, folded);
+		return gvalue_hashBytes(folded, length);
+	}
+
+	// Chained like the fields of a tuple.
+	uint32_t hashCode = 0;
+	for (size_t at = 0; at < length; at += PRIVATE_GVALUE_FOLD_CHUNK) {
+		size_t count = (length - at < PRIVATE_GVALUE_FOLD_CHUNK) ? length - at : PRIVATE_GVALUE_FOLD_CHUNK;
+		private_gvalue_foldAscii((const unsigned char *) string + at, count, folded);
+		hashCode = gvalue_hashLong(((uint64_t) hashCode << 32) | gvalue_hashBytes(folded, count));
+	}
+	return hashCode;
+}
+
+uint32_t private_gvalue_hashWStringIgnoreCase(const wchar_t *wstring) {
+	wchar_t folded[PRIVATE_GVALUE_FOLD_CHUNK];
+	size_t length = wcslen(wstring);
+
+	if (length <= PRIVATE_GVALUE_FOLD_CHUNK) {
+		private_gvalue_foldWide(wstring, length, folded);
+		return gvalue_hashBytes(folded, length * sizeof(wchar_t));
+	}
+
+	uint32_t hashCode = 0;
+	for (size_t at = 0; at < length; at += PRIVATE_GVALUE_FOLD_CHUNK) {
+		size_t count = (length - at < PRIVATE_GVALUE_FOLD_CHUNK) ? length - at : PRIVATE_GVALUE_FOLD_CHUNK;
+		private_gvalue_foldWide(wstring + at, count, folded);
+		hashCode = gvalue_hashLong(((uint64_t) hashCode << 32) | gvalue_hashBytes(folded, count * sizeof(wchar_t)));
+	}
+	return hashCode;
+}
+
+// Orders like strcmp on the folded strings.
+int private_gvalue_cmpStringIgnoreCase(const char *string1, const char *string2) {
+	const unsigned char *s1 = (const unsigned char *) string1;
+	const unsigned char *s2 = (const unsigned char *) string2;
+	size_t length1 = strlen(string1);
+	size_t length2 = strlen(string2);
+	size_t common = (length1 < length2) ? length1 : length2;
+	size_t i = 0;
+
+#ifdef PRIVATE_GVALUE_CASE_SSE2
+	// Equal blocks are skipped 16 bytes at a time. The first block that differs after folding is left
+	// to the loop below.
+	const __m128i beforeA = _mm_set1_epi8('A' - 1);
+	const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi8(0x20);
+	while (i + 16 <= common) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (s1 + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (s2 + i));
+		a = _mm_or_si128(a, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(a, beforeA), _mm_cmplt_epi8(a, afterZ)), caseBit));
+		b = _mm_or_si128(b, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(b, beforeA), _mm_cmplt_epi8(b, afterZ)), caseBit));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) {
+			break;
+		}
+		i += 16;
+	}
+#endif
+
+	for (; i < common; i++) {
+		unsigned char c1 = (s1[i] >= 'A' && s1[i] <= 'Z') ? (unsigned char) (s1[i] | 0x20) : s1[i];
+		unsigned char c2 = (s2[i] >= 'A' && s2[i] <= 'Z') ? (unsigned char) (s2[i] | 0x20) : s2[i];
+		if (c1 != c2) {
+			return (int) c1 - (int) c2;
+		}
+	}
+	return (length1 > length2) - (length1 < length2);
+}
+
+int private_gvalue_cmpWStringIgnoreCase(const wchar_t *wstring1, const wchar_t *wstring2) {
+	for (size_t i = 0;; i++) {
+		wchar_t c1 = private_gvalue_foldWChar(wstring1[i]);
+		wchar_t c2 = private_gvalue_foldWChar(wstring2[i]);
+		if (c1 != c2) {
+			return (c1 > c2) - (c1 < c2);
+		}
+		if (c1 == L'\0') {
+			return 0;
+		}
+	}
+}
+
+/*******************************************************************************************/
+
+// Values.
+
+bool private_gvalue_isNarrowText(struct gvalue_value value) {
+	int code = value.type->code;
+	return code == GVALUE_TYPE_STRING || code == GVALUE_TYPE_ISTRING || code == GVALUE_TYPE_SSTRING;
+}
+
+uint32_t gvalue_hashIgnoreCase(struct gvalue_value value) {
+	if (private_gvalue_isNarrowText(value)) {
+		char *chars = gvalue_stringChars(&value);
+		return (chars == NULL) ? 0 : private_gvalue_hashStringIgnoreCase(chars);
+	}
+	if (value.type->code == GVALUE_TYPE_WSTRING) {
+		return (value.primitive.wstringValue == NULL) ? 0 : private_gvalue_hashWStringIgnoreCase(value.primitive.wstringValue);
+	}
+	return value.type->hash(value);
+}
+
+int gvalue_cmpIgnoreCase(struct gvalue_value value1, struct gvalue_value value2) {
+	if (private_gvalue_isNarrowText(value1) && private_gvalue_isNarrowText(value2)) {
+		return private_gvalue_cmpStringIgnoreCase(gvalue_stringChars(&value1), gvalue_stringChars(&value2));
+	}
+	if (value1.type->code == GVALUE_TYPE_WSTRING && value2.type->code == GVALUE_TYPE_WSTRING) {
+		return private_gvalue_cmpWStringIgnoreCase(value1.primitive.wstringValue, value2.primitive.wstringValue);
+	}
+	return gvalue_cmp(value1, value2);
+}
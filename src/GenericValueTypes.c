@@ -0,0 +1,959 @@
+/**
+ * Built-in value types.
+ *
+ * Every type carries its own hash, compare, free, print and string conversion functions, so that the
+ * generic gvalue functions dispatch with a single indirect call instead of a switch over all types.
+ * gmap binds the key type's hash and compare functions directly.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "GenericValue.h"
+
+// Defined in GenericValue.c.
+extern uint32_t private_gvalue_istringHashCode(const char *internedString);
+extern void private_gvalue_fprintBytes(struct gvalue_bytes bytes, FILE *stream);
+extern char *private_allocStringToString(char *s);
+extern char *private_allocBytesToString(struct gvalue_bytes bytes);
+extern size_t private_gvalue_append(char *buffer, size_t length, size_t at, const char *chars, size_t count);
+extern size_t private_gvalue_ulongToChars(uint64_t value, char *out);
+extern size_t private_gvalue_longToChars(int64_t value, char *out);
+extern size_t private_gvalue_doubleToChars(double d, bool isFloat, char *out);
+
+// Defined in GenericValueUtf8.c.
+extern char *private_allocWStringToString(wchar_t *s);
+
+// Wide strings are converted to UTF-8 in blocks of this many characters when printed or formatted.
+#define PRIVATE_GVALUE_WSTRING_CHUNK 256
+
+/*******************************************************************************************/
+
+// Shared operations.
+
+// For types that never own any memory.
+bool private_gvalue_freeNothing(struct gvalue_value value) {
+	return false;
+}
+
+// For types whose text always fits into GVALUE_BUFFER_SIZE, so that printing needs no stdio formatting
+// and no allocation besides the result.
+void private_gvalue_fprintFormatted(struct gvalue_value value, FILE *stream) {
+	char buffer[GVALUE_BUFFER_SIZE];
+	fwrite(buffer, 1, value.type->format(value, buffer, sizeof(buffer)), stream);
+}
+
+char *private_gvalue_allocFormatted(struct gvalue_value value) {
+	char buffer[GVALUE_BUFFER_SIZE];
+	size_t count = value.type->format(value, buffer, sizeof(buffer));
+	char *string = malloc(count + 1);
+	memcpy(string, buffer, count + 1);
+	return string;
+}
+
+// Lowercase hexadecimal with a 0x prefix.
+size_t private_gvalue_pointerToChars(const void *pointer, char *out) {
+	static const char hexDigits[] = "0123456789abcdef";
+	uintptr_t address = (uintptr_t) pointer;
+	char digits[2 * sizeof(uintptr_t)];
+	size_t start = sizeof(digits);
+
+	do {
+		digits[--start] = hexDigits[address & 15];
+		address >>= 4;
+	} while (address != 0);
+
+	out[0] = '0';
+	out[1] = 'x';
+	memcpy(out + 2, digits + start, sizeof(digits) - start);
+	return 2 + sizeof(digits) - start;
+}
+
+// NaN is equal to itself and greater than any number, so that NaN keys can be found again and sorting
+// stays consistent. -0.0 and 0.0 are equal.
+int private_gvalue_cmpDouble(double d1, double d2) {
+	if (d1 < d2) {
+		return -1;
+	}
+	if (d1 > d2) {
+		return 1;
+	}
+	if (d1 == d2) {
+		return 0;
+	}
+	return (d1 != d1) - (d2 != d2);
+}
+
+/*******************************************************************************************/
+
+// Per-type operations.
+
+uint32_t private_bool_hash(struct gvalue_value value) {
+	return value.primitive.boolValue;
+}
+
+int private_bool_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return value1.primitive.boolValue - value2.primitive.boolValue;
+}
+
+size_t private_bool_format(struct gvalue_value value, char *buffer, size_t length) {
+	return (value.primitive.boolValue == false)
+			? private_gvalue_append(buffer, length, 0, "false", 5) : private_gvalue_append(buffer, length, 0, "true", 4);
+}
+
+uint32_t private_byte_hash(struct gvalue_value value) {
+	return gvalue_hashInt((uint32_t) (value.primitive.byteValue));
+}
+
+int private_byte_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (int) (value1.primitive.byteValue) - (int) (value2.primitive.byteValue);
+}
+
+size_t private_byte_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_longToChars(value.primitive.byteValue, chars));
+}
+
+uint32_t private_short_hash(struct gvalue_value value) {
+	return gvalue_hashInt((uint32_t) (value.primitive.shortValue));
+}
+
+int private_short_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (int) (value1.primitive.shortValue) - (int) (value2.primitive.shortValue);
+}
+
+size_t private_short_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_longToChars(value.primitive.shortValue, chars));
+}
+
+uint32_t private_int_hash(struct gvalue_value value) {
+	return gvalue_hashInt(value.primitive.intValue);
+}
+
+int private_int_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.intValue < value2.primitive.intValue) ? -1 : (value1.primitive.intValue == value2.primitive.intValue) ? 0 : 1;
+}
+
+size_t private_int_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_longToChars(value.primitive.intValue, chars));
+}
+
+uint32_t private_long_hash(struct gvalue_value value) {
+	return gvalue_hashLong((uint64_t) (value.primitive.longValue));
+}
+
+int private_long_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.longValue < value2.primitive.longValue) ? -1 : (value1.primitive.longValue == value2.primitive.longValue) ? 0 : 1;
+}
+
+size_t private_long_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_longToChars(value.primitive.longValue, chars));
+}
+
+uint32_t private_ubyte_hash(struct gvalue_value value) {
+	return gvalue_hashInt((uint32_t) (value.primitive.ubyteValue));
+}
+
+int private_ubyte_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.ubyteValue < value2.primitive.ubyteValue) ? -1 : (value1.primitive.ubyteValue == value2.primitive.ubyteValue) ? 0 : 1;
+}
+
+size_t private_ubyte_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_ulongToChars(value.primitive.ubyteValue, chars));
+}
+
+uint32_t private_ushort_hash(struct gvalue_value value) {
+	return gvalue_hashInt((uint32_t) (value.primitive.ushortValue));
+}
+
+int private_ushort_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.ushortValue < value2.primitive.ushortValue) ? -1 : (value1.primitive.ushortValue == value2.primitive.ushortValue) ? 0 : 1;
+}
+
+size_t private_ushort_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_ulongToChars(value.primitive.ushortValue, chars));
+}
+
+uint32_t private_uint_hash(struct gvalue_value value) {
+	return gvalue_hashInt((uint32_t) (value.primitive.uintValue));
+}
+
+int private_uint_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.uintValue < value2.primitive.uintValue) ? -1 : (value1.primitive.uintValue == value2.primitive.uintValue) ? 0 : 1;
+}
+
+size_t private_uint_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_ulongToChars(value.primitive.uintValue, chars));
+}
+
+uint32_t private_ulong_hash(struct gvalue_value value) {
+	return gvalue_hashLong(value.primitive.ulongValue);
+}
+
+int private_ulong_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.ulongValue < value2.primitive.ulongValue) ? -1 : (value1.primitive.ulongValue == value2.primitive.ulongValue) ? 0 : 1;
+}
+
+size_t private_ulong_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_ulongToChars(value.primitive.ulongValue, chars));
+}
+
+uint32_t private_float_hash(struct gvalue_value value) {
+	return gvalue_hashDouble((double) (value.primitive.floatValue));
+}
+
+int private_float_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return private_gvalue_cmpDouble(value1.primitive.floatValue, value2.primitive.floatValue);
+}
+
+size_t private_float_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_doubleToChars(value.primitive.floatValue, true, chars));
+}
+
+uint32_t private_double_hash(struct gvalue_value value) {
+	return gvalue_hashDouble(value.primitive.doubleValue);
+}
+
+int private_double_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return private_gvalue_cmpDouble(value1.primitive.doubleValue, value2.primitive.doubleValue);
+}
+
+size_t private_double_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_doubleToChars(value.primitive.doubleValue, false, chars));
+}
+
+uint32_t private_pointer_hash(struct gvalue_value value) {
+	return gvalue_hashPointer(value.primitive.pointerValue);
+}
+
+// Compares addresses, which is consistent with the hash.
+int private_pointer_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.pointerValue < value2.primitive.pointerValue) ? -1 : (value1.primitive.pointerValue == value2.primitive.pointerValue) ? 0 : 1;
+}
+
+bool private_pointer_free(struct gvalue_value value) {
+	if (value.primitive.pointerValue != NULL) {
+		free(value.primitive.pointerValue);
+		return true;
+	}
+	return false;
+}
+
+size_t private_pointer_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[32];
+	return private_gvalue_append(buffer, length, 0, chars, private_gvalue_pointerToChars(value.primitive.pointerValue, chars));
+}
+
+uint32_t private_char_hash(struct gvalue_value value) {
+	return gvalue_hashInt((int) (value.primitive.charValue));
+}
+
+int private_char_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (int) (value1.primitive.charValue) - (int) (value2.primitive.charValue);
+}
+
+size_t private_char_format(struct gvalue_value value, char *buffer, size_t length) {
+	return private_gvalue_append(buffer, length, 0, &(value.primitive.charValue), 1);
+}
+
+uint32_t private_wchar_hash(struct gvalue_value value) {
+	return gvalue_hashInt((int) (value.primitive.wcharValue));
+}
+
+int private_wchar_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (int) (value1.primitive.wcharValue) - (int) (value2.primitive.wcharValue);
+}
+
+void private_wchar_fprint(struct gvalue_value value, FILE *stream) {
+	char chars[GVALUE_UTF8_MAX_BYTES_PER_WCHAR];
+	fwrite(chars, 1, gvalue_encodeUtf8(&(value.primitive.wcharValue), 1, chars), stream);
+}
+
+char *private_wchar_allocString(struct gvalue_value value) {
+	wchar_t wstring[2] = { value.primitive.wcharValue, L'\0' };
+	return private_allocWStringToString(wstring);
+}
+
+size_t private_wchar_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[GVALUE_UTF8_MAX_BYTES_PER_WCHAR];
+	return private_gvalue_append(buffer, length, 0, chars, gvalue_encodeUtf8(&(value.primitive.wcharValue), 1, chars));
+}
+
+uint32_t private_string_hash(struct gvalue_value value) {
+	return gvalue_hashString(value.primitive.stringValue);
+}
+
+int private_string_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return strcmp(value1.primitive.stringValue, value2.primitive.stringValue);
+}
+
+bool private_string_free(struct gvalue_value value) {
+	if (value.primitive.stringValue != NULL) {
+		free(value.primitive.stringValue);
+		return true;
+	}
+	return false;
+}
+
+void private_string_fprint(struct gvalue_value value, FILE *stream) {
+	fputs(value.primitive.stringValue, stream);
+}
+
+char *private_string_allocString(struct gvalue_value value) {
+	return private_allocStringToString(value.primitive.stringValue);
+}
+
+size_t private_string_format(struct gvalue_value value, char *buffer, size_t length) {
+	return private_gvalue_append(buffer, length, 0, value.primitive.stringValue, strlen(value.primitive.stringValue));
+}
+
+uint32_t private_wstring_hash(struct gvalue_value value) {
+	return gvalue_hashWString(value.primitive.wstringValue);
+}
+
+int private_wstring_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return wcscmp(value1.primitive.wstringValue, value2.primitive.wstringValue);
+}
+
+bool private_wstring_free(struct gvalue_value value) {
+	if (value.primitive.wstringValue != NULL) {
+		free(value.primitive.wstringValue);
+		return true;
+	}
+	return false;
+}
+
+// Encodes the first characters of source, at most PRIVATE_GVALUE_WSTRING_CHUNK plus the rest of a
+// surrogate pair, into out. Returns the number of characters taken and sets the number of bytes.
+size_t private_wstring_encodeChunk(const wchar_t *source, size_t count, char *out, size_t *outLength) {
+	size_t taken = (count < PRIVATE_GVALUE_WSTRING_CHUNK) ? count : PRIVATE_GVALUE_WSTRING_CHUNK;
+	if (taken < count && source[taken - 1] >= 0xD800 && source[taken - 1] <= 0xDBFF) {
+		taken++;
+	}
+	*outLength = gvalue_encodeUtf8(source, taken, out);
+	return taken;
+}
+
+// Written as UTF-8 bytes rather than with fputws, which would make the stream wide-oriented and
+// break every byte-oriented write after it.
+void private_wstring_fprint(struct gvalue_value value, FILE *stream) {
+	char chars[(PRIVATE_GVALUE_WSTRING_CHUNK + 1) * GVALUE_UTF8_MAX_BYTES_PER_WCHAR];
+	const wchar_t *source = value.primitive.wstringValue;
+	size_t count = wcslen(source);
+
+	while (count > 0) {
+		size_t length;
+		size_t taken = private_wstring_encodeChunk(source, count, chars, &length);
+		fwrite(chars, 1, length, stream);
+		source += taken;
+		count -= taken;
+	}
+}
+
+char *private_wstring_allocString(struct gvalue_value value) {
+	return private_allocWStringToString(value.primitive.wstringValue);
+}
+
+size_t private_wstring_format(struct gvalue_value value, char *buffer, size_t length) {
+	char chars[(PRIVATE_GVALUE_WSTRING_CHUNK + 1) * GVALUE_UTF8_MAX_BYTES_PER_WCHAR];
+	const wchar_t *source = value.primitive.wstringValue;
+	size_t count = wcslen(source);
+	size_t at = 0;
+
+	if (length > 0) {
+		buffer[0] = '\0';
+	}
+	while (count > 0) {
+		size_t chunkLength;
+		size_t taken = private_wstring_encodeChunk(source, count, chars, &chunkLength);
+		at = private_gvalue_append(buffer, length, at, chars, chunkLength);
+		source += taken;
+		count -= taken;
+	}
+	return at;
+}
+
+uint32_t private_istring_hash(struct gvalue_value value) {
+	return (value.primitive.stringValue == NULL) ? 0 : private_gvalue_istringHashCode(value.primitive.stringValue);
+}
+
+// Equal interned strings share one address, so the address alone decides. The order is arbitrary
+// but stable. Strings from different pools are never equal.
+int private_istring_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return (value1.primitive.stringValue < value2.primitive.stringValue) ? -1 : (value1.primitive.stringValue == value2.primitive.stringValue) ? 0 : 1;
+}
+
+void private_istring_fprint(struct gvalue_value value, FILE *stream) {
+	fputs(value.primitive.stringValue, stream);
+}
+
+char *private_istring_allocString(struct gvalue_value value) {
+	return private_allocStringToString(value.primitive.stringValue);
+}
+
+size_t private_istring_format(struct gvalue_value value, char *buffer, size_t length) {
+	return private_gvalue_append(buffer, length, 0, value.primitive.stringValue, strlen(value.primitive.stringValue));
+}
+
+uint32_t private_sstring_hash(struct gvalue_value value) {
+	return gvalue_hashString(gvalue_stringChars(&value));
+}
+
+int private_sstring_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	return strcmp(gvalue_stringChars(&value1), gvalue_stringChars(&value2));
+}
+
+// Only long short strings have something to free.
+bool private_sstring_free(struct gvalue_value value) {
+	if (value.primitive.sstringValue[GVALUE_SSTRING_CAPACITY] == GVALUE_SSTRING_POINTER_TAG
+			&& value.primitive.stringValue != NULL) {
+		free(value.primitive.stringValue);
+		return true;
+	}
+	return false;
+}
+
+void private_sstring_fprint(struct gvalue_value value, FILE *stream) {
+	fputs(gvalue_stringChars(&value), stream);
+}
+
+char *private_sstring_allocString(struct gvalue_value value) {
+	return private_allocStringToString(gvalue_stringChars(&value));
+}
+
+size_t private_sstring_format(struct gvalue_value value, char *buffer, size_t length) {
+	char *chars = gvalue_stringChars(&value);
+	return private_gvalue_append(buffer, length, 0, chars, strlen(chars));
+}
+
+uint32_t private_bytes_hash(struct gvalue_value value) {
+	return gvalue_hashBytes(value.primitive.bytesValue.data, value.primitive.bytesValue.length);
+}
+
+// Shorter slices sort first, so that most unequal slices are told apart without reading them.
+int private_bytes_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	if (value1.primitive.bytesValue.length != value2.primitive.bytesValue.length) {
+		return (value1.primitive.bytesValue.length < value2.primitive.bytesValue.length) ? -1 : 1;
+	}
+	if (value1.primitive.bytesValue.length == 0) {
+		return 0;
+	}
+	return memcmp(value1.primitive.bytesValue.data, value2.primitive.bytesValue.data, value1.primitive.bytesValue.length);
+}
+
+bool private_bytes_free(struct gvalue_value value) {
+	if (value.primitive.bytesValue.data != NULL) {
+		free((void *) value.primitive.bytesValue.data);
+		return true;
+	}
+	return false;
+}
+
+void private_bytes_fprint(struct gvalue_value value, FILE *stream) {
+	private_gvalue_fprintBytes(value.primitive.bytesValue, stream);
+}
+
+char *private_bytes_allocString(struct gvalue_value value) {
+	return private_allocBytesToString(value.primitive.bytesValue);
+}
+
+// Same escaping as gvalue_fprint.
+size_t private_bytes_format(struct gvalue_value value, char *buffer, size_t length) {
+	static const char hexDigits[] = "0123456789ABCDEF";
+	size_t at = 0;
+
+	for (size_t i = 0; i < value.primitive.bytesValue.length; i++) {
+		unsigned char c = value.primitive.bytesValue.data[i];
+		if (c >= 0x20 && c < 0x7F && c != '\\') {
+			at = private_gvalue_append(buffer, length, at, (const char *) &c, 1);
+		}
+		else {
+			char escape[4] = { '\\', 'x', hexDigits[c >> 4], hexDigits[c & 15] };
+			at = private_gvalue_append(buffer, length, at, escape, 4);
+		}
+	}
+
+	if (at == 0 && length > 0) {
+		buffer[0] = '\0';
+	}
+	return at;
+}
+
+/*******************************************************************************************/
+
+// Type constants.
+
+const struct gvalue_type private_bool_type = {
+		.code = GVALUE_TYPE_BOOL, .name = "bool", .cTypeName = "bool", .size = sizeof(bool),
+		.hash = private_bool_hash, .cmp = private_bool_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_bool_format
+};
+
+const struct gvalue_type private_byte_type = {
+		.code = GVALUE_TYPE_BYTE, .name = "byte", .cTypeName = "int8_t", .size = sizeof(int8_t),
+		.hash = private_byte_hash, .cmp = private_byte_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_byte_format
+};
+
+const struct gvalue_type private_short_type = {
+		.code = GVALUE_TYPE_SHORT, .name = "short", .cTypeName = "int16_t", .size = sizeof(int16_t),
+		.hash = private_short_hash, .cmp = private_short_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_short_format
+};
+
+const struct gvalue_type private_int_type = {
+		.code = GVALUE_TYPE_INT, .name = "int", .cTypeName = "int32_t", .size = sizeof(int32_t),
+		.hash = private_int_hash, .cmp = private_int_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_int_format
+};
+
+const struct gvalue_type private_long_type = {
+		.code = GVALUE_TYPE_LONG, .name = "long", .cTypeName = "int64_t", .size = sizeof(int64_t),
+		.hash = private_long_hash, .cmp = private_long_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_long_format
+};
+
+const struct gvalue_type private_ubyte_type = {
+		.code = GVALUE_TYPE_UBYTE, .name = "ubyte", .cTypeName = "uint8_t", .size = sizeof(uint8_t),
+		.hash = private_ubyte_hash, .cmp = private_ubyte_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_ubyte_format
+};
+
+const struct gvalue_type private_ushort_type = {
+		.code = GVALUE_TYPE_USHORT, .name = "ushort", .cTypeName = "uint16_t", .size = sizeof(uint16_t),
+		.hash = private_ushort_hash, .cmp = private_ushort_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_ushort_format
+};
+
+const struct gvalue_type private_uint_type = {
+		.code = GVALUE_TYPE_UINT, .name = "uint", .cTypeName = "uint32_t", .size = sizeof(uint32_t),
+		.hash = private_uint_hash, .cmp = private_uint_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_uint_format
+};
+
+const struct gvalue_type private_ulong_type = {
+		.code = GVALUE_TYPE_ULONG, .name = "ulong", .cTypeName = "uint64_t", .size = sizeof(uint64_t),
+		.hash = private_ulong_hash, .cmp = private_ulong_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_ulong_format
+};
+
+const struct gvalue_type private_float_type = {
+		.code = GVALUE_TYPE_FLOAT, .name = "float", .cTypeName = "float", .size = sizeof(float),
+		.hash = private_float_hash, .cmp = private_float_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_float_format
+};
+
+const struct gvalue_type private_double_type = {
+		.code = GVALUE_TYPE_DOUBLE, .name = "double", .cTypeName = "double", .size = sizeof(double),
+		.hash = private_double_hash, .cmp = private_double_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_double_format
+};
+
+const struct gvalue_type private_pointer_type = {
+		.code = GVALUE_TYPE_POINTER, .name = "pointer", .cTypeName = "void *", .size = sizeof(void *),
+		.hash = private_pointer_hash, .cmp = private_pointer_cmp, .free = private_pointer_free,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_pointer_format
+};
+
+const struct gvalue_type private_char_type = {
+		.code = GVALUE_TYPE_CHAR, .name = "char", .cTypeName = "char", .size = sizeof(char),
+		.hash = private_char_hash, .cmp = private_char_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_gvalue_fprintFormatted, .allocString = private_gvalue_allocFormatted,
+		.format = private_char_format
+};
+
+const struct gvalue_type private_wchar_type = {
+		.code = GVALUE_TYPE_WCHAR, .name = "wchar", .cTypeName = "wchar_t", .size = sizeof(wchar_t),
+		.hash = private_wchar_hash, .cmp = private_wchar_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_wchar_fprint, .allocString = private_wchar_allocString,
+		.format = private_wchar_format
+};
+
+const struct gvalue_type private_string_type = {
+		.code = GVALUE_TYPE_STRING, .name = "string", .cTypeName = "char *", .size = sizeof(char *),
+		.hash = private_string_hash, .cmp = private_string_cmp, .free = private_string_free,
+		.fprint = private_string_fprint, .allocString = private_string_allocString,
+		.format = private_string_format
+};
+
+const struct gvalue_type private_wstring_type = {
+		.code = GVALUE_TYPE_WSTRING, .name = "wstring", .cTypeName = "wchar_t *", .size = sizeof(wchar_t *),
+		.hash = private_wstring_hash, .cmp = private_wstring_cmp, .free = private_wstring_free,
+		.fprint = private_wstring_fprint, .allocString = private_wstring_allocString,
+		.format = private_wstring_format
+};
+
+// The characters are owned by the intern pool, so there is nothing to free.
+const struct gvalue_type private_istring_type = {
+		.code = GVALUE_TYPE_ISTRING, .name = "istring", .cTypeName = "char *", .size = sizeof(char *),
+		.hash = private_istring_hash, .cmp = private_istring_cmp, .free = private_gvalue_freeNothing,
+		.fprint = private_istring_fprint, .allocString = private_istring_allocString,
+		.format = private_istring_format
+};
+
+const struct gvalue_type private_sstring_type = {
+		.code = GVALUE_TYPE_SSTRING, .name = "sstring", .cTypeName = "char *", .size = GVALUE_SSTRING_CAPACITY + 1,
+		.hash = private_sstring_hash, .cmp = private_sstring_cmp, .free = private_sstring_free,
+		.fprint = private_sstring_fprint, .allocString = private_sstring_allocString,
+		.format = private_sstring_format
+};
+
+const struct gvalue_type private_bytes_type = {
+		.code = GVALUE_TYPE_BYTES, .name = "bytes", .cTypeName = "struct gvalue_bytes", .size = sizeof(struct gvalue_bytes),
+		.hash = private_bytes_hash, .cmp = private_bytes_cmp, .free = private_bytes_free,
+		.fprint = private_bytes_fprint, .allocString = private_bytes_allocString,
+		.format = private_bytes_format
+};
+
+/*******************************************************************************************/
+
+// Registered types.
+
+// Registered types get codes from GVALUE_TYPES_COUNT on, in the order of registration. These codes
+// are only meaningful within the current process.
+const struct gvalue_type **private_gvalue_registeredTypes = NULL;
+int private_gvalue_registeredCount = 0;
+int private_gvalue_registeredCapacity = 0;
+
+// Layout of a tuple type. Fields are packed back to back without padding and always read and written
+// with memcpy, so that as many tuples as possible fit into GVALUE_INLINE_CAPACITY.
+struct private_gvalue_tuple_type {
+	struct gvalue_type type;
+	int count;
+	const struct gvalue_type *fieldTypes[GVALUE_TUPLE_MAX_FIELDS];
+	size_t offsets[GVALUE_TUPLE_MAX_FIELDS];
+	char name[GVALUE_BUFFER_SIZE];
+};
+
+void private_gvalue_addRegisteredType(struct gvalue_type *type) {
+	if (private_gvalue_registeredCount == private_gvalue_registeredCapacity) {
+		private_gvalue_registeredCapacity = (private_gvalue_registeredCapacity == 0) ? 8 : private_gvalue_registeredCapacity * 2;
+		private_gvalue_registeredTypes = realloc(private_gvalue_registeredTypes,
+				sizeof(struct gvalue_type *) * private_gvalue_registeredCapacity);
+	}
+
+	type->code = GVALUE_TYPES_COUNT + private_gvalue_registeredCount;
+	private_gvalue_registeredTypes[private_gvalue_registeredCount++] = type;
+}
+
+// Returns NULL if the code does not belong to a registered type.
+const struct gvalue_type *private_gvalue_registeredType(int code) {
+	if (code < GVALUE_TYPES_COUNT || code >= GVALUE_TYPES_COUNT + private_gvalue_registeredCount) {
+		return NULL;
+	}
+	return private_gvalue_registeredTypes[code - GVALUE_TYPES_COUNT];
+}
+
+void private_gvalue_fprintName(struct gvalue_value value, FILE *stream) {
+	fprintf(stream, "(%s)", value.type->name);
+}
+
+char *private_gvalue_allocName(struct gvalue_value value) {
+	char buffer[GVALUE_BUFFER_SIZE];
+	snprintf(buffer, sizeof(buffer), "(%s)", value.type->name);
+	return private_allocStringToString(buffer);
+}
+
+size_t private_gvalue_formatAllocated(struct gvalue_value value, char *buffer, size_t length) {
+	char *string = value.type->allocString(value);
+	size_t count = private_gvalue_append(buffer, length, 0, string, strlen(string));
+	free(string);
+	return count;
+}
+
+// Registers a type with the given name, size and operations, and returns the constant to use for its
+// values. The code is assigned here, so the one in the given type is ignored. hash and cmp are
+// required. Without free, values own nothing. Without fprint and allocString, values print as the
+// type name. Without format, values are formatted through allocString. The returned type stays valid
+// until gvalue_freeRegisteredTypes.
+const struct gvalue_type *gvalue_registerType(struct gvalue_type type) {
+	if (type.name == NULL || type.hash == NULL || type.cmp == NULL) {
+		printf("Error: gvalue: A registered type needs a name, hash and cmp\n");
+		return NULL;
+	}
+
+	struct gvalue_type *registered = malloc(sizeof(struct gvalue_type));
+	*registered = type;
+
+	if (registered->cTypeName == NULL) {
+		registered->cTypeName = "void *";
+	}
+	if (registered->free == NULL) {
+		registered->free = private_gvalue_freeNothing;
+	}
+	if (registered->fprint == NULL) {
+		registered->fprint = private_gvalue_fprintName;
+	}
+	if (registered->allocString == NULL) {
+		registered->allocString = private_gvalue_allocName;
+	}
+	if (registered->format == NULL) {
+		registered->format = private_gvalue_formatAllocated;
+	}
+
+	private_gvalue_addRegisteredType(registered);
+	return registered;
+}
+
+// Data of up to GVALUE_INLINE_CAPACITY bytes is copied into the value, so no allocation is needed and
+// the given data can go away. Larger data is referenced by its pointer and must stay alive, and the
+// type's free decides whether it is owned by the value.
+struct gvalue_value gvalue_getCustom(const struct gvalue_type *type, const void *data) {
+	struct gvalue_value value = { .type = type };
+
+	if (type->size <= GVALUE_INLINE_CAPACITY) {
+		memcpy(value.primitive.inlineValue, data, type->size);
+	}
+	else {
+		value.primitive.pointerValue = (void *) data;
+	}
+
+	return value;
+}
+
+// Data of a value of a registered type. For inline data, the result points into the given value and is
+// only valid as long as the value is.
+const void *gvalue_customData(const struct gvalue_value *value) {
+	if (value->type->size <= GVALUE_INLINE_CAPACITY) {
+		return value->primitive.inlineValue;
+	}
+	return value->primitive.pointerValue;
+}
+
+void gvalue_freeRegisteredTypes(void) {
+	for (int i = 0; i < private_gvalue_registeredCount; i++) {
+		free((void *) private_gvalue_registeredTypes[i]);
+	}
+
+	free(private_gvalue_registeredTypes);
+	private_gvalue_registeredTypes = NULL;
+	private_gvalue_registeredCount = 0;
+	private_gvalue_registeredCapacity = 0;
+}
+
+/*******************************************************************************************/
+
+// Tuples.
+
+struct gvalue_value private_gvalue_tupleFieldAt(const struct private_gvalue_tuple_type *tupleType, const unsigned char *data, int index) {
+	struct gvalue_value field = { .type = tupleType->fieldTypes[index] };
+	memcpy(&(field.primitive), data + tupleType->offsets[index], field.type->size);
+	return field;
+}
+
+// Field hashes are chained through the 64-bit mixer, so that swapping two fields changes the hash.
+uint32_t private_tuple_hash(struct gvalue_value value) {
+	const struct private_gvalue_tuple_type *tupleType = value.type->context;
+	const unsigned char *data = gvalue_customData(&value);
+	uint32_t hashCode = (uint32_t) tupleType->count;
+
+	for (int i = 0; i < tupleType->count; i++) {
+		struct gvalue_value field = private_gvalue_tupleFieldAt(tupleType, data, i);
+		hashCode = gvalue_hashLong(((uint64_t) hashCode << 32) | field.type->hash(field));
+	}
+
+	return hashCode;
+}
+
+int private_tuple_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	const struct private_gvalue_tuple_type *tupleType = value1.type->context;
+	const unsigned char *data1 = gvalue_customData(&value1);
+	const unsigned char *data2 = gvalue_customData(&value2);
+
+	for (int i = 0; i < tupleType->count; i++) {
+		struct gvalue_value field1 = private_gvalue_tupleFieldAt(tupleType, data1, i);
+		struct gvalue_value field2 = private_gvalue_tupleFieldAt(tupleType, data2, i);
+		int result = field1.type->cmp(field1, field2);
+		if (result != 0) {
+			return result;
+		}
+	}
+
+	return 0;
+}
+
+// Only the storage of tuples that did not fit into the value is freed, never the fields.
+bool private_tuple_free(struct gvalue_value value) {
+	if (value.type->size > GVALUE_INLINE_CAPACITY && value.primitive.pointerValue != NULL) {
+		free(value.primitive.pointerValue);
+		return true;
+	}
+	return false;
+}
+
+void private_tuple_fprint(struct gvalue_value value, FILE *stream) {
+	const struct private_gvalue_tuple_type *tupleType = value.type->context;
+	const unsigned char *data = gvalue_customData(&value);
+
+	fputc('(', stream);
+	for (int i = 0; i < tupleType->count; i++) {
+		if (i > 0) {
+			fputs(", ", stream);
+		}
+		struct gvalue_value field = private_gvalue_tupleFieldAt(tupleType, data, i);
+		field.type->fprint(field, stream);
+	}
+	fputc(')', stream);
+}
+
+size_t private_tuple_format(struct gvalue_value value, char *buffer, size_t length) {
+	const struct private_gvalue_tuple_type *tupleType = value.type->context;
+	const unsigned char *data = gvalue_customData(&value);
+	size_t at = private_gvalue_append(buffer, length, 0, "(", 1);
+
+	for (int i = 0; i < tupleType->count; i++) {
+		if (i > 0) {
+			at = private_gvalue_append(buffer, length, at, ", ", 2);
+		}
+		struct gvalue_value field = private_gvalue_tupleFieldAt(tupleType, data, i);
+		at += field.type->format(field, (at < length) ? buffer + at : NULL, (at < length) ? length - at : 0);
+	}
+
+	return private_gvalue_append(buffer, length, at, ")", 1);
+}
+
+char *private_tuple_allocString(struct gvalue_value value) {
+	const struct private_gvalue_tuple_type *tupleType = value.type->context;
+	const unsigned char *data = gvalue_customData(&value);
+	char *fieldStrings[GVALUE_TUPLE_MAX_FIELDS];
+	size_t length = 2;
+
+	for (int i = 0; i < tupleType->count; i++) {
+		struct gvalue_value field = private_gvalue_tupleFieldAt(tupleType, data, i);
+		fieldStrings[i] = field.type->allocString(field);
+		length += strlen(fieldStrings[i]) + 2;
+	}
+
+	char *string = malloc(length + 1);
+	strcpy(string, "(");
+	for (int i = 0; i < tupleType->count; i++) {
+		if (i > 0) {
+			strcat(string, ", ");
+		}
+		strcat(string, fieldStrings[i]);
+		free(fieldStrings[i]);
+	}
+	strcat(string, ")");
+
+	return string;
+}
+
+// Returns the tuple type with the given field types, creating it on first use. Asking again for the
+// same field types returns the same type, so that it can be used as the keyType of a gmap or gset.
+// Fields can be of any type of at most GVALUE_INLINE_CAPACITY bytes, which includes all built-in ones.
+// Returns NULL if the number of fields is outside GVALUE_TUPLE_MIN_FIELDS to GVALUE_TUPLE_MAX_FIELDS.
+const struct gvalue_type *gvalue_getTupleType(int count, const struct gvalue_type *const *fieldTypes) {
+	if (count < GVALUE_TUPLE_MIN_FIELDS || count > GVALUE_TUPLE_MAX_FIELDS) {
+		printf("Error: gvalue: A tuple needs %d to %d fields\n", GVALUE_TUPLE_MIN_FIELDS, GVALUE_TUPLE_MAX_FIELDS);
+		return NULL;
+	}
+
+	for (int i = 0; i < count; i++) {
+		if (fieldTypes[i] == NULL || fieldTypes[i]->size > GVALUE_INLINE_CAPACITY) {
+			printf("Error: gvalue: Tuple field %d has no type or is too large\n", i);
+			return NULL;
+		}
+	}
+
+	for (int t = 0; t < private_gvalue_registeredCount; t++) {
+		const struct gvalue_type *type = private_gvalue_registeredTypes[t];
+		if (type->hash != private_tuple_hash) {
+			continue;
+		}
+
+		const struct private_gvalue_tuple_type *tupleType = type->context;
+		if (tupleType->count == count && memcmp(tupleType->fieldTypes, fieldTypes, sizeof(struct gvalue_type *) * count) == 0) {
+			return type;
+		}
+	}
+
+	struct private_gvalue_tuple_type *tupleType = calloc(1, sizeof(struct private_gvalue_tuple_type));
+	size_t size = 0;
+	int nameLength = snprintf(tupleType->name, sizeof(tupleType->name), "tuple");
+
+	tupleType->count = count;
+	for (int i = 0; i < count; i++) {
+		tupleType->fieldTypes[i] = fieldTypes[i];
+		tupleType->offsets[i] = size;
+		size += fieldTypes[i]->size;
+
+		if (nameLength < (int) sizeof(tupleType->name)) {
+			nameLength += snprintf(tupleType->name + nameLength, sizeof(tupleType->name) - nameLength,
+					(i == 0) ? "(%s" : ", %s", fieldTypes[i]->name);
+		}
+	}
+	if (nameLength < (int) sizeof(tupleType->name)) {
+		snprintf(tupleType->name + nameLength, sizeof(tupleType->name) - nameLength, ")");
+	}
+
+	tupleType->type = (struct gvalue_type) {
+			.name = tupleType->name, .cTypeName = "unsigned char[]", .size = size, .context = tupleType,
+			.hash = private_tuple_hash, .cmp = private_tuple_cmp, .free = private_tuple_free,
+			.fprint = private_tuple_fprint, .allocString = private_tuple_allocString, .format = private_tuple_format
+	};
+
+	// The type is the first member, so freeing it frees the whole layout.
+	private_gvalue_addRegisteredType(&(tupleType->type));
+	return &(tupleType->type);
+}
+
+// Builds a tuple from as many fields as the tuple type has, which must be of the field types in the
+// same order. Tuples of up to GVALUE_INLINE_CAPACITY bytes, like two longs or (int, int, istring), are
+// stored inside the value. Larger ones are copied to the heap and must be released with gvalue_free,
+// e.g. by putting them into a gmap with freeKey set.
+// Returns a value with a NULL type, and allocates nothing, if a field is of the wrong type.
+struct gvalue_value gvalue_getTuple(const struct gvalue_type *tupleType, const struct gvalue_value *fields) {
+	const struct private_gvalue_tuple_type *layout = tupleType->context;
+	struct gvalue_value value = { .type = NULL };
+
+	for (int i = 0; i < layout->count; i++) {
+		if (fields[i].type != layout->fieldTypes[i]) {
+			printf("Error: gvalue: Tuple field %d should be %s instead of %s\n", i, layout->fieldTypes[i]->name, fields[i].type->name);
+			return value;
+		}
+	}
+
+	value.type = tupleType;
+	unsigned char *data = value.primitive.inlineValue;
+
+	if (tupleType->size > GVALUE_INLINE_CAPACITY) {
+		data = malloc(tupleType->size);
+		value.primitive.pointerValue = data;
+	}
+
+	for (int i = 0; i < layout->count; i++) {
+		memcpy(data + layout->offsets[i], &(fields[i].primitive), layout->fieldTypes[i]->size);
+	}
+
+	return value;
+}
+
+// Returns a copy of the field at the given index, which must be less than the number of fields.
+struct gvalue_value gvalue_tupleField(struct gvalue_value tuple, int index) {
+	return private_gvalue_tupleFieldAt(tuple.type->context, gvalue_customData(&tuple), index);
+}
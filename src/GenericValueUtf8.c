@@ -0,0 +1,359 @@
+/**
+ * UTF-8 transcoding of wide strings.
+ *
+ * wchar_t holds UTF-32 where it is 32 bits wide, and UTF-16 where it is 16 bits wide (Windows).
+ * Runs of ASCII, which is most text in practice, go through a fast path that converts 16 characters
+ * at a time with SSE2, or 8 at a time with plain 64-bit words on other targets. Everything else is
+ * converted one code point at a time. Malformed input, like lone surrogates or invalid UTF-8 sequences,
+ * becomes U+FFFD instead of being truncated.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRIVATE_GVALUE_UTF8_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "GenericValue.h"
+
+#if WCHAR_MAX > 0xFFFF
+#define PRIVATE_GVALUE_WCHAR_UTF32
+#endif
+
+#define PRIVATE_GVALUE_REPLACEMENT_CHARACTER 0xFFFD
+
+// ASCII characters in a row after which the block fast path is tried again. In text that mixes in
+// many other characters, trying it after every one of them costs more than it saves.
+#define PRIVATE_GVALUE_ASCII_RUN 8
+
+/*******************************************************************************************/
+
+// ASCII fast paths.
+
+// Widens the leading ASCII bytes of source and returns how many were done. Stops at the first block
+// that contains anything else, so the caller finishes the rest of that block itself.
+size_t private_gvalue_widenAscii(const unsigned char *source, size_t length, wchar_t *out) {
+	size_t i = 0;
+
+#ifdef PRIVATE_GVALUE_UTF8_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	while (i + 16 <= length) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *) (source + i));
+		if (_mm_movemask_epi8(bytes) != 0) {
+			break;
+		}
+
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i high = _mm_unpackhi_epi8(bytes, zero);
+#ifdef PRIVATE_GVALUE_WCHAR_UTF32
+		_mm_storeu_si128((__m128i *) (out + i), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128((__m128i *) (out + i + 4), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128((__m128i *) (out + i + 8), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128((__m128i *) (out + i + 12), _mm_unpackhi_epi16(high, zero));
+#else
+		_mm_storeu_si128((__m128i *) (out + i), low);
+		_mm_storeu_si128((__m128i *) (out + i + 8), high);
+#endif
+		i += 16;
+	}
+#endif
+
+	while (i + 8 <= length) {
+		uint64_t word;
+		memcpy(&word, source + i, sizeof(word));
+		if ((word & UINT64_C(0x8080808080808080)) != 0) {
+			break;
+		}
+		for (int k = 0; k < 8; k++) {
+			out[i + k] = (wchar_t) source[i + k];
+		}
+		i += 8;
+	}
+
+	return i;
+}
+
+// Narrows the leading ASCII characters of source and returns how many were done, like
+// private_gvalue_widenAscii.
+size_t private_gvalue_narrowAscii(const wchar_t *source, size_t count, unsigned char *out) {
+	size_t i = 0;
+
+#ifdef PRIVATE_GVALUE_UTF8_SSE2
+	const __m128i zero = _mm_setzero_si128();
+#ifdef PRIVATE_GVALUE_WCHAR_UTF32
+	const __m128i nonAscii = _mm_set1_epi32(~0x7F);
+	while (i + 16 <= count) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (source + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (source + i + 4));
+		__m128i c = _mm_loadu_si128((const __m128i *) (source + i + 8));
+		__m128i d = _mm_loadu_si128((const __m128i *) (source + i + 12));
+		__m128i any = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, zero)) != 0xFFFF) {
+			break;
+		}
+
+		// All lanes are below 0x80, so the saturating packs just drop the zero bytes.
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+		_mm_storeu_si128((__m128i *) (out + i), bytes);
+		i += 16;
+	}
+#else
+	const __m128i nonAscii = _mm_set1_epi16((short) ~0x7F);
+	while (i + 16 <= count) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (source + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (source + i + 8));
+		__m128i any = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(any, zero)) != 0xFFFF) {
+			break;
+		}
+
+		_mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(a, b));
+		i += 16;
+	}
+#endif
+#endif
+
+	while (i + 4 <= count) {
+		uint32_t any = (uint32_t) source[i] | (uint32_t) source[i + 1] | (uint32_t) source[i + 2]
+				| (uint32_t) source[i + 3];
+		if (any > 0x7F) {
+			break;
+		}
+		for (int k = 0; k < 4; k++) {
+			out[i + k] = (unsigned char) source[i + k];
+		}
+		i += 4;
+	}
+
+	return i;
+}
+
+/*******************************************************************************************/
+
+// Single code points.
+
+// Decodes the sequence at the start of source and returns how many bytes it took. An invalid sequence
+// decodes to U+FFFD and takes only its longest valid prefix (at least one byte), so that decoding
+// resynchronizes on the next byte that could start a sequence.
+size_t private_gvalue_decodeSequence(const unsigned char *source, size_t length, uint32_t *outCodePoint) {
+	unsigned char lead = source[0];
+	unsigned char low = 0x80;
+	unsigned char high = 0xBF;
+	size_t needed;
+	uint32_t c;
+
+	if (lead < 0x80) {
+		*outCodePoint = lead;
+		return 1;
+	}
+	else if (lead >= 0xC2 && lead <= 0xDF) {
+		needed = 1;
+		c = lead & 0x1F;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF) {
+		needed = 2;
+		c = lead & 0x0F;
+		// No overlong forms and no surrogates.
+		if (lead == 0xE0) {
+			low = 0xA0;
+		}
+		else if (lead == 0xED) {
+			high = 0x9F;
+		}
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4) {
+		needed = 3;
+		c = lead & 0x07;
+		// No overlong forms and nothing above U+10FFFF.
+		if (lead == 0xF0) {
+			low = 0x90;
+		}
+		else if (lead == 0xF4) {
+			high = 0x8F;
+		}
+	}
+	else {
+		*outCodePoint = PRIVATE_GVALUE_REPLACEMENT_CHARACTER;
+		return 1;
+	}
+
+	for (size_t k = 1; k <= needed; k++) {
+		if (k >= length || source[k] < low || source[k] > high) {
+			*outCodePoint = PRIVATE_GVALUE_REPLACEMENT_CHARACTER;
+			return k;
+		}
+		c = (c << 6) | (source[k] & 0x3F);
+		low = 0x80;
+		high = 0xBF;
+	}
+
+	*outCodePoint = c;
+	return needed + 1;
+}
+
+// Writes a valid code point as one or two (a surrogate pair) wchar_t and returns how many.
+size_t private_gvalue_putCodePoint(uint32_t c, wchar_t *out) {
+#ifndef PRIVATE_GVALUE_WCHAR_UTF32
+	if (c >= 0x10000) {
+		c -= 0x10000;
+		out[0] = (wchar_t) (0xD800 + (c >> 10));
+		out[1] = (wchar_t) (0xDC00 + (c & 0x3FF));
+		return 2;
+	}
+#endif
+	out[0] = (wchar_t) c;
+	return 1;
+}
+
+// Writes a valid code point as UTF-8 and returns the number of bytes.
+size_t private_gvalue_encodeCodePoint(uint32_t c, unsigned char *out) {
+	if (c < 0x80) {
+		out[0] = (unsigned char) c;
+		return 1;
+	}
+	else if (c < 0x800) {
+		out[0] = (unsigned char) (0xC0 | (c >> 6));
+		out[1] = (unsigned char) (0x80 | (c & 0x3F));
+		return 2;
+	}
+	else if (c < 0x10000) {
+		out[0] = (unsigned char) (0xE0 | (c >> 12));
+		out[1] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+		out[2] = (unsigned char) (0x80 | (c & 0x3F));
+		return 3;
+	}
+	out[0] = (unsigned char) (0xF0 | (c >> 18));
+	out[1] = (unsigned char) (0x80 | ((c >> 12) & 0x3F));
+	out[2] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+	out[3] = (unsigned char) (0x80 | (c & 0x3F));
+	return 4;
+}
+
+/*******************************************************************************************/
+
+// Transcoding.
+
+size_t gvalue_encodeUtf8(const wchar_t *source, size_t count, char *out) {
+	unsigned char *bytes = (unsigned char *) out;
+	size_t i = 0;
+	size_t j = 0;
+
+	size_t asciiRun = PRIVATE_GVALUE_ASCII_RUN;
+
+	while (i < count) {
+		uint32_t c = (uint32_t) source[i++];
+		if (c < 0x80) {
+			bytes[j++] = (unsigned char) c;
+			if (++asciiRun >= PRIVATE_GVALUE_ASCII_RUN) {
+				size_t done = private_gvalue_narrowAscii(source + i, count - i, bytes + j);
+				i += done;
+				j += done;
+				asciiRun = 0;
+			}
+			continue;
+		}
+
+		asciiRun = 0;
+		// Two- and three-byte sequences, the usual case, without the call.
+		if (c < 0x800) {
+			bytes[j] = (unsigned char) (0xC0 | (c >> 6));
+			bytes[j + 1] = (unsigned char) (0x80 | (c & 0x3F));
+			j += 2;
+			continue;
+		}
+		if (c < 0xD800 || (c > 0xDFFF && c < 0x10000)) {
+			bytes[j] = (unsigned char) (0xE0 | (c >> 12));
+			bytes[j + 1] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+			bytes[j + 2] = (unsigned char) (0x80 | (c & 0x3F));
+			j += 3;
+			continue;
+		}
+
+#ifdef PRIVATE_GVALUE_WCHAR_UTF32
+		if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+			c = PRIVATE_GVALUE_REPLACEMENT_CHARACTER;
+		}
+#else
+		if (c >= 0xD800 && c <= 0xDBFF && i < count && source[i] >= 0xDC00 && source[i] <= 0xDFFF) {
+			c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t) source[i++] - 0xDC00);
+		}
+		else if (c >= 0xD800 && c <= 0xDFFF) {
+			c = PRIVATE_GVALUE_REPLACEMENT_CHARACTER;
+		}
+#endif
+		j += private_gvalue_encodeCodePoint(c, bytes + j);
+	}
+
+	return j;
+}
+
+size_t gvalue_decodeUtf8(const char *source, size_t length, wchar_t *out) {
+	const unsigned char *bytes = (const unsigned char *) source;
+	size_t i = 0;
+	size_t j = 0;
+
+	size_t asciiRun = PRIVATE_GVALUE_ASCII_RUN;
+
+	while (i < length) {
+		if (bytes[i] < 0x80) {
+			out[j++] = (wchar_t) bytes[i++];
+			if (++asciiRun >= PRIVATE_GVALUE_ASCII_RUN) {
+				size_t done = private_gvalue_widenAscii(bytes + i, length - i, out + j);
+				i += done;
+				j += done;
+				asciiRun = 0;
+			}
+			continue;
+		}
+
+		asciiRun = 0;
+		// Valid two- and three-byte sequences, the usual case, without the call. Overlong forms and
+		// surrogates fail the range checks and go the long way.
+		uint32_t c = bytes[i];
+		if (c >= 0xC2 && c <= 0xDF && i + 1 < length && (bytes[i + 1] & 0xC0) == 0x80) {
+			out[j++] = (wchar_t) (((c & 0x1F) << 6) | (bytes[i + 1] & 0x3F));
+			i += 2;
+			continue;
+		}
+		if (c >= 0xE0 && c <= 0xEF && i + 2 < length && (bytes[i + 1] & 0xC0) == 0x80 && (bytes[i + 2] & 0xC0) == 0x80) {
+			c = ((c & 0x0F) << 12) | ((uint32_t) (bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F);
+			if (c >= 0x800 && (c < 0xD800 || c > 0xDFFF)) {
+				out[j++] = (wchar_t) c;
+				i += 3;
+				continue;
+			}
+		}
+
+		i += private_gvalue_decodeSequence(bytes + i, length - i, &c);
+		j += private_gvalue_putCodePoint(c, out + j);
+	}
+
+	return j;
+}
+
+/*******************************************************************************************/
+
+// Allocating conversions, used by gvalue_getAllocStringValue and gvalue_getAllocWStringValue.
+
+char *private_allocWStringToString(wchar_t *s) {
+	size_t count = wcslen(s);
+	char *t = malloc(count * GVALUE_UTF8_MAX_BYTES_PER_WCHAR + 1);
+	size_t length = gvalue_encodeUtf8(s, count, t);
+	t[length] = '\0';
+
+	// Give back the room that was reserved for multi-byte sequences but not needed.
+	char *shrunk = realloc(t, length + 1);
+	return (shrunk != NULL) ? shrunk : t;
+}
+
+wchar_t *private_allocStringToWString(char *s) {
+	size_t length = strlen(s);
+	wchar_t *t = malloc(sizeof(wchar_t) * (length + 1));
+	size_t count = gvalue_decodeUtf8(s, length, t);
+	t[count] = L'\0';
+	return t;
+}
@@ -14,6 +14,7 @@ struct strmap_class strmap = {
 		// Constructors.
 		.create = strmap_create,
 		.create1 = strmap_create1,
+		.createIgnoreCase = strmap_createIgnoreCase,
 
 		// Basic operations.
 		.put = strmap_put,
@@ -68,6 +69,12 @@ struct strmap_map *strmap_create1(struct gmap_config config) {
 	return (struct strmap_map *) gmap_create1(config);
 }
 
+struct strmap_map *strmap_createIgnoreCase(void) {
+	struct gmap_config config = { .keyType = NULL, .restrictValueToType = NULL,
+			.hashFunc = gvalue_hashIgnoreCase, .cmpFunc = gvalue_cmpIgnoreCase };
+	return strmap_create1(config);
+}
+
 /*******************************************************************************************/
 
 
@@ -30,6 +30,7 @@ struct strmap_class {
 	// Constructors.
 	struct strmap_map *(*create)(void);
 	struct strmap_map *(*create1)(struct gmap_config config);
+	struct strmap_map *(*createIgnoreCase)(void);
 
 	// Basic operations.
 	bool (*put)(struct strmap_map *map, char *key, char *value);
@@ -64,6 +65,8 @@ extern struct strmap_class strmap;
 
 extern struct strmap_map *strmap_create(void);
 extern struct strmap_map *strmap_create1(struct gmap_config config);
+// Keys that differ only in the case of ASCII letters are the same key, like HTTP header names.
+extern struct strmap_map *strmap_createIgnoreCase(void);
 
 /*******************************************************************************************/
 
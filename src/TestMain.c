@@ -3,16 +3,22 @@
  */
 
 #include <assert.h>
+#include <ctype.h>
 #include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 
 #include "GenericMap.h"
 #include "IntMap.h"
 #include "StrMap.h"
 #include "GenericList.h"
 #include "GenericSet.h"
+#include "GenericDeque.h"
+#include "FileMap.h"
+#include "GenericMapWal.h"
 
 void print_gmap_keyvalue(struct gvalue_value key, struct gvalue_value value) {
 	printf("{");
@@ -37,7 +43,7 @@ void test_classIsComplete(void *classPointer, void *lastPointer) {
 	assert(lastPointer != NULL);
 	while (classPointer != lastPointer) {
 		assert(*((void **)classPointer) != NULL);
-		classPointer = (&classPointer)[1];
+		classPointer = ((void **) classPointer) + 1;
 	}
 }
 
@@ -186,10 +192,148 @@ void test_gmap_ordered(bool maintainInsertionOrder) {
 	printf("Done test_gmap_ordered %s\n\n", maintainInsertionOrder ? "true" : "false");
 }
 
+int test_gmap_scan_seen[1000];
+
+void test_gmap_scan_count(struct gvalue_value key, struct gvalue_value value) {
+	if (key.primitive.intValue < 1000) {
+		test_gmap_scan_seen[key.primitive.intValue]++;
+	}
+}
+
+void test_gmap_scan(void) {
+	puts("Start test_gmap_scan");
+
+	struct gmap_map *map = gmap.create(gvalue.intType);
+	for (int i = 0; i < 1000; i++) {
+		test_gmap_scan_seen[i] = 0;
+		gmap.put(map, gvalue.getInt(i), gvalue.getInt(i));
+	}
+
+	// Grow the map through several resizes and remove other entries in between calls.
+	uint32_t cursor = 0;
+	int calls = 0;
+	int extraKey = 1000;
+	do {
+		cursor = gmap.scan(map, cursor, 3, test_gmap_scan_count);
+		if (calls < 100) {
+			for (int i = 0; i < 50; i++) {
+				gmap.put(map, gvalue.getInt(extraKey++), gvalue.getInt(0));
+			}
+			gmap.remove(map, gvalue.getInt(extraKey - 25));
+		}
+		calls++;
+	}
+	while (cursor != 0);
+
+	printf("Scan calls: %i, final capacity: %u\n", calls, map->config.capacity);
+
+	for (int i = 0; i < 1000; i++) {
+		assert(test_gmap_scan_seen[i] >= 1);
+	}
+
+	gmap.free(map);
+
+	puts("Done test_gmap_scan\n");
+}
+
+void test_gmap_binary(void) {
+	puts("Start test_gmap_binary");
+
+	const char *path = "test_gmap_binary.bin";
+
+	struct gmap_config config = {
+			.keyType = gvalue.stringType,
+			.maintainInsertionOrder = true
+	};
+	struct gmap_map *map = gmap.create1(config);
+
+	gmap.put1(map, gvalue.getString(my_strdup("int")), gvalue.getInt(-42), true, false);
+	gmap.put(map, gvalue.getString("double"), gvalue.getDouble(3.25));
+	gmap.put(map, gvalue.getString("string"), gvalue.getString("hello"));
+	gmap.put(map, gvalue.getString("wstring"), gvalue.getWString(L"wide"));
+	gmap.put(map, gvalue.getString("ulong"), gvalue.getULong(UINT64_MAX));
+	gmap.put(map, gvalue.getString("empty"), gvalue.getString(""));
+
+	assert(gmap.saveBinary(map, path) == true);
+
+	struct gmap_map *loaded = gmap.loadBinary(path);
+	assert(loaded != NULL);
+	assert(loaded->size == map->size);
+	assert(loaded->config.maintainInsertionOrder == true);
+
+	struct gmap_iterator iter1 = gmap.iterator(map);
+	struct gmap_iterator iter2 = gmap.iterator(loaded);
+	while (gmap.next(&iter1)) {
+		assert(gmap.next(&iter2) == true);
+		assert(gvalue.cmp(iter1.key, iter2.key) == 0);
+		assert(gvalue.cmp(iter1.value, iter2.value) == 0);
+	}
+
+	printf("Loaded: ");
+	gmap.print(loaded);
+	puts("");
+
+	gmap.put1(loaded, gvalue.getString(my_strdup("new")), gvalue.getInt(1), true, false);
+	gmap.remove(loaded, gvalue.getString("string"));
+	gmap.free(loaded);
+	gmap.free(map);
+
+	// Any change to the file must be detected.
+	FILE *file = fopen(path, "r+b");
+	fseek(file, -3, SEEK_END);
+	fputc('!', file);
+	fclose(file);
+
+	printf("(Ignore this error) ");
+	assert(gmap.loadBinary(path) == NULL);
+
+	remove(path);
+
+	puts("Done test_gmap_binary\n");
+}
+
+void test_gmap_equals(void) {
+	struct gmap_config config = { .keyType = gvalue.intType, .maintainFingerprint = true };
+	struct gmap_map *map1 = gmap.create1(config);
+	config.maintainInsertionOrder = true;
+	struct gmap_map *map2 = gmap.create1(config);
+
+	// Same entries in a different order, with a detour through other values.
+	for (int i = 0; i < 100; i++) {
+		gmap.put(map1, gvalue.getInt(i), gvalue.getInt(i));
+		gmap.put(map2, gvalue.getInt(99 - i), gvalue.getInt(-1));
+	}
+	for (int i = 0; i < 100; i++) {
+		gmap.put(map2, gvalue.getInt(i), gvalue.getInt(i));
+	}
+	gmap.put(map2, gvalue.getInt(1000), gvalue.getInt(0));
+	gmap.remove(map2, gvalue.getInt(1000));
+
+	assert(map1->fingerprint == map2->fingerprint);
+	assert(gmap.equals(map1, map2) == true);
+
+	// Swapping two values keeps the size and the keys but changes the fingerprint.
+	gmap.put(map2, gvalue.getInt(1), gvalue.getInt(2));
+	gmap.put(map2, gvalue.getInt(2), gvalue.getInt(1));
+	assert(map1->fingerprint != map2->fingerprint);
+	assert(gmap.equals(map1, map2) == false);
+
+	gmap.clear(map1);
+	gmap.clear(map2);
+	assert(map2->fingerprint == 0);
+	assert(gmap.equals(map1, map2) == true);
+
+	gmap.free(map1);
+	gmap.free(map2);
+}
+
 void test_gmap(void) {
 	test_gmap_class_complete();
 	test_gmap_ordered(false);
 	test_gmap_ordered(true);
+	test_gmap_scan();
+	test_gmap_binary();
+	test_gmap_equals();
 }
 
 void print_intmap_keyvalue(int32_t key, int32_t value) {
@@ -304,6 +448,69 @@ void test_strmap(void) {
 	puts("Done test_strmap\n");
 }
 
+void test_ignoreCase(void) {
+	puts("Start test_ignoreCase");
+
+	struct strmap_map *headers = strmap.createIgnoreCase();
+	strmap.put(headers, "Content-Type", "text/plain");
+	strmap.put(headers, "content-type", "text/html");
+	assert(headers->gmap.size == 1);
+	assert(strcmp(strmap.get(headers, "CONTENT-TYPE"), "text/html") == 0);
+	assert(strmap.get(headers, "Content-Length") == NULL);
+	strmap.free(headers);
+
+	assert(gvalue.hashIgnoreCase(gvalue.getString("Host")) == gvalue.hashString("host"));
+	assert(gvalue.hashIgnoreCase(gvalue.getSString("Host")) == gvalue.hashIgnoreCase(gvalue.getString("hOST")));
+	assert(gvalue.cmpIgnoreCase(gvalue.getString("Host"), gvalue.getString("hosts")) < 0);
+	assert(gvalue.cmpIgnoreCase(gvalue.getString("B"), gvalue.getString("a")) > 0);
+	assert(gvalue.hashIgnoreCase(gvalue.getWString(L"X-Forwarded-For")) == gvalue.hashWString(L"x-forwarded-for"));
+	assert(gvalue.cmpIgnoreCase(gvalue.getWString(L"X-Forwarded-For"), gvalue.getWString(L"x-forwarded-FOR")) == 0);
+
+	// Random strings of letters, punctuation and UTF-8 bytes, long enough for several blocks and chunks.
+	char *s1 = malloc(700);
+	char *s2 = malloc(700);
+	char *lower1 = malloc(700);
+	char *lower2 = malloc(700);
+	srand(42);
+	for (int round = 0; round < 2000; round++) {
+		size_t length = (size_t) (rand() % 600);
+		for (size_t i = 0; i < length; i++) {
+			int r = rand() % 8;
+			s1[i] = (r == 0) ? (char) (0x80 + rand() % 0x80) : (r == 1) ? (char) ('@' + rand() % 32) : (char) ('a' + rand() % 26);
+			s2[i] = (s1[i] >= 'a' && s1[i] <= 'z' && rand() % 2 == 0) ? (char) (s1[i] - 32) : s1[i];
+			lower1[i] = (char) tolower((unsigned char) s1[i]);
+		}
+		s1[length] = s2[length] = lower1[length] = '\0';
+		assert(gvalue.hashIgnoreCase(gvalue.getString(s1)) == gvalue.hashIgnoreCase(gvalue.getString(s2)));
+		assert(gvalue.cmpIgnoreCase(gvalue.getString(s1), gvalue.getString(s2)) == 0);
+
+		// Ordered like strcmp on the lowercase strings.
+		if (length > 0) {
+			s2[rand() % length] = (char) ('0' + rand() % 75);
+		}
+		for (size_t i = 0; i <= length; i++) {
+			lower2[i] = (char) tolower((unsigned char) s2[i]);
+		}
+		int expected = strcmp(lower1, lower2);
+		int actual = gvalue.cmpIgnoreCase(gvalue.getString(s1), gvalue.getString(s2));
+		assert((expected < 0) == (actual < 0) && (expected > 0) == (actual > 0));
+	}
+	free(lower2);
+	free(lower1);
+	free(s2);
+	free(s1);
+
+	struct gmap_config config = { .keyType = gvalue.wstringType, .restrictValueToType = NULL,
+			.hashFunc = gvalue_hashIgnoreCase, .cmpFunc = gvalue_cmpIgnoreCase };
+	struct gmap_map *map = gmap.create1(config);
+	gmap.put1(map, gvalue.getWString(L"Example.COM"), gvalue.getInt(1), false, false);
+	assert(gmap.get(map, gvalue.getWString(L"example.com")) != NULL);
+	assert(gmap.get(map, gvalue.getWString(L"example.org")) == NULL);
+	gmap.free(map);
+
+	puts("Done test_ignoreCase\n");
+}
+
 void test_glist_print(struct gvalue_value v) {
 	printf("(%" PRIi32 ")", v.primitive.intValue);
 }
@@ -359,6 +566,614 @@ void test_glist(void) {
 	puts("Done test_glist\n");
 }
 
+int test_glist_cmpDescending(struct gvalue_value value1, struct gvalue_value value2) {
+	return gvalue.cmp(value2, value1);
+}
+
+void test_glist_assertSorted(struct glist_list *list, int (*cmp)(struct gvalue_value, struct gvalue_value)) {
+	for (uint32_t i = 1; i < list->size; i++) {
+		assert(cmp(list->nodes[i - 1].value, list->nodes[i].value) <= 0);
+	}
+}
+
+void test_glist_sort(void) {
+	puts("Start test_glist_sort");
+
+	uint32_t sizes[] = { 0, 1, 2, 23, 100, 255, 256, 1000, 5000 };
+	srand(7);
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		uint32_t size = sizes[s];
+		for (int pattern = 0; pattern < 4; pattern++) {
+			struct glist_list *longs = glist.create(gvalue.longType);
+			struct glist_list *bytes = glist.create(gvalue.ubyteType);
+			struct glist_list *doubles = glist.create(gvalue.doubleType);
+			struct glist_list *strings = glist.create(gvalue.stringType);
+			struct glist_list *sstrings = glist.create(gvalue.sstringType);
+			struct glist_list *wstrings = glist.create(gvalue.wstringType);
+
+			int64_t sum = 0;
+			for (uint32_t i = 0; i < size; i++) {
+				// Random, ascending, descending and all equal.
+				int64_t r = (pattern == 0) ? ((int64_t) rand() << 20) - ((int64_t) rand() << 10) + rand()
+						: (pattern == 1) ? (int64_t) i : (pattern == 2) ? -(int64_t) i : 42;
+				sum += r;
+
+				// freeOnRemove follows the value, so it can be checked after sorting.
+				glist.add1(longs, gvalue.getLong(r), false);
+				glist.add(bytes, gvalue.getUByte((uint8_t) r));
+				double d = (r % 17 == 0) ? NAN : (r % 13 == 0) ? -0.0 : (r % 11 == 0) ? -INFINITY : (double) r / 7;
+				glist.add(doubles, gvalue.getDouble(d));
+
+				char buffer[32];
+				sprintf(buffer, "key%" PRIi64 "%s", r % 1000, (r % 3 == 0) ? "" : "-suffix");
+				char *copy = malloc(strlen(buffer) + 1);
+				strcpy(copy, buffer);
+				glist.add1(strings, gvalue.getString(copy), true);
+				glist.add(sstrings, gvalue.getSString(buffer));
+			}
+			for (uint32_t i = 0; i < size && i < 300; i++) {
+				glist.add(wstrings, gvalue.getWString((i % 3 == 0) ? L"b" : (i % 3 == 1) ? L"a" : L"ab"));
+			}
+
+			glist.sort(longs);
+			glist.sort(bytes);
+			glist.sort(doubles);
+			glist.sort(strings);
+			glist.sort(sstrings);
+			glist.sort(wstrings);
+			test_glist_assertSorted(longs, gvalue.cmp);
+			test_glist_assertSorted(bytes, gvalue.cmp);
+			test_glist_assertSorted(doubles, gvalue.cmp);
+			test_glist_assertSorted(strings, gvalue.cmp);
+			test_glist_assertSorted(sstrings, gvalue.cmp);
+			test_glist_assertSorted(wstrings, gvalue.cmp);
+
+			for (uint32_t i = 0; i < size; i++) {
+				sum -= longs->nodes[i].value.primitive.longValue;
+				assert(strings->nodes[i].freeOnRemove == true);
+			}
+			assert(sum == 0);
+
+			glist.sortWith(longs, test_glist_cmpDescending);
+			test_glist_assertSorted(longs, test_glist_cmpDescending);
+			glist.sortWith(strings, test_glist_cmpDescending);
+			test_glist_assertSorted(strings, test_glist_cmpDescending);
+
+			glist.free(wstrings);
+			glist.free(sstrings);
+			glist.free(strings);
+			glist.free(doubles);
+			glist.free(bytes);
+			glist.free(longs);
+		}
+	}
+
+	// freeOnRemove moves with its value.
+	struct glist_list *list = glist.create(gvalue.intType);
+	for (int i = 0; i < 1000; i++) {
+		int value = (i * 7919) % 1000;
+		glist.add1(list, gvalue.getInt(value), value % 2 == 0);
+	}
+	glist.sort(list);
+	for (uint32_t i = 0; i < list->size; i++) {
+		assert(list->nodes[i].value.primitive.intValue == (int) i);
+		assert(list->nodes[i].freeOnRemove == (i % 2 == 0));
+	}
+	glist.free(list);
+
+	puts("Done test_glist_sort\n");
+}
+
+void test_glist_sorted(void) {
+	puts("Start test_glist_sorted");
+
+	struct glist_config config = { .dataType = gvalue.intType, .sorted = true };
+	struct glist_list *list = glist.create1(config);
+	uint32_t index;
+
+	assert(glist.lowerBound(list, gvalue.getInt(1)) == 0);
+	assert(glist.contains(list, gvalue.getInt(1)) == false);
+
+	// Values 0 to 499, those below 250 twice, added in a scrambled order.
+	for (int i = 0; i < 750; i++) {
+		int value = ((i * 7919) % 750) % 500;
+		glist.add1(list, gvalue.getInt(value), i % 2 == 0);
+	}
+	assert(list->size == 750);
+	test_glist_assertSorted(list, gvalue.cmp);
+
+	assert(glist.tryGetIndex(list, gvalue.getInt(0), &index) == true && index == 0);
+	assert(glist.tryGetLastIndex(list, gvalue.getInt(0), &index) == true && index == 1);
+	assert(glist.tryGetIndex(list, gvalue.getInt(499), &index) == true && index == 749);
+	assert(glist.contains(list, gvalue.getInt(500)) == false);
+	assert(glist.contains(list, gvalue.getInt(-1)) == false);
+	assert(glist.tryGetLastIndex(list, gvalue.getInt(-1), &index) == false);
+	assert(glist.lowerBound(list, gvalue.getInt(2)) == 4);
+	assert(glist.upperBound(list, gvalue.getInt(2)) == 6);
+	assert(glist.upperBound(list, gvalue.getInt(1000)) == 750);
+
+	assert(glist.remove(list, gvalue.getInt(2)) == true);
+	assert(glist.remove(list, gvalue.getInt(2)) == true);
+	assert(glist.remove(list, gvalue.getInt(2)) == false);
+	assert(list->size == 748);
+	test_glist_assertSorted(list, gvalue.cmp);
+
+	// The Eytzinger tree finds the same lower bounds, with keys for ints and values for strings.
+	struct glist_eytzinger *tree = glist.createEytzinger(list);
+	assert(tree->keys != NULL);
+	for (int value = -2; value < 503; value++) {
+		uint32_t expected = glist.lowerBound(list, gvalue.getInt(value));
+		assert(glist.eytzingerLowerBound(tree, gvalue.getInt(value)) == expected);
+		assert(glist.eytzingerSearch(tree, gvalue.getInt(value), &index) == glist.binarySearch(list, gvalue.getInt(value), &index));
+	}
+	glist.freeEytzinger(tree);
+	glist.free(list);
+
+	struct glist_config stringConfig = { .dataType = gvalue.sstringType, .sorted = true };
+	struct glist_list *strings = glist.create1(stringConfig);
+	char buffer[16];
+	for (int i = 0; i < 300; i += 3) {
+		sprintf(buffer, "k%d", i);
+		glist.add(strings, gvalue.getSString(buffer));
+	}
+	test_glist_assertSorted(strings, gvalue.cmp);
+
+	tree = glist.createEytzinger(strings);
+	assert(tree->values != NULL);
+	for (int i = 0; i < 300; i++) {
+		sprintf(buffer, "k%d", i);
+		struct gvalue_value value = gvalue.getSString(buffer);
+		assert(glist.eytzingerLowerBound(tree, value) == glist.lowerBound(strings, value));
+		assert(glist.eytzingerSearch(tree, value, &index) == (i % 3 == 0));
+		assert(glist.contains(strings, value) == (i % 3 == 0));
+	}
+	glist.freeEytzinger(tree);
+
+	struct glist_list empty = glist.getSlice(strings, 1, 0);
+	tree = glist.createEytzinger(&empty);
+	assert(glist.eytzingerLowerBound(tree, gvalue.getSString("k1")) == 0);
+	glist.freeEytzinger(tree);
+	glist.free(strings);
+
+	puts("Done test_glist_sorted\n");
+}
+
+bool test_glist_isOdd(struct gvalue_value value, void *context) {
+	(*(int *) context)++;
+	return value.primitive.intValue % 2 != 0;
+}
+
+void test_glist_removeBulk(void) {
+	puts("Start test_glist_removeBulk");
+
+	struct glist_list *list = glist.create(gvalue.stringType);
+	for (int i = 0; i < 100; i++) {
+		char *chars = malloc(8);
+		sprintf(chars, "%d", i % 10);
+		glist.add1(list, gvalue.getString(chars), true);
+	}
+
+	assert(glist.removeRange(list, 5, 4) == false);
+	printf("(Ignore this error) ");
+	assert(glist.removeRange(list, 90, 100) == false);
+	assert(glist.removeRange(list, 10, 19) == true);
+	assert(list->size == 90);
+	assert(strcmp(list->nodes[10].value.primitive.stringValue, "0") == 0);
+	assert(glist.removeRange(list, 89, 89) == true);
+	assert(list->size == 89);
+
+	// Each freed string is caught by ASan if it is freed twice or leaks.
+	assert(glist.removeAll(list, gvalue.getString("3")) == 9);
+	assert(glist.removeAll(list, gvalue.getString("3")) == 0);
+	assert(list->size == 80);
+	for (uint32_t i = 0; i < list->size; i++) {
+		assert(strcmp(list->nodes[i].value.primitive.stringValue, "3") != 0);
+	}
+	glist.free(list);
+
+	struct glist_list *numbers = glist.create(gvalue.intType);
+	for (int i = 0; i < 1000; i++) {
+		glist.add(numbers, gvalue.getInt(i));
+	}
+	int calls = 0;
+	assert(glist.removeIf(numbers, test_glist_isOdd, &calls) == 500);
+	assert(calls == 1000);
+	for (uint32_t i = 0; i < numbers->size; i++) {
+		assert(numbers->nodes[i].value.primitive.intValue == (int) i * 2);
+	}
+	glist.free(numbers);
+
+	struct glist_config config = { .dataType = gvalue.intType, .sorted = true };
+	struct glist_list *sorted = glist.create1(config);
+	for (int i = 0; i < 300; i++) {
+		glist.add(sorted, gvalue.getInt(i % 7));
+	}
+	assert(glist.removeAll(sorted, gvalue.getInt(4)) == 43);
+	assert(glist.removeAll(sorted, gvalue.getInt(9)) == 0);
+	assert(glist.contains(sorted, gvalue.getInt(4)) == false);
+	assert(sorted->size == 257);
+	test_glist_assertSorted(sorted, gvalue.cmp);
+	glist.free(sorted);
+
+	puts("Done test_glist_removeBulk\n");
+}
+
+// Checks tryGetIndex and tryGetLastIndex against a search that calls gvalue.cmp for every value.
+void test_glist_assertSearch(struct glist_list *list, struct gvalue_value value) {
+	uint32_t first = UINT32_MAX;
+	uint32_t last = UINT32_MAX;
+	for (uint32_t i = 0; i < list->size; i++) {
+		if (gvalue.cmp(value, *glist.get(list, i)) == 0) {
+			first = (first == UINT32_MAX) ? i : first;
+			last = i;
+		}
+	}
+
+	uint32_t index;
+	assert(glist.tryGetIndex(list, value, &index) == (first != UINT32_MAX));
+	assert(first == UINT32_MAX || index == first);
+	assert(glist.tryGetLastIndex(list, value, &index) == (last != UINT32_MAX));
+	assert(last == UINT32_MAX || index == last);
+	assert(glist.contains(list, value) == (first != UINT32_MAX));
+}
+
+struct glist_list *test_glist_createScanList(const struct gvalue_type *dataType, bool packed) {
+	struct glist_config config = { .dataType = dataType, .packedStorage = packed };
+	return glist.create1(config);
+}
+
+void test_glist_scan(void) {
+	puts("Start test_glist_scan");
+
+	// Sizes around the vector widths and the blocks of 256 values, with nodes and packed.
+	uint32_t sizes[] = { 0, 1, 3, 15, 16, 17, 33, 255, 256, 257, 600 };
+	int objects[64];
+	for (size_t s = 0; s < 2 * sizeof(sizes) / sizeof(sizes[0]); s++) {
+		bool packed = s % 2 != 0;
+		struct glist_list *bytes = test_glist_createScanList(gvalue.byteType, packed);
+		struct glist_list *ushorts = test_glist_createScanList(gvalue.ushortType, packed);
+		struct glist_list *ints = test_glist_createScanList(gvalue.intType, packed);
+		struct glist_list *longs = test_glist_createScanList(gvalue.longType, packed);
+		struct glist_list *chars = test_glist_createScanList(gvalue.charType, packed);
+		struct glist_list *wchars = test_glist_createScanList(gvalue.wcharType, packed);
+		struct glist_list *pointers = test_glist_createScanList(gvalue.pointerType, packed);
+		struct glist_list *bools = test_glist_createScanList(gvalue.boolType, packed);
+
+		// Values repeat every 61 positions, and the last one only appears at the end.
+		for (uint32_t i = 0; i < sizes[s / 2]; i++) {
+			int r = (i + 1 == sizes[s / 2]) ? 63 : (int) (i % 61);
+			glist.add(bytes, gvalue.getByte((int8_t) -r));
+			glist.add(ushorts, gvalue.getUShort((uint16_t) (r * 1000)));
+			glist.add(ints, gvalue.getInt(r - 1000000));
+			glist.add(longs, gvalue.getLong(((int64_t) r << 32) | 7));
+			glist.add(chars, gvalue.getChar((char) ('0' + r)));
+			glist.add(wchars, gvalue.getWChar((wchar_t) (0x3000 + r)));
+			glist.add(pointers, gvalue.getPointer(&(objects[r])));
+			glist.add(bools, gvalue.getBool(r == 63));
+		}
+
+		for (int r = 0; r < 64; r++) {
+			test_glist_assertSearch(bytes, gvalue.getByte((int8_t) -r));
+			test_glist_assertSearch(ushorts, gvalue.getUShort((uint16_t) (r * 1000)));
+			test_glist_assertSearch(ints, gvalue.getInt(r - 1000000));
+			test_glist_assertSearch(longs, gvalue.getLong(((int64_t) r << 32) | 7));
+			// Same lower half as a stored value.
+			test_glist_assertSearch(longs, gvalue.getLong(((int64_t) (r + 100) << 32) | 7));
+			test_glist_assertSearch(chars, gvalue.getChar((char) ('0' + r)));
+			test_glist_assertSearch(wchars, gvalue.getWChar((wchar_t) (0x3000 + r)));
+			test_glist_assertSearch(pointers, gvalue.getPointer(&(objects[r])));
+		}
+		test_glist_assertSearch(bools, gvalue.getBool(true));
+		test_glist_assertSearch(bools, gvalue.getBool(false));
+
+		// A value of another type is never equal.
+		uint32_t index;
+		assert(glist.tryGetIndex(ints, gvalue.getLong(-1000000), &index) == false);
+
+		glist.free(bools);
+		glist.free(pointers);
+		glist.free(wchars);
+		glist.free(chars);
+		glist.free(longs);
+		glist.free(ints);
+		glist.free(ushorts);
+		glist.free(bytes);
+	}
+
+	puts("Done test_glist_scan\n");
+}
+
+void test_glist_assertSameValues(struct glist_list *packed, struct glist_list *list) {
+	assert(packed->size == list->size);
+	for (uint32_t i = 0; i < list->size; i++) {
+		struct gvalue_value value = *glist.get(packed, i);
+		assert(value.type == list->config.dataType);
+		assert(gvalue.cmp(value, *glist.get(list, i)) == 0);
+	}
+}
+
+bool test_glist_isMultipleOfFive(struct gvalue_value value, void *context) {
+	return gvalue.hash(value) % 5 == 0;
+}
+
+int64_t test_glist_packedSum = 0;
+
+void test_glist_addToPackedSum(struct gvalue_value value) {
+	test_glist_packedSum += value.primitive.shortValue;
+}
+
+void test_glist_packed(void) {
+	puts("Start test_glist_packed");
+
+	// Every operation is applied to a packed list and to one with nodes, which must stay the same.
+	const struct gvalue_type *types[] = { gvalue.byteType, gvalue.shortType, gvalue.intType, gvalue.ulongType,
+			gvalue.doubleType, gvalue.charType, gvalue.wcharType, gvalue.boolType };
+	for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+		for (int sorted = 0; sorted < 2; sorted++) {
+			struct glist_config config = { .dataType = types[t], .sorted = sorted };
+			struct glist_list *list = glist.create1(config);
+			config.packedStorage = true;
+			struct glist_list *packed = glist.create1(config);
+			assert(packed->nodes == NULL && packed->freeBits == NULL);
+
+			for (int i = 0; i < 300; i++) {
+				int r = (i * 37) % 101 - 50;
+				struct gvalue_value value;
+				switch (types[t]->code) {
+				case GVALUE_TYPE_BYTE: value = gvalue.getByte((int8_t) r); break;
+				case GVALUE_TYPE_SHORT: value = gvalue.getShort((int16_t) (r * 300)); break;
+				case GVALUE_TYPE_INT: value = gvalue.getInt(r * 70000); break;
+				case GVALUE_TYPE_ULONG: value = gvalue.getULong((uint64_t) r << 40); break;
+				case GVALUE_TYPE_DOUBLE: value = gvalue.getDouble((r % 7 == 0) ? NAN : r / 3.0); break;
+				case GVALUE_TYPE_CHAR: value = gvalue.getChar((char) ('a' + r % 26)); break;
+				case GVALUE_TYPE_WCHAR: value = gvalue.getWChar((wchar_t) (0x400 + r)); break;
+				default: value = gvalue.getBool(r % 3 == 0); break;
+				}
+				glist.add(list, value);
+				glist.add(packed, value);
+			}
+			test_glist_assertSameValues(packed, list);
+
+			for (uint32_t i = 0; i < list->size; i += 7) {
+				struct gvalue_value value = *glist.get(list, i);
+				uint32_t index1;
+				uint32_t index2;
+				assert(glist.tryGetIndex(packed, value, &index1) && glist.tryGetIndex(list, value, &index2) && index1 == index2);
+				assert(glist.tryGetLastIndex(packed, value, &index1) && glist.tryGetLastIndex(list, value, &index2) && index1 == index2);
+			}
+
+			glist.removeIndex(list, 3);
+			glist.removeIndex(packed, 3);
+			glist.removeRange(list, 10, 40);
+			glist.removeRange(packed, 10, 40);
+			assert(glist.removeIf(list, test_glist_isMultipleOfFive, NULL) == glist.removeIf(packed, test_glist_isMultipleOfFive, NULL));
+			struct gvalue_value first = *glist.get(list, 0);
+			assert(glist.removeAll(list, first) == glist.removeAll(packed, first));
+			test_glist_assertSameValues(packed, list);
+
+			glist.sort(list);
+			glist.sort(packed);
+			test_glist_assertSameValues(packed, list);
+
+			// Bool lists have only a few values left.
+			if (list->size > 20) {
+				struct glist_list slice = glist.getSlice(packed, 5, 20);
+				assert(slice.size == 16);
+				assert(gvalue.cmp(*glist.get(&slice, 0), *glist.get(list, 5)) == 0);
+			}
+
+			glist.free(packed);
+			glist.free(list);
+		}
+	}
+
+	// freeOnRemove lives in a bitmap that moves with the values. ASan catches a wrong free or a leak.
+	struct glist_config config = { .dataType = gvalue.stringType, .packedStorage = true };
+	struct glist_list *strings = glist.create1(config);
+	assert(strings->freeBits != NULL);
+	char *kept[100];
+	for (int i = 0; i < 200; i++) {
+		char *chars = malloc(8);
+		sprintf(chars, "%03d", (i * 73) % 200);
+		if (i % 2 == 0) {
+			kept[i / 2] = chars;
+		}
+		glist.add1(strings, gvalue.getString(chars), i % 2 != 0);
+	}
+	glist.sort(strings);
+	assert(strcmp(glist.get(strings, 0)->primitive.stringValue, "000") == 0);
+	assert(strcmp(glist.get(strings, 199)->primitive.stringValue, "199") == 0);
+	assert(glist.contains(strings, gvalue.getString("123")));
+	glist.removeRange(strings, 0, 99);
+	glist.removeIndex(strings, 10);
+	glist.removeAll(strings, gvalue.getString("150"));
+	glist.free(strings);
+	for (int i = 0; i < 100; i++) {
+		free(kept[i]);
+	}
+
+	// Packed lists grow like the others and are visited in order.
+	struct glist_config shortConfig = { .dataType = gvalue.shortType, .packedStorage = true };
+	struct glist_list *shorts = glist.create1(shortConfig);
+	for (int i = 0; i < 10000; i++) {
+		glist.add(shorts, gvalue.getShort((int16_t) (i % 1000)));
+	}
+	glist.each(shorts, test_glist_addToPackedSum);
+	assert(test_glist_packedSum == 10 * 999 * 1000 / 2);
+	assert(glist.removeAll(shorts, gvalue.getShort(999)) == 10);
+	glist.free(shorts);
+
+	struct glist_config sstringConfig = { .dataType = gvalue.sstringType, .packedStorage = true };
+	printf("(Ignore this error) ");
+	assert(glist.create1(sstringConfig) == NULL);
+
+	puts("Done test_glist_packed\n");
+}
+
+void test_glist_insert(void) {
+	puts("Start test_glist_insert");
+
+	for (int packed = 0; packed < 2; packed++) {
+		struct glist_config config = { .dataType = gvalue.intType, .packedStorage = packed };
+		struct glist_list *list = glist.create1(config);
+
+		glist.insert(list, 0, gvalue.getInt(2));
+		glist.insert(list, 0, gvalue.getInt(0));
+		glist.insert(list, 1, gvalue.getInt(1));
+		glist.insert(list, 3, gvalue.getInt(3));
+		printf("(Ignore this error) ");
+		glist.insert(list, 5, gvalue.getInt(5));
+		assert(list->size == 4);
+
+		struct gvalue_value values[100];
+		for (int i = 0; i < 100; i++) {
+			values[i] = gvalue.getInt(4 + i);
+		}
+		glist.addAll(list, values, 100);
+		assert(list->size == 104);
+
+		// A wrong value leaves the list as it was.
+		values[50] = gvalue.getLong(0);
+		printf("(Ignore this error) ");
+		glist.addAll(list, values, 100);
+		assert(list->size == 104);
+
+		glist.reserve(list, 1000);
+		assert(list->config.capacity == 1000);
+		glist.reserve(list, 10);
+		assert(list->config.capacity == 1000);
+
+		glist.addList(list, list);
+		assert(list->size == 208);
+		for (uint32_t i = 0; i < list->size; i++) {
+			assert(glist.get(list, i)->primitive.intValue == (int) (i % 104));
+		}
+
+		struct glist_list *nodes = glist.create(gvalue.intType);
+		glist.addList(nodes, list);
+		glist.addList(list, nodes);
+		assert(nodes->size == 208 && list->size == 416);
+		assert(glist.get(list, 415)->primitive.intValue == 103);
+		glist.free(nodes);
+		glist.free(list);
+	}
+
+	// Copied strings are not freed twice, and a sorted list stays sorted.
+	struct glist_list *owner = glist.create(gvalue.stringType);
+	const char *words[] = { "pear", "apple", "fig", "kiwi" };
+	for (int i = 0; i < 4; i++) {
+		char *chars = malloc(strlen(words[i]) + 1);
+		strcpy(chars, words[i]);
+		glist.add1(owner, gvalue.getString(chars), true);
+	}
+	struct glist_config sortedConfig = { .dataType = gvalue.stringType, .sorted = true };
+	struct glist_list *sorted = glist.create1(sortedConfig);
+	glist.addList(sorted, owner);
+	glist.addList(sorted, sorted);
+	assert(sorted->size == 8);
+	test_glist_assertSorted(sorted, gvalue.cmp);
+	assert(strcmp(sorted->nodes[0].value.primitive.stringValue, "apple") == 0);
+	printf("(Ignore this error) ");
+	glist.insert(sorted, 0, gvalue.getString("zebra"));
+	assert(sorted->size == 8);
+	glist.free(sorted);
+	glist.free(owner);
+
+	puts("Done test_glist_insert\n");
+}
+
+void test_gdeque_class_complete(void) {
+	test_classIsComplete(&gdeque, &(gdeque.free));
+}
+
+void test_gdeque(void) {
+	puts("Start test_gdeque");
+
+	test_gdeque_class_complete();
+
+	struct gdeque_deque *deque = gdeque.create(gvalue.intType);
+	struct gvalue_value value;
+	assert(gdeque.popFront(deque, &value) == false);
+	assert(gdeque.popBack(deque, &value) == false);
+	assert(gdeque.peekFront(deque) == NULL);
+
+	// Mirrors a plain array with the front at index from, through many wraps and growths.
+	int expected[4096];
+	uint32_t from = 2048;
+	uint32_t to = 2048;
+	srand(11);
+	for (int step = 0; step < 20000; step++) {
+		int action = rand() % 6;
+		if (to - from > 1500) {
+			action = 4;
+		}
+		if (action < 2 && from > 0) {
+			expected[--from] = step;
+			gdeque.pushFront(deque, gvalue.getInt(step));
+		}
+		else if (action < 4 && to < 4096) {
+			expected[to++] = step;
+			gdeque.pushBack(deque, gvalue.getInt(step));
+		}
+		else if (action == 4 && from < to) {
+			assert(gdeque.popFront(deque, &value) == true);
+			assert(value.primitive.intValue == expected[from++]);
+		}
+		else if (from < to) {
+			assert(gdeque.popBack(deque, &value) == true);
+			assert(value.primitive.intValue == expected[--to]);
+		}
+		if (from == 0 || to == 4096) {
+			// Recentre the mirror.
+			memmove(expected + 1024, expected + from, sizeof(int) * (to - from));
+			to = 1024 + to - from;
+			from = 1024;
+		}
+
+		assert(deque->size == to - from);
+		if (deque->size > 0) {
+			assert(gdeque.peekFront(deque)->primitive.intValue == expected[from]);
+			assert(gdeque.peekBack(deque)->primitive.intValue == expected[to - 1]);
+		}
+		if (step % 97 == 0) {
+			for (uint32_t i = 0; i < deque->size; i++) {
+				assert(gdeque.get(deque, i)->primitive.intValue == expected[from + i]);
+			}
+		}
+	}
+	assert((deque->config.capacity & (deque->config.capacity - 1)) == 0);
+
+	printf("gdeque: ");
+	gdeque.clear(deque);
+	for (int i = 0; i < 5; i++) {
+		gdeque.pushFront(deque, gvalue.getInt(i));
+	}
+	gdeque.print(deque);
+	puts("");
+	gdeque.free(deque);
+
+	// Popped values belong to the caller, dropped ones are freed. ASan catches a leak or a double free.
+	struct gdeque_config config = { .dataType = gvalue.stringType, .capacity = 3 };
+	struct gdeque_deque *strings = gdeque.create1(config);
+	assert(strings->config.capacity == 4);
+	for (int i = 0; i < 10; i++) {
+		char *chars = malloc(4);
+		sprintf(chars, "s%d", i);
+		gdeque.pushBack1(strings, gvalue.getString(chars), true);
+	}
+	assert(gdeque.popFront(strings, &value) == true);
+	assert(strcmp(value.primitive.stringValue, "s0") == 0);
+	free(value.primitive.stringValue);
+	assert(gdeque.popFront(strings, NULL) == true);
+	assert(gdeque.popBack(strings, NULL) == true);
+	assert(strcmp(gdeque.get(strings, 0)->primitive.stringValue, "s2") == 0);
+	printf("(Ignore this error) ");
+	assert(gdeque.get(strings, 7) == NULL);
+	gdeque.free(strings);
+
+	puts("Done test_gdeque\n");
+}
+
 void test_gset_print(struct gvalue_value v) {
 	printf("(%" PRIi32 ")", v.primitive.intValue);
 }
@@ -416,14 +1231,1071 @@ void test_gset(void) {
 
 	gset.free(set);
 
+	struct gset_config config = { .dataType = gvalue.stringType, .maintainFingerprint = true };
+	struct gset_set *set1 = gset.create1(config);
+	struct gset_set *set2 = gset.create1(config);
+	gset.put(set1, gvalue.getString("a"));
+	gset.put(set1, gvalue.getString("b"));
+	gset.put(set2, gvalue.getString("b"));
+	gset.put(set2, gvalue.getString("c"));
+	assert(gset.equals(set1, set2) == false);
+	gset.remove(set2, gvalue.getString("c"));
+	gset.put(set2, gvalue.getString("a"));
+	assert(gset.equals(set1, set2) == true);
+	gset.free(set1);
+	gset.free(set2);
+
 	puts("Done test_gset\n");
 }
 
+void test_fmap_class_complete(void) {
+	test_classIsComplete(&fmap, &(fmap.close));
+}
+
+int test_fmap_each_count;
+
+void test_fmap_each(struct gvalue_value key, struct gvalue_value value) {
+	test_fmap_each_count++;
+}
+
+void test_fmap(void) {
+	puts("Start test_fmap");
+
+	test_fmap_class_complete();
+
+	const char *path = "test_fmap.bin";
+	remove(path);
+
+	struct fmap_map *map = fmap.open(path, gvalue.stringType, gvalue.intType);
+	assert(map != NULL);
+
+	char key[32];
+	for (int i = 0; i < 2000; i++) {
+		sprintf(key, "key-%i", i);
+		assert(fmap.put(map, gvalue.getString(key), gvalue.getInt(i)) == true);
+	}
+
+	for (int i = 0; i < 2000; i += 2) {
+		sprintf(key, "key-%i", i);
+		assert(fmap.remove(map, gvalue.getString(key)) == true);
+	}
+
+	assert(fmap.put(map, gvalue.getString("key-1"), gvalue.getInt(-1)) == false);
+	assert(fmap.sync(map) == true);
+	printf("Size: %u, capacity: %u\n", map->header->size, map->header->capacity);
+	fmap.close(map);
+
+	printf("(Ignore this error) ");
+	assert(fmap.open(path, gvalue.intType, gvalue.intType) == NULL);
+
+	map = fmap.open(path, gvalue.stringType, gvalue.intType);
+	assert(map != NULL);
+	assert(map->header->size == 1000);
+
+	struct gvalue_value value;
+	assert(fmap.get(map, gvalue.getString("key-1"), &value) == true);
+	assert(value.primitive.intValue == -1);
+	assert(fmap.get(map, gvalue.getString("key-1999"), &value) == true);
+	assert(value.primitive.intValue == 1999);
+	assert(fmap.containsKey(map, gvalue.getString("key-2")) == false);
+
+	test_fmap_each_count = 0;
+	fmap.each(map, test_fmap_each);
+	assert(test_fmap_each_count == 1000);
+
+	fmap.close(map);
+	remove(path);
+
+	// Keys hash identically to the in-memory map.
+	map = fmap.open(path, gvalue.wstringType, NULL);
+	assert(fmap.put(map, gvalue.getWString(L"wide"), gvalue.getString("narrow")) == true);
+	assert(fmap.get(map, gvalue.getWString(L"wide"), &value) == true);
+	assert(strcmp(value.primitive.stringValue, "narrow") == 0);
+	assert(map->entries[0].hashCode == gvalue.hash(gvalue.getWString(L"wide")));
+	fmap.close(map);
+	remove(path);
+
+	puts("Done test_fmap\n");
+}
+
+void test_gwal_class_complete(void) {
+	test_classIsComplete(&gwal, &gwal.close);
+}
+
+void test_gwal(void) {
+	puts("Start test_gwal");
+
+	test_gwal_class_complete();
+
+	struct gmap_config mapConfig = { .keyType = gvalue.intType, .maintainInsertionOrder = true };
+	struct gwal_config config = { .logPath = "test_gwal.log", .snapshotPath = "test_gwal.snap", .groupCommitSize = 16 };
+	remove(config.logPath);
+	remove(config.snapshotPath);
+
+	struct gwal_log *wal = gwal.open(mapConfig, config);
+	assert(wal != NULL);
+
+	for (int i = 0; i < 1000; i++) {
+		gmap.put(wal->map, gvalue.getInt(i), gvalue.getInt(i * 2));
+	}
+	for (int i = 0; i < 1000; i += 2) {
+		gmap.remove(wal->map, gvalue.getInt(i));
+	}
+	gmap.put(wal->map, gvalue.getInt(1), gvalue.getString("one"));
+	gmap.put(wal->map, gvalue.getInt(3), gvalue.getWString(L"three"));
+
+	struct gmap_map *map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	// Replay the log without a snapshot.
+	wal = gwal.open(mapConfig, config);
+	assert(wal != NULL);
+	assert(wal->map->size == 500);
+	assert(strcmp(gmap.get(wal->map, gvalue.getInt(1))->primitive.stringValue, "one") == 0);
+	assert(wcscmp(gmap.get(wal->map, gvalue.getInt(3))->primitive.wstringValue, L"three") == 0);
+	assert(gmap.get(wal->map, gvalue.getInt(999))->primitive.intValue == 1998);
+	assert(gmap.containsKey(wal->map, gvalue.getInt(2)) == false);
+
+	// Compact, log a few more changes and end with a torn record.
+	assert(gwal.compact(wal) == true);
+	gmap.clear(wal->map);
+	gmap.put(wal->map, gvalue.getInt(7), gvalue.getInt(70));
+	map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	FILE *file = fopen(config.logPath, "ab");
+	fputs("torn", file);
+	fclose(file);
+
+	wal = gwal.open(mapConfig, config);
+	assert(wal != NULL);
+	assert(wal->map->size == 1);
+	assert(gmap.get(wal->map, gvalue.getInt(7))->primitive.intValue == 70);
+	map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	// A record size that was cut short is torn too. Changes logged after reopening must not end up
+	// behind it, where the next replay would read them from the wrong offset.
+	for (size_t cut = 1; cut < sizeof(uint32_t); cut++) {
+		file = fopen(config.logPath, "ab");
+		fwrite("\x10\x00\x00", 1, cut, file);
+		fclose(file);
+
+		wal = gwal.open(mapConfig, config);
+		assert(wal != NULL);
+		for (int i = 0; i < 10; i++) {
+			gmap.put(wal->map, gvalue.getInt(100 * (int) cut + i), gvalue.getInt(i));
+			assert(gwal.commit(wal) == true);
+		}
+		map = wal->map;
+		assert(gwal.close(wal) == true);
+		gmap.free(map);
+
+		wal = gwal.open(mapConfig, config);
+		assert(wal != NULL);
+		assert(wal->map->size == 1 + 10 * cut);
+		assert(gmap.get(wal->map, gvalue.getInt(100 * (int) cut + 9))->primitive.intValue == 9);
+		map = wal->map;
+		assert(gwal.close(wal) == true);
+		gmap.free(map);
+	}
+
+	// Compaction happens by itself once the log is over the threshold.
+	config.compactThreshold = 4096;
+	wal = gwal.open(mapConfig, config);
+	for (int i = 0; i < 1000; i++) {
+		gmap.put(wal->map, gvalue.getInt(i), gvalue.getInt(i));
+	}
+	assert(wal->logSize < 4096 + 16 * 64);
+	map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	wal = gwal.open(mapConfig, config);
+	assert(wal->map->size == 1000);
+
+	// A change that cannot be logged is reported until compaction has saved the map.
+	int object = 0;
+	printf("(Ignore this error) ");
+	gmap.put(wal->map, gvalue.getInt(5), gvalue.getPointer(&object));
+	assert(wal->lostChanges == 1);
+	printf("(Ignore this error) ");
+	assert(gwal.commit(wal) == false);
+	gmap.put(wal->map, gvalue.getInt(5), gvalue.getInt(50));
+	assert(gwal.compact(wal) == true);
+	assert(wal->lostChanges == 0);
+	assert(gwal.commit(wal) == true);
+
+	map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	wal = gwal.open(mapConfig, config);
+	assert(gmap.get(wal->map, gvalue.getInt(5))->primitive.intValue == 50);
+	map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	// Freeing the map is not logged as a clear, even when the log is only closed afterwards.
+	wal = gwal.open(mapConfig, config);
+	assert(wal->map->size == 1000);
+	gmap.free(wal->map);
+	fclose(wal->file);
+	free(wal->recordBuffer);
+	free(wal);
+
+	wal = gwal.open(mapConfig, config);
+	assert(wal->map->size == 1000);
+	map = wal->map;
+	assert(gwal.close(wal) == true);
+	gmap.free(map);
+
+	// Keys or values that can never be logged are rejected up front.
+	struct gmap_config pointerKeys = { .keyType = gvalue.pointerType };
+	printf("(Ignore this error) ");
+	assert(gwal.open(pointerKeys, config) == NULL);
+	struct gmap_config pointerValues = { .keyType = gvalue.intType, .restrictValueToType = gvalue.pointerType };
+	printf("(Ignore this error) ");
+	assert(gwal.open(pointerValues, config) == NULL);
+
+	remove(config.logPath);
+	remove(config.snapshotPath);
+
+	puts("Done test_gwal\n");
+}
+
+void test_gvalue_hash(void) {
+	puts("Start test_gvalue_hash");
+
+	// Slices of a longer string hash like the same characters on their own.
+	const char *url = "https://example.com/some/fairly/long/path?with=a&query=string";
+	char prefix[32];
+	for (size_t length = 0; length < sizeof(prefix); length++) {
+		memcpy(prefix, url, length);
+		prefix[length] = '\0';
+		assert(gvalue.hashBytes(url, length) == gvalue.hashString(prefix));
+	}
+
+	assert(gvalue.hashString("abc") != gvalue.hashString("abd"));
+	assert(gvalue.hashString(NULL) == 0);
+	assert(gvalue.hashWString(L"abc") == gvalue.hashBytes(L"abc", 3 * sizeof(wchar_t)));
+
+	puts("Done test_gvalue_hash\n");
+}
+
+// Chain length statistics for a key pattern. Expected probes is the average number of keys compared
+// by a successful lookup.
+void test_gvalue_hashChains(const char *pattern, const struct gvalue_type *type, struct gvalue_value (*keyFunc)(int)) {
+	const int count = 100000;
+	struct gmap_map *map = gmap.create(type);
+
+	for (int i = 0; i < count; i++) {
+		gmap.put(map, keyFunc(i), gvalue.getInt(i));
+	}
+	assert(map->size == count);
+
+	uint32_t maxChain = 0;
+	uint32_t usedSlots = 0;
+	double probes = 0;
+
+	for (uint32_t slot = 0; slot < map->config.capacity; slot++) {
+		uint32_t chain = 0;
+		for (struct gmap_bucket *bucket = map->table[slot]; bucket != NULL; bucket = bucket->next) {
+			chain++;
+		}
+		if (chain > maxChain) {
+			maxChain = chain;
+		}
+		usedSlots += (chain > 0);
+		probes += (double) chain * (chain + 1) / 2;
+	}
+
+	printf("%-22s max chain %2" PRIu32 ", used slots %5.1f%%, expected probes %.3f\n", pattern, maxChain,
+			100.0 * usedSlots / map->config.capacity, probes / count);
+	assert(maxChain <= 10);
+	assert(probes / count < 1.5);
+
+	gmap.free(map);
+}
+
+struct gvalue_value test_gvalue_sequentialInt(int i) { return gvalue.getInt(i); }
+struct gvalue_value test_gvalue_stride64Int(int i) { return gvalue.getInt(i * 64); }
+struct gvalue_value test_gvalue_highBitsInt(int i) { return gvalue.getUInt((uint32_t) i << 15); }
+struct gvalue_value test_gvalue_highBitsLong(int i) { return gvalue.getLong((int64_t) i << 32); }
+struct gvalue_value test_gvalue_priceDouble(int i) { return gvalue.getDouble(i * 0.01); }
+struct gvalue_value test_gvalue_smallDouble(int i) { return gvalue.getDouble(1.0 + i * 1e-9); }
+struct gvalue_value test_gvalue_quarterFloat(int i) { return gvalue.getFloat(i * 0.25f); }
+
+// Average fraction of output bits that flip when a single input bit flips. Ideal is 0.5.
+double test_gvalue_avalanche(uint32_t (*hashFunc)(uint32_t)) {
+	uint64_t flips = 0;
+	uint64_t total = 0;
+
+	for (uint32_t i = 0; i < 10000; i++) {
+		uint32_t x = i * UINT32_C(2654435761);
+		uint32_t h = hashFunc(x);
+		for (int bit = 0; bit < 32; bit++) {
+			uint32_t diff = h ^ hashFunc(x ^ (UINT32_C(1) << bit));
+			while (diff != 0) {
+				flips++;
+				diff &= diff - 1;
+			}
+			total += 32;
+		}
+	}
+
+	return (double) flips / total;
+}
+
+void test_gvalue_hashDistribution(void) {
+	puts("Start test_gvalue_hashDistribution");
+
+	test_gvalue_hashChains("sequential int", gvalue.intType, test_gvalue_sequentialInt);
+	test_gvalue_hashChains("int stride 64", gvalue.intType, test_gvalue_stride64Int);
+	test_gvalue_hashChains("uint high bits", gvalue.uintType, test_gvalue_highBitsInt);
+	test_gvalue_hashChains("long high bits", gvalue.longType, test_gvalue_highBitsLong);
+	test_gvalue_hashChains("double prices", gvalue.doubleType, test_gvalue_priceDouble);
+	test_gvalue_hashChains("double tiny fractions", gvalue.doubleType, test_gvalue_smallDouble);
+	test_gvalue_hashChains("float quarters", gvalue.floatType, test_gvalue_quarterFloat);
+
+	double avalanche = test_gvalue_avalanche(gvalue.hashInt);
+	printf("hashInt avalanche %.4f\n", avalanche);
+	assert(avalanche > 0.49 && avalanche < 0.51);
+
+	assert(gvalue.hashInt(1) != gvalue.hashInt(1 | 64));
+	assert(gvalue.hashDouble(1.1) != gvalue.hashDouble(1.2));
+
+	// Values that compare equal hash alike and can be found again.
+	assert(gvalue.hashDouble(-0.0) == gvalue.hashDouble(0.0));
+	assert(gvalue.hashDouble(NAN) == gvalue.hashDouble(-NAN));
+	struct gmap_map *map = gmap.create(gvalue.doubleType);
+	gmap.put(map, gvalue.getDouble(NAN), gvalue.getInt(1));
+	gmap.put(map, gvalue.getDouble(0.0), gvalue.getInt(2));
+	assert(gmap.get(map, gvalue.getDouble(NAN))->primitive.intValue == 1);
+	assert(gmap.get(map, gvalue.getDouble(-0.0))->primitive.intValue == 2);
+	assert(map->size == 2);
+	gmap.free(map);
+
+	puts("Done test_gvalue_hashDistribution\n");
+}
+
+void test_gvalue_intern(void) {
+	puts("Start test_gvalue_intern");
+
+	char buffer[32];
+	strcpy(buffer, "shared key");
+	char *interned = gvalue.intern(buffer);
+	assert(interned != buffer);
+	assert(gvalue.intern("shared key") == interned);
+	assert(gvalue.intern("other key") != interned);
+	assert(gvalue.hash(gvalue.getIString(interned)) == gvalue.hashString("shared key"));
+
+	// Separate pools hand out separate copies. Long strings get blocks of their own.
+	struct gvalue_intern_pool *pool = gvalue.createInternPool();
+	assert(gvalue.internIn(pool, "shared key") != interned);
+	char longString[20000];
+	memset(longString, 'x', sizeof(longString) - 1);
+	longString[sizeof(longString) - 1] = '\0';
+	char *internedLong = gvalue.internIn(pool, longString);
+	for (int i = 0; i < 5000; i++) {
+		sprintf(buffer, "key-%i", i);
+		gvalue.internIn(pool, buffer);
+	}
+	assert(pool->size == 5002);
+	assert(gvalue.internIn(pool, longString) == internedLong);
+	assert(strcmp(gvalue.internIn(pool, "key-4999"), "key-4999") == 0);
+	gvalue.freeInternPool(pool);
+
+	struct gmap_map *map = gmap.create(gvalue.istringType);
+	for (int i = 0; i < 1000; i++) {
+		sprintf(buffer, "key-%i", i % 100);
+		gmap.put(map, gvalue.getIString(gvalue.intern(buffer)), gvalue.getInt(i));
+	}
+	assert(map->size == 100);
+	assert(gmap.get(map, gvalue.getIString(gvalue.intern("key-7")))->primitive.intValue == 907);
+
+	// Interned keys survive a snapshot round trip.
+	assert(gmap.saveBinary(map, "test_gvalue_intern.bin") == true);
+	struct gmap_map *loaded = gmap.loadBinary("test_gvalue_intern.bin");
+	assert(loaded != NULL);
+	assert(gmap.equals(map, loaded) == true);
+	gmap.free(loaded);
+	gmap.free(map);
+	remove("test_gvalue_intern.bin");
+
+	puts("Done test_gvalue_intern\n");
+}
+
+void test_gvalue_sstring(void) {
+	puts("Start test_gvalue_sstring");
+
+	assert(sizeof(struct gvalue_value) <= 24);
+
+	// Short strings are copied, so the buffer can be reused right away.
+	char buffer[32];
+	strcpy(buffer, "DE");
+	struct gvalue_value shortValue = gvalue.getSString(buffer);
+	strcpy(buffer, "FR");
+	assert(strcmp(gvalue.stringChars(&shortValue), "DE") == 0);
+	assert(gvalue.free(shortValue) == false);
+
+	struct gvalue_value fullValue = gvalue.getSString("fifteen chars!!");
+	assert(gvalue.stringChars(&fullValue) == fullValue.primitive.sstringValue);
+
+	// Longer strings are referenced and freed like regular strings.
+	char *longString = malloc(32);
+	strcpy(longString, "a string over fifteen chars");
+	struct gvalue_value longValue = gvalue.getSString(longString);
+	assert(gvalue.stringChars(&longValue) == longString);
+
+	assert(gvalue.hash(shortValue) == gvalue.hashString("DE"));
+	assert(gvalue.hash(longValue) == gvalue.hashString(longString));
+	assert(gvalue.cmp(shortValue, gvalue.getSString("DE")) == 0);
+	assert(gvalue.cmp(shortValue, longValue) < 0);
+	assert(gvalue.longValue(gvalue.getSString("12345")) == 12345);
+	char *alloc = gvalue.getAllocStringValue(fullValue);
+	assert(strcmp(alloc, "fifteen chars!!") == 0);
+	free(alloc);
+
+	struct gmap_map *map = gmap.create(gvalue.sstringType);
+	for (int i = 0; i < 100; i++) {
+		sprintf(buffer, "code-%i", i);
+		gmap.put(map, gvalue.getSString(buffer), gvalue.getInt(i));
+	}
+	gmap.put1(map, longValue, gvalue.getSString("long"), true, false);
+	assert(gmap.get(map, gvalue.getSString("code-42"))->primitive.intValue == 42);
+	assert(strcmp(gvalue.stringChars(gmap.get(map, gvalue.getSString("a string over fifteen chars"))), "long") == 0);
+
+	assert(gmap.saveBinary(map, "test_gvalue_sstring.bin") == true);
+	struct gmap_map *loaded = gmap.loadBinary("test_gvalue_sstring.bin");
+	assert(loaded != NULL);
+	assert(gmap.equals(map, loaded) == true);
+	gmap.free(loaded);
+	gmap.free(map);
+	remove("test_gvalue_sstring.bin");
+
+	puts("Done test_gvalue_sstring\n");
+}
+
+void test_gvalue_bytes(void) {
+	puts("Start test_gvalue_bytes");
+
+	// Fields are looked up straight out of a buffer, without NUL terminators.
+	const char buffer[] = "GET /index.html HTTP/1.1";
+	struct gvalue_value method = gvalue.getBytes(buffer, 3);
+	struct gvalue_value path = gvalue.getBytes(buffer + 4, 11);
+
+	assert(gvalue.cmp(method, gvalue.getBytes("GET", 3)) == 0);
+	assert(gvalue.cmp(method, gvalue.getBytes("GETX", 4)) < 0);
+	assert(gvalue.cmp(method, gvalue.getBytes("PUT", 3)) < 0);
+	assert(gvalue.hash(method) == gvalue.hashString("GET"));
+
+	struct gmap_map *map = gmap.create(gvalue.bytesType);
+	gmap.put(map, gvalue.getBytes("GET", 3), gvalue.getInt(1));
+	gmap.put(map, gvalue.getBytes("/index.html", 11), gvalue.getInt(2));
+	gmap.put(map, gvalue.getBytes("\0\1\2", 3), gvalue.getInt(3));
+	assert(gmap.get(map, method)->primitive.intValue == 1);
+	assert(gmap.get(map, path)->primitive.intValue == 2);
+	assert(gmap.get(map, gvalue.getBytes("\0\1\2", 3))->primitive.intValue == 3);
+	assert(gmap.containsKey(map, gvalue.getBytes("\0\1", 2)) == false);
+
+	assert(gmap.saveBinary(map, "test_gvalue_bytes.bin") == true);
+	struct gmap_map *loaded = gmap.loadBinary("test_gvalue_bytes.bin");
+	assert(loaded != NULL);
+	assert(gmap.equals(map, loaded) == true);
+	gmap.free(loaded);
+	gmap.free(map);
+	remove("test_gvalue_bytes.bin");
+
+	struct gset_set *set = gset.create(gvalue.bytesType);
+	gset.put(set, method);
+	assert(gset.contains(set, gvalue.getBytes("GET", 3)) == true);
+	gset.free(set);
+
+	struct glist_list *list = glist.create(gvalue.bytesType);
+	glist.add(list, path);
+	glist.add(list, gvalue.getBytes("a\\b\n", 4));
+	assert(glist.contains(list, gvalue.getBytes("/index.html", 11)) == true);
+	glist.print(list);
+	puts("");
+	char *printed = gvalue.getAllocStringValue(*glist.get(list, 1));
+	assert(strcmp(printed, "a\\x5Cb\\x0A") == 0);
+	free(printed);
+	glist.free(list);
+
+	puts("Done test_gvalue_bytes\n");
+}
+
+void test_gvalue_types(void) {
+	puts("Start test_gvalue_types");
+
+	// Every type carries its operations, and maps bind the key type's functions directly.
+	for (int code = 0; code < GVALUE_TYPES_COUNT; code++) {
+		const struct gvalue_type *type = gvalue.getType(code);
+		assert(type->hash != NULL && type->cmp != NULL && type->free != NULL && type->fprint != NULL && type->allocString != NULL);
+	}
+
+	struct gmap_map *map = gmap.create(gvalue.intType);
+	assert(map->config.hashFunc == gvalue.intType->hash);
+	assert(map->config.cmpFunc == gvalue.intType->cmp);
+	gmap.put(map, gvalue.getInt(7), gvalue.getString("seven"));
+	assert(gmap.get(map, gvalue.getInt(7)) != NULL);
+	gmap.free(map);
+
+	assert(gvalue.hash(gvalue.getInt(7)) == gvalue.hashInt(7));
+	assert(gvalue.cmp(gvalue.getInt(1), gvalue.getLong(1)) != 0);
+	assert(gvalue.cmp(gvalue.getDouble(-1.5), gvalue.getDouble(2)) < 0);
+
+	// Pointers compare by address.
+	int a[2];
+	assert(gvalue.cmp(gvalue.getPointer(&a[0]), gvalue.getPointer(&a[1])) < 0);
+	assert(gvalue.cmp(gvalue.getPointer(&a[1]), gvalue.getPointer(&a[1])) == 0);
+
+	char *s = gvalue.getAllocStringValue(gvalue.getUShort(65535));
+	assert(strcmp(s, "65535") == 0);
+	free(s);
+	assert(gvalue.free(gvalue.getString(my_strdup("owned"))) == true);
+	assert(gvalue.free(gvalue.getInt(1)) == false);
+
+	puts("Done test_gvalue_types\n");
+}
+
+// Custom type for the registry test: a 2D point compared by its coordinates.
+struct test_point {
+	int32_t x;
+	int32_t y;
+};
+
+uint32_t test_point_hash(struct gvalue_value value) {
+	const struct test_point *p = gvalue.customData(&value);
+	return gvalue.hashBytes(p, sizeof(*p));
+}
+
+int test_point_cmp(struct gvalue_value value1, struct gvalue_value value2) {
+	const struct test_point *p1 = gvalue.customData(&value1);
+	const struct test_point *p2 = gvalue.customData(&value2);
+	return (p1->x != p2->x) ? (p1->x < p2->x ? -1 : 1) : (p1->y < p2->y ? -1 : p1->y > p2->y);
+}
+
+void test_gvalue_registeredTypes(void) {
+	puts("Start test_gvalue_registeredTypes");
+
+	const struct gvalue_type *pointType = gvalue.registerType((struct gvalue_type) {
+			.name = "point", .cTypeName = "struct test_point", .size = sizeof(struct test_point),
+			.hash = test_point_hash, .cmp = test_point_cmp });
+	assert(pointType->code >= GVALUE_TYPES_COUNT);
+	assert(gvalue.getType(pointType->code) == pointType);
+
+	struct gmap_map *points = gmap.create(pointType);
+	struct test_point p = { 3, 4 };
+	gmap.put(points, gvalue.getCustom(pointType, &p), gvalue.getString("three-four"));
+	p.x = 5;
+	gmap.put(points, gvalue.getCustom(pointType, &p), gvalue.getString("five-four"));
+	p.x = 3;
+	assert(strcmp(gmap.get(points, gvalue.getCustom(pointType, &p))->primitive.stringValue, "three-four") == 0);
+	gmap.print(points);
+	puts("");
+	gmap.free(points);
+
+	// (tenant, user, resource) fits into the value, so no tuple is allocated.
+	const struct gvalue_type *fieldTypes[] = { gvalue.intType, gvalue.intType, gvalue.istringType };
+	const struct gvalue_type *keyType = gvalue.getTupleType(3, fieldTypes);
+	assert(keyType == gvalue.getTupleType(3, fieldTypes));
+	assert(keyType->size <= GVALUE_INLINE_CAPACITY);
+	assert(strcmp(keyType->name, "tuple(int, int, istring)") == 0);
+
+	struct gset_set *set = gset.create(keyType);
+	char *resources[] = { "orders", "invoices", "users" };
+	for (int tenant = 0; tenant < 10; tenant++) {
+		for (int user = 0; user < 10; user++) {
+			struct gvalue_value key = gvalue.getTuple(keyType, (struct gvalue_value[]) {
+					gvalue.getInt(tenant), gvalue.getInt(user), gvalue.getIString(gvalue.intern(resources[user % 3])) });
+			assert(gset.put(set, key) == true);
+		}
+	}
+	assert(set->size == 100);
+
+	struct gvalue_value key = gvalue.getTuple(keyType, (struct gvalue_value[]) {
+			gvalue.getInt(7), gvalue.getInt(4), gvalue.getIString(gvalue.intern("invoices")) });
+	assert(gset.contains(set, key) == true);
+	assert(gvalue.cmp(gvalue.tupleField(key, 0), gvalue.getInt(7)) == 0);
+	key = gvalue.getTuple(keyType, (struct gvalue_value[]) {
+			gvalue.getInt(7), gvalue.getInt(4), gvalue.getIString(gvalue.intern("orders")) });
+	assert(gset.contains(set, key) == false);
+	gset.free(set);
+
+	char *s = gvalue.getAllocStringValue(key);
+	assert(strcmp(s, "(7, 4, orders)") == 0);
+	free(s);
+
+	// Swapped fields hash and compare differently.
+	const struct gvalue_type *pairType = gvalue.getTupleType(2, fieldTypes);
+	struct gvalue_value ab = gvalue.getTuple(pairType, (struct gvalue_value[]) { gvalue.getInt(1), gvalue.getInt(2) });
+	struct gvalue_value ba = gvalue.getTuple(pairType, (struct gvalue_value[]) { gvalue.getInt(2), gvalue.getInt(1) });
+	assert(gvalue.hash(ab) != gvalue.hash(ba));
+	assert(gvalue.cmp(ab, ba) < 0);
+
+	// Larger tuples live on the heap and are owned by the value.
+	const struct gvalue_type *wideFields[] = { gvalue.longType, gvalue.longType, gvalue.doubleType, gvalue.sstringType };
+	const struct gvalue_type *wideType = gvalue.getTupleType(4, wideFields);
+	assert(wideType->size > GVALUE_INLINE_CAPACITY);
+	struct gvalue_value wide = gvalue.getTuple(wideType, (struct gvalue_value[]) {
+			gvalue.getLong(1), gvalue.getLong(2), gvalue.getDouble(0.5), gvalue.getSString("short") });
+	struct gvalue_value field = gvalue.tupleField(wide, 3);
+	assert(strcmp(gvalue.stringChars(&field), "short") == 0);
+	assert(gvalue.free(wide) == true);
+
+	// A field of the wrong type gives no tuple.
+	printf("(Ignore this error) ");
+	struct gvalue_value wrong = gvalue.getTuple(wideType, (struct gvalue_value[]) {
+			gvalue.getLong(1), gvalue.getInt(2), gvalue.getDouble(0.5), gvalue.getSString("short") });
+	assert(wrong.type == NULL);
+
+	printf("(Ignore this error) ");
+	assert(gvalue.getTupleType(1, fieldTypes) == NULL);
+
+	puts("Done test_gvalue_registeredTypes\n");
+}
+
+struct test_node {
+	int id;
+	struct test_node *edges[3];
+};
+
+int test_weakKeyCallbackCount = 0;
+
+void test_weakKeyCallback(struct gmap_map *map, struct gvalue_value key, struct gvalue_value value) {
+	assert(value.primitive.intValue == ((struct test_node *) key.primitive.pointerValue)->id);
+	test_weakKeyCallbackCount++;
+}
+
+void test_identityMap(void) {
+	puts("Start test_identityMap");
+
+	// A graph with cycles: node i points to 2i, 2i+1 and itself. Each node is visited exactly once.
+	struct test_node nodes[64];
+	for (int i = 0; i < 64; i++) {
+		nodes[i].id = i;
+		nodes[i].edges[0] = &nodes[(2 * i) % 64];
+		nodes[i].edges[1] = &nodes[(2 * i + 1) % 64];
+		nodes[i].edges[2] = &nodes[i];
+	}
+
+	struct gset_set *visited = gset.createIdentity();
+	struct test_node *stack[64 * 3 + 1];
+	int top = 0;
+	int visits = 0;
+	stack[top++] = &nodes[1];
+	while (top > 0) {
+		struct test_node *node = stack[--top];
+		if (gset.contains(visited, gvalue.getPointer(node))) {
+			continue;
+		}
+		gset.put(visited, gvalue.getPointer(node));
+		visits++;
+		for (int e = 0; e < 3; e++) {
+			stack[top++] = node->edges[e];
+		}
+	}
+	assert(visits == 64 && visited->size == 64);
+	gset.free(visited);
+
+	// Pointers that only differ in their alignment bits still spread over the table.
+	struct gmap_map *map = gmap.createIdentity();
+	char *block = malloc(16 * 1000);
+	for (int i = 0; i < 1000; i++) {
+		gmap.put(map, gvalue.getPointer(block + 16 * i), gvalue.getInt(i));
+	}
+	assert(map->size == 1000);
+	assert(gmap.get(map, gvalue.getPointer(block + 16 * 500))->primitive.intValue == 500);
+	assert(gmap.hashDeviation(map) < 2);
+	gmap.free(map);
+	free(block);
+
+	// Weak keys are dropped from every map once their object is forgotten.
+	struct gmap_config config = { .keyType = gvalue.pointerType, .weakKeys = true, .weakKeyCallback = test_weakKeyCallback };
+	struct gmap_map *cache1 = gmap.create1(config);
+	struct gmap_map *cache2 = gmap.create1(config);
+	for (int i = 0; i < 10; i++) {
+		gmap.put1(cache1, gvalue.getPointer(&nodes[i]), gvalue.getInt(i), true, false);
+	}
+	gmap.put(cache2, gvalue.getPointer(&nodes[3]), gvalue.getInt(3));
+	assert(gmap.forgetObject(&nodes[3]) == 2);
+	assert(test_weakKeyCallbackCount == 2);
+	assert(cache1->size == 9 && cache2->size == 0);
+	assert(gmap.forgetObject(&nodes[3]) == 0);
+	gmap.free(cache2);
+	assert(gmap.forgetObject(&nodes[4]) == 1);
+	gmap.free(cache1);
+	assert(gmap.forgetObject(&nodes[5]) == 0);
+
+	config.keyType = gvalue.intType;
+	printf("(Ignore this error) ");
+	assert(gmap.create1(config) == NULL);
+
+	puts("Done test_identityMap\n");
+}
+
+void test_gvalue_format(void) {
+	puts("Start test_gvalue_format");
+
+	char buffer[64];
+	assert(gvalue.format(gvalue.getLong(INT64_MIN), buffer, sizeof(buffer)) == 20);
+	assert(strcmp(buffer, "-9223372036854775808") == 0);
+	gvalue.format(gvalue.getULong(UINT64_MAX), buffer, sizeof(buffer));
+	assert(strcmp(buffer, "18446744073709551615") == 0);
+	gvalue.format(gvalue.getByte(-7), buffer, sizeof(buffer));
+	assert(strcmp(buffer, "-7") == 0);
+	gvalue.format(gvalue.getBool(true), buffer, sizeof(buffer));
+	assert(strcmp(buffer, "true") == 0);
+
+	// Shortest decimal that reads back.
+	struct { double d; const char *text; } doubles[] = {
+			{ 0.1, "0.1" }, { 0.5, "0.5" }, { 3, "3" }, { -2.25, "-2.25" }, { 1e-5, "0.00001" },
+			{ 123456.789, "123456.789" }, { 0.3, "0.3" }, { 1.0 / 3, "0.3333333333333333" },
+			{ -0.0, "-0" }, { 1e300, "1e+300" }, { 9007199254740993.0, "9007199254740992" }
+	};
+	for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+		gvalue.format(gvalue.getDouble(doubles[i].d), buffer, sizeof(buffer));
+		assert(strcmp(buffer, doubles[i].text) == 0);
+	}
+	gvalue.format(gvalue.getFloat(0.1f), buffer, sizeof(buffer));
+	assert(strcmp(buffer, "0.1") == 0);
+	gvalue.format(gvalue.getDouble(NAN), buffer, sizeof(buffer));
+	assert(strcmp(buffer, "nan") == 0);
+
+	// Random bit patterns always read back as the same number.
+	uint64_t x = 88172645463325252ULL;
+	for (int i = 0; i < 100000; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		double d;
+		memcpy(&d, &x, sizeof(d));
+		if (d != d) {
+			continue;
+		}
+		gvalue.format(gvalue.getDouble(d), buffer, sizeof(buffer));
+		assert(strtod(buffer, NULL) == d);
+
+		float f = (float) ((int64_t) x % 1000000000) / 1024.0f;
+		gvalue.format(gvalue.getFloat(f), buffer, sizeof(buffer));
+		assert(strtof(buffer, NULL) == f);
+	}
+
+	// Wide strings have the same text as regular ones.
+	struct gvalue_value wideChecks[] = { gvalue.getDouble(1.5), gvalue.getDouble(1e-7), gvalue.getDouble(1e300),
+			gvalue.getDouble(-1.0 / 3), gvalue.getFloat(0.1f), gvalue.getLong(INT64_MIN), gvalue.getBool(true) };
+	for (size_t i = 0; i < sizeof(wideChecks) / sizeof(wideChecks[0]); i++) {
+		char *narrow = gvalue.getAllocStringValue(wideChecks[i]);
+		wchar_t *wide = gvalue.getAllocWStringValue(wideChecks[i]);
+		assert(wcslen(wide) == strlen(narrow));
+		for (size_t c = 0; narrow[c] != '\0'; c++) {
+			assert(wide[c] == (wchar_t) narrow[c]);
+		}
+		free(narrow);
+		free(wide);
+	}
+
+	// Truncation works like snprintf.
+	char small[4];
+	assert(gvalue.format(gvalue.getString("abcdef"), small, sizeof(small)) == 6);
+	assert(strcmp(small, "abc") == 0);
+	assert(gvalue.format(gvalue.getInt(12345), small, sizeof(small)) == 5);
+	assert(strcmp(small, "123") == 0);
+	assert(gvalue.format(gvalue.getInt(12345), NULL, 0) == 5);
+
+	// The buffered writer produces the same text as printing value by value.
+	struct glist_list *list = glist.create(gvalue.doubleType);
+	for (int i = 0; i < 20000; i++) {
+		glist.add(list, gvalue.getDouble((i % 2 == 0) ? i * 7919.0 : i / 8.0));
+	}
+	glist.add(list, gvalue.getDouble(1e300));
+
+	FILE *file = tmpfile();
+	glist.fprint(list, file);
+	long size = ftell(file);
+	rewind(file);
+	char *written = malloc(size + 1);
+	assert(fread(written, 1, size, file) == (size_t) size);
+	written[size] = '\0';
+	fclose(file);
+
+	assert(strncmp(written, "[ 0, 0.125, 15838, 0.375", 24) == 0);
+	assert(strcmp(written + size - 10, ", 1e+300 ]") == 0);
+	size_t at = 2;
+	for (uint32_t i = 0; i < list->size; i++) {
+		size_t count = gvalue.format(*glist.get(list, i), buffer, sizeof(buffer));
+		assert(strncmp(written + at, buffer, count) == 0);
+		at += count + 2;
+	}
+	free(written);
+	glist.free(list);
+
+	puts("Done test_gvalue_format\n");
+}
+
+void test_gvalue_parse(void) {
+	puts("Start test_gvalue_parse");
+
+	struct { const char *text; bool parsed; int64_t value; } longs[] = {
+			{ "0", true, 0 }, { "-1", true, -1 }, { "1234567890123456789", true, INT64_C(1234567890123456789) },
+			{ "9223372036854775807", true, INT64_MAX }, { "-9223372036854775808", true, INT64_MIN },
+			{ "9223372036854775808", false, 0 }, { "12345678901234567890", false, 0 }, { "-0", false, 0 },
+			{ "007", false, 0 }, { "+5", false, 0 }, { "1234567a", false, 0 }, { "", false, 0 }, { "-", false, 0 }
+	};
+	for (size_t i = 0; i < sizeof(longs) / sizeof(longs[0]); i++) {
+		int64_t value;
+		assert(gvalue.parseLong(longs[i].text, strlen(longs[i].text), &value) == longs[i].parsed);
+		assert(longs[i].parsed == false || value == longs[i].value);
+	}
+	int64_t longValue;
+	assert(gvalue.tryGetLong(gvalue.getSString("-42"), &longValue) == true && longValue == -42);
+	assert(gvalue.tryGetLong(gvalue.getString("42abc"), &longValue) == false && longValue == 42);
+
+	// Same result and same verdict as strtod, bit for bit.
+	const char *special[] = {
+			"1", "-0", "+1.5", ".5", "5.", "1e", "1e+", "e5", ".", "", "-", " 1", "1 ", "inf", "-nan", "0x1p3",
+			"1e400", "-1e400", "1e-400", "4.9e-324", "2.2250738585072011e-308", "2.2250738585072014e-308",
+			"9007199254740993", "9007199254740995", "1.7976931348623157e308", "1.7976931348623159e308",
+			"0.000000000000000000000000000001", "123456789012345678901234567890", "1e99999999999999999999",
+			"7.2057594037927933e16", "2.4703282292062328e-324", "3.0E-5", "18446744073709551615e-10"
+	};
+	char buffer[64];
+	for (size_t i = 0; i < sizeof(special) / sizeof(special[0]) + 200000; i++) {
+		const char *text = buffer;
+		if (i < sizeof(special) / sizeof(special[0])) {
+			text = special[i];
+		}
+		else {
+			uint64_t bits = ((uint64_t) rand() << 40) ^ ((uint64_t) rand() << 20) ^ (uint64_t) rand();
+			double d;
+			memcpy(&d, &bits, sizeof(d));
+			switch (i % 4) {
+			case 0:
+				sprintf(buffer, "%.17g", d);
+				break;
+			case 1:
+				sprintf(buffer, "%.*e", rand() % 18, d);
+				break;
+			case 2:
+				sprintf(buffer, "%d.%de%d", rand(), rand() % 100000, rand() % 700 - 350);
+				break;
+			default:
+				sprintf(buffer, "%.*f", rand() % 10, (double) (rand() % 1000000) / (1 + rand() % 1000));
+				break;
+			}
+		}
+
+		char *endPtr;
+		double expected = strtod(text, &endPtr);
+		bool expectedParsed = (endPtr != text) && (*endPtr == '\0');
+		double actual;
+		bool actualParsed = gvalue.parseDouble(text, strlen(text), &actual);
+		assert(actualParsed == expectedParsed);
+		assert(memcmp(&actual, &expected, sizeof(double)) == 0 || (actual != actual && expected != expected));
+	}
+
+	// Bulk conversion keeps the indexes and counts what did not parse.
+	struct glist_list *strings = glist.create(gvalue.stringType);
+	glist.add(strings, gvalue.getString("12"));
+	glist.add(strings, gvalue.getString("twelve"));
+	glist.add(strings, gvalue.getString("-3.5e2"));
+	uint32_t failures;
+	struct glist_list *longList = glist.parseNumbers(strings, gvalue.longType, &failures);
+	assert(longList->size == 3 && failures == 2);
+	assert(glist.get(longList, 0)->primitive.longValue == 12 && glist.get(longList, 1)->primitive.longValue == 0);
+	struct glist_list *doubleList = glist.parseNumbers(strings, gvalue.doubleType, &failures);
+	assert(doubleList->size == 3 && failures == 1);
+	assert(glist.get(doubleList, 2)->primitive.doubleValue == -350);
+	printf("(Ignore this error) ");
+	assert(glist.parseNumbers(doubleList, gvalue.longType, NULL) == NULL);
+	glist.free(doubleList);
+	glist.free(longList);
+	glist.free(strings);
+
+	puts("Done test_gvalue_parse\n");
+}
+
+void test_gvalue_utf8(void) {
+	puts("Start test_gvalue_utf8");
+
+	// Two-, three- and four-byte sequences, with ASCII runs long enough for the block fast path.
+	wchar_t *wide = L"caf\u00E9 \u20AC 1234567890123456789012345 \U0001F600 end";
+	char *utf8 = "caf\xC3\xA9 \xE2\x82\xAC 1234567890123456789012345 \xF0\x9F\x98\x80 end";
+	char *s = gvalue.getAllocStringValue(gvalue.getWString(wide));
+	assert(strcmp(s, utf8) == 0);
+	free(s);
+	wchar_t *w = gvalue.getAllocWStringValue(gvalue.getString(utf8));
+	assert(wcscmp(w, wide) == 0);
+	free(w);
+
+	char buffer[64];
+	assert(gvalue.format(gvalue.getWChar(L'\u00E9'), buffer, sizeof(buffer)) == 2);
+	assert(strcmp(buffer, "\xC3\xA9") == 0);
+	assert(gvalue.format(gvalue.getWString(wide), buffer, 6) == strlen(utf8));
+	assert(strncmp(buffer, utf8, 5) == 0);
+
+	// Malformed input becomes U+FFFD, one per maximal invalid prefix.
+	wchar_t decoded[16];
+	assert(gvalue.decodeUtf8("a\xC3", 2, decoded) == 2 && decoded[1] == 0xFFFD);
+	assert(gvalue.decodeUtf8("\xE0\x80\x80", 3, decoded) == 3 && decoded[0] == 0xFFFD && decoded[2] == 0xFFFD);
+	assert(gvalue.decodeUtf8("\xED\xA0\x80", 3, decoded) == 3 && decoded[0] == 0xFFFD);
+	assert(gvalue.decodeUtf8("\xE2\x82x", 3, decoded) == 2 && decoded[0] == 0xFFFD && decoded[1] == L'x');
+	assert(gvalue.decodeUtf8("\xA5\x80\xC0\xAF", 4, decoded) == 4 && decoded[0] == 0xFFFD && decoded[3] == 0xFFFD);
+	assert(gvalue.decodeUtf8("\xC3\xE2\x82\xAC", 4, decoded) == 2 && decoded[0] == 0xFFFD && decoded[1] == 0x20AC);
+#if WCHAR_MAX > 0xFFFF
+	wchar_t loneSurrogate = (wchar_t) 0xD800;
+	assert(gvalue.encodeUtf8(&loneSurrogate, 1, buffer) == 3 && memcmp(buffer, "\xEF\xBF\xBD", 3) == 0);
+#endif
+
+	// Every code point survives the round trip, across block and chunk boundaries.
+	size_t count = 0;
+	wchar_t *all = malloc(sizeof(wchar_t) * 0x11000);
+	for (uint32_t c = 1; c < 0x30000; c += (c < 0x800) ? 1 : 61) {
+		if (c >= 0xD800 && c <= 0xDFFF) {
+			continue;
+		}
+		all[count++] = (wchar_t) c;
+		if (c % 7 == 0) {
+			for (int k = 0; k < 20; k++) {
+				all[count++] = L'a';
+			}
+		}
+	}
+	all[count] = L'\0';
+	s = gvalue.getAllocStringValue(gvalue.getWString(all));
+	w = gvalue.getAllocWStringValue(gvalue.getString(s));
+	assert(wcscmp(w, all) == 0);
+
+	// Printing stays byte-oriented, so plain writes after it still work.
+	FILE *file = tmpfile();
+	gvalue.fprint(gvalue.getWString(all), file);
+	fputs("!", file);
+	long size = ftell(file);
+	assert(size == (long) strlen(s) + 1);
+	rewind(file);
+	char *written = malloc(size + 1);
+	assert(fread(written, 1, size, file) == (size_t) size);
+	assert(memcmp(written, s, size - 1) == 0 && written[size - 1] == '!');
+	fclose(file);
+
+	free(written);
+	free(w);
+	free(s);
+	free(all);
+
+	puts("Done test_gvalue_utf8\n");
+}
+
+void test_compactStorage(void) {
+	puts("Start test_compactStorage");
+
+	// Every compact value comes back unchanged.
+	int marker;
+	struct gvalue_value values[] = {
+			gvalue.getBool(true), gvalue.getByte(-5), gvalue.getShort(-300), gvalue.getInt(INT32_MIN),
+			gvalue.getUByte(200), gvalue.getUShort(65000), gvalue.getUInt(UINT32_MAX), gvalue.getFloat(-1.5f),
+			gvalue.getChar('x'), gvalue.getWChar(L'y'), gvalue.getLong(-(INT64_C(1) << 47)), gvalue.getLong(123456789012LL),
+			gvalue.getULong((UINT64_C(1) << 48) - 1), gvalue.getDouble(-0.0), gvalue.getDouble(INFINITY),
+			gvalue.getDouble(-INFINITY), gvalue.getDouble(NAN), gvalue.getDouble(3.25), gvalue.getPointer(&marker),
+			gvalue.getString("compact"), gvalue.getWString(L"wide"), gvalue.getIString(gvalue.intern("interned"))
+	};
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		uint64_t word;
+		assert(gvalue.toCompact(values[i], &word) == true);
+		struct gvalue_value back = gvalue.fromCompact(word);
+		assert(back.type == values[i].type);
+		assert(gvalue.cmp(back, values[i]) == 0);
+	}
+
+	uint64_t word;
+	assert(gvalue.toCompact(gvalue.getLong(INT64_C(1) << 47), &word) == false);
+	assert(gvalue.toCompact(gvalue.getSString("short"), &word) == false);
+	assert(gvalue.isCompactType(gvalue.bytesType) == false);
+
+	// A compact map behaves like a regular one.
+	struct gmap_config config = { .keyType = gvalue.intType, .maintainFingerprint = true };
+	struct gmap_map *regular = gmap.create1(config);
+	config.compactStorage = true;
+	struct gmap_map *compact = gmap.create1(config);
+
+	for (int i = 0; i < 10000; i++) {
+		gmap.put(regular, gvalue.getInt(i), gvalue.getDouble(i * 0.5));
+		gmap.put(compact, gvalue.getInt(i), gvalue.getDouble(i * 0.5));
+	}
+	for (int i = 0; i < 10000; i += 3) {
+		gmap.remove(regular, gvalue.getInt(i));
+		gmap.remove(compact, gvalue.getInt(i));
+	}
+	gmap.put(compact, gvalue.getInt(1), gvalue.getDouble(-1));
+	gmap.put(regular, gvalue.getInt(1), gvalue.getDouble(-1));
+
+	assert(compact->size == regular->size);
+	assert(compact->fingerprint == regular->fingerprint);
+	assert(gmap.equals(compact, regular) == true);
+	assert(gmap.get(compact, gvalue.getInt(4))->primitive.doubleValue == 2.0);
+	assert(gmap.get(compact, gvalue.getInt(3)) == NULL);
+
+	double sum = 0;
+	struct gmap_iterator iterator = gmap.iterator(compact);
+	while (gmap.next(&iterator)) {
+		sum += iterator.value.primitive.doubleValue;
+	}
+	assert(sum > 0);
+
+	printf("(Ignore this error) ");
+	assert(gmap.put(compact, gvalue.getInt(-1), gvalue.getBytes("x", 1)) == false);
+	printf("Bucket size: regular %zu, compact %zu\n", sizeof(struct gmap_bucket), sizeof(struct gmap_compact_bucket));
+
+	gmap.free(regular);
+	gmap.free(compact);
+
+	config.maintainInsertionOrder = true;
+	printf("(Ignore this error) ");
+	assert(gmap.create1(config) == NULL);
+
+	struct gset_config setConfig = { .dataType = gvalue.longType, .compactStorage = true };
+	struct gset_set *set = gset.create1(setConfig);
+	gset.put(set, gvalue.getLong(42));
+	assert(gset.contains(set, gvalue.getLong(42)) == true);
+	gset.free(set);
+
+	puts("Done test_compactStorage\n");
+}
+
 int main(void) {
+	test_gvalue_types();
+	test_gvalue_format();
+	test_gvalue_utf8();
+	test_gvalue_parse();
+	test_gvalue_registeredTypes();
+	test_gvalue_hash();
+	test_gvalue_hashDistribution();
+	test_gvalue_intern();
+	test_gvalue_sstring();
+	test_gvalue_bytes();
 	test_gmap();
 	test_intmap();
 	test_strmap();
+	test_ignoreCase();
 	test_glist();
+	test_glist_sort();
+	test_glist_sorted();
+	test_glist_removeBulk();
+	test_glist_scan();
+	test_glist_packed();
+	test_glist_insert();
+	test_gdeque();
 	test_gset();
+	test_identityMap();
+	test_compactStorage();
+	test_fmap();
+	test_gwal();
+	gvalue.freeInternPool(NULL);
+	gvalue.freeRegisteredTypes();
 	return EXIT_SUCCESS;
 }